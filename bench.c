@@ -0,0 +1,343 @@
+// The functions in this file make up the benchmark kernel, which is built
+// with BENCHMARK defined by 'make bench'. Before the game starts, main()
+// runs a fixed set of workloads and reports how long each took over the
+// serial port, one line per workload:
+//
+//     BENCH BEGIN <format version> <counter frequency in Hz>
+//     BENCH <name> <iterations> <counter ticks>
+//     ...
+//     BENCH END
+//
+// The time is read from the ARM generic timer's virtual counter. Under
+// Qemu with -icount, this counter advances with the number of instructions
+// executed, so the same kernel always reports the same counts, and any
+// change from one commit to the next is a real change in the code. The
+// lines are read by bench/bench.py, which compares them with a baseline.
+//
+// The workloads use their own maze, generated from a fixed seed, so they
+// do not depend on the game's state or on the timer.
+
+#ifdef BENCHMARK
+
+// Needed header files
+#include "uart.h"
+#include "kprintf.h"
+#include "framebuffer.h"
+#include "tiles.h"
+#include "maze.h"
+#include "mazegen.h"
+#include "viewport.h"
+#include "solver.h"
+#include "bench.h"
+
+// The version of the output format, for bench/bench.py
+#define BENCH_FORMAT_VERSION    1
+
+// The benchmark maze and screen, which are the sizes the game uses
+#define BENCH_MAZE_WIDTH        127
+#define BENCH_MAZE_HEIGHT       95
+#define BENCH_MAZE_SEED         359
+#define BENCH_COLUMNS           16
+#define BENCH_ROWS              12
+
+// How many times each workload is repeated
+#define BENCH_REPAINTS          16
+#define BENCH_MOVES             1024
+#define BENCH_UART_BYTES        65536
+#define BENCH_MAILBOX_QUERIES   1000
+
+// The width of each line of text sent by the UART workload, including the
+// newline. Lines start with '#', so they are not taken for results.
+#define BENCH_UART_LINE         64
+
+// A rectangle fill workload
+struct BenchRect {
+    char *name;
+    int width, height;
+    int iterations;
+};
+
+static const struct BenchRect rectWorkloads[] = {
+    {"rect_8x8",       8,    8, 4096},
+    {"rect_64x64",    64,   64,  512},
+    {"rect_256x256", 256,  256,   32},
+    {"rect_screen",  1024, 768,    8}
+};
+
+// The benchmark maze and view
+static struct Maze benchMaze;
+static unsigned long benchWalls[MAZE_WALL_WORDS(BENCH_MAZE_WIDTH, BENCH_MAZE_HEIGHT)];
+static unsigned char benchNeighbors[MAZE_NEIGHBOR_BYTES(BENCH_MAZE_WIDTH, BENCH_MAZE_HEIGHT)];
+static unsigned char benchScratch[MAZEGEN_SCRATCH_BYTES(BENCH_MAZE_WIDTH, BENCH_MAZE_HEIGHT)];
+static struct Viewport benchView;
+static struct Solver benchSolver;
+static unsigned int benchDistance[BENCH_MAZE_WIDTH * BENCH_MAZE_HEIGHT];
+static unsigned int benchQueue[BENCH_MAZE_WIDTH * BENCH_MAZE_HEIGHT];
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       readCounter
+//
+//  Arguments:      none
+//
+//  Returns:        The generic timer virtual count
+//
+//  Description:    This function reads the virtual counter. The isb makes
+//                  sure the instructions before it have completed first.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static inline unsigned long readCounter()
+{
+    unsigned long count;
+
+
+    asm volatile("isb\n\tmrs %0, cntvct_el0" : "=r" (count) : : "memory");
+
+    return count;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       report
+//
+//  Arguments:      name:            The workload name
+//                  iterations:      How many times the workload was repeated
+//                  ticks:           The counter ticks all of them took
+//
+//  Returns:        void
+//
+//  Description:    This function sends one result line.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void report(char *name, unsigned long iterations, unsigned long ticks)
+{
+    kprintf("BENCH %s %lu %lu\n", name, iterations, ticks);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       benchRepaint
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function times a full repaint of the maze view,
+//                  which is what the game does when it draws a new maze.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void benchRepaint()
+{
+    unsigned long start;
+    int i;
+
+
+    start = readCounter();
+    for (i = 0; i < BENCH_REPAINTS; i++) {
+        viewport_draw(&benchView);
+    }
+    report("maze_repaint", BENCH_REPAINTS, readCounter() - start);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       benchMoves
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function times single cell moves along the shortest
+//                  path to the exit, with the view scrolling to follow, as
+//                  when the game is auto-solving. At the exit the walk
+//                  starts again from the entrance.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void benchMoves()
+{
+    unsigned long start;
+    int x, y, direction, i;
+
+
+    x = benchMaze.entranceX;
+    y = benchMaze.entranceY;
+    viewport_jump(&benchView, x, y);
+
+    start = readCounter();
+    for (i = 0; i < BENCH_MOVES; i++) {
+        direction = solver_next_move(&benchSolver, x, y);
+        if (direction == SOLVER_NO_MOVE) {
+            x = benchMaze.entranceX;
+            y = benchMaze.entranceY;
+        } else {
+            x += directionX[direction];
+            y += directionY[direction];
+        }
+        viewport_follow(&benchView, x, y);
+    }
+    report("cell_moves", BENCH_MOVES, readCounter() - start);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       benchRects
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function times rectangle fills of several sizes,
+//                  from a single tile up to the whole screen.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void benchRects()
+{
+    const struct BenchRect *rect;
+    unsigned long start;
+    int i, j;
+
+
+    for (i = 0; i < (int)(sizeof(rectWorkloads) / sizeof(rectWorkloads[0])); i++) {
+        rect = &rectWorkloads[i];
+
+        start = readCounter();
+        for (j = 0; j < rect->iterations; j++) {
+            drawRectToFrameBuffer(0, 0, rect->width, rect->height, 0x00404040);
+        }
+        report(rect->name, rect->iterations, readCounter() - start);
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       benchUart
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function times sending BENCH_UART_BYTES of text
+//                  with uart_puts(), a line at a time. The iterations
+//                  reported are bytes.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void benchUart()
+{
+    char line[BENCH_UART_LINE + 1];
+    unsigned long start;
+    int i;
+
+
+    // A newline is sent as two characters, so the text is one byte
+    // shorter per line to keep the line length on the wire
+    line[0] = '#';
+    for (i = 1; i < BENCH_UART_LINE - 2; i++) {
+        line[i] = 'a' + (i % 26);
+    }
+    line[BENCH_UART_LINE - 2] = '\n';
+    line[BENCH_UART_LINE - 1] = '\0';
+
+    start = readCounter();
+    for (i = 0; i < BENCH_UART_BYTES / BENCH_UART_LINE; i++) {
+        uart_puts(line);
+    }
+    report("uart_puts", BENCH_UART_BYTES, readCounter() - start);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       benchMailbox
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function times property tag requests, each of which
+//                  is one mailbox round trip to the video core.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void benchMailbox()
+{
+    unsigned long start;
+    int i;
+
+
+    start = readCounter();
+    for (i = 0; i < BENCH_MAILBOX_QUERIES; i++) {
+        setFrameBufferOffset(0, 0);
+    }
+    report("mailbox_query", BENCH_MAILBOX_QUERIES, readCounter() - start);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       bench_run
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function sets up the frame buffer and the benchmark
+//                  maze, then runs every workload and reports the results.
+//                  It must be called after uart_init(). The setup is not
+//                  timed. If the frame buffer cannot be allocated, no
+//                  workload is run.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void bench_run()
+{
+    unsigned long frequency;
+
+
+    if (!initFrameBufferVirtual(VIEWPORT_REGION_WIDTH(BENCH_COLUMNS),
+                                VIEWPORT_REGION_HEIGHT(BENCH_ROWS))) {
+        uart_puts("BENCH END\n");
+        return;
+    }
+    tiles_init();
+
+    maze_init(&benchMaze, BENCH_MAZE_WIDTH, BENCH_MAZE_HEIGHT, benchWalls, benchNeighbors);
+    maze_generate(&benchMaze, BENCH_MAZE_SEED, benchScratch, 0);
+    viewport_init(&benchView, &benchMaze, BENCH_COLUMNS, BENCH_ROWS, 0);
+    solver_init(&benchSolver, &benchMaze, benchDistance, benchQueue,
+                BENCH_MAZE_WIDTH * BENCH_MAZE_HEIGHT);
+    solver_update(&benchSolver);
+
+    asm volatile("mrs %0, cntfrq_el0" : "=r" (frequency));
+
+    kprintf("BENCH BEGIN %d %lu\n", BENCH_FORMAT_VERSION, frequency);
+
+    benchRepaint();
+    benchMoves();
+    benchRects();
+    benchUart();
+    benchMailbox();
+
+    uart_puts("BENCH END\n");
+}
+
+#endif
@@ -0,0 +1,3 @@
+// Function prototypes for the benchmark kernel (see bench.c), which is
+// built with BENCHMARK defined
+void bench_run();
@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+#  This script runs the benchmark kernel (built by 'make bench') under Qemu,
+#  reads the results it reports over the serial port (see bench.c), and
+#  compares them with a stored baseline.
+#
+#  Qemu is run with -icount, so the counts depend only on the instructions
+#  executed, and the same kernel always gives the same results. Any change
+#  larger than the threshold is reported as a regression or improvement,
+#  and the script exits with status 1 if anything got slower.
+#
+#  Usage: bench.py [options] kernel.img baseline.txt
+#
+#      --update            Write the results as the new baseline
+#      --results FILE      Also save the raw results to FILE
+#      --threshold PCT     Smallest change reported, in percent (default 1)
+#      --qemu PROGRAM      The Qemu program (default qemu-system-aarch64)
+#      --console UART      The UART the kernel's console is on, mini or pl011
+#                          (default mini), as set with 'make CONSOLE_UART='
+#      --timeout SECONDS   Give up if the kernel has not finished (default 300)
+
+import argparse
+import subprocess
+import sys
+import threading
+
+FORMAT_VERSION = 1
+
+
+def run_kernel(qemu, image, timeout, console):
+    """Boots the kernel and returns the BENCH lines it sends, up to BENCH END."""
+    # Qemu's first serial port is the PL011 and its second the Mini UART
+    serial = ["-serial", "stdio", "-serial", "null"] if console == "pl011" else \
+             ["-serial", "null", "-serial", "stdio"]
+    command = [qemu, "-M", "raspi3", "-kernel", image, "-icount", "shift=0",
+               "-display", "none"] + serial
+    process = subprocess.Popen(command, stdin=subprocess.DEVNULL, stdout=subprocess.PIPE,
+                               universal_newlines=True, errors="replace")
+    watchdog = threading.Timer(timeout, process.kill)
+    lines = []
+
+    # The kernel goes on to run the game afterwards, so Qemu is stopped
+    # once the results are in
+    watchdog.start()
+    try:
+        for line in process.stdout:
+            line = line.strip()
+            if line.startswith("BENCH "):
+                lines.append(line)
+                if line == "BENCH END":
+                    break
+    finally:
+        watchdog.cancel()
+        process.kill()
+        process.wait()
+
+    if not lines or lines[-1] != "BENCH END":
+        sys.exit("bench.py: the kernel did not finish its benchmarks")
+
+    return lines
+
+
+def parse(lines):
+    """Returns the counter frequency and {name: (iterations, ticks)}."""
+    frequency = None
+    results = {}
+
+    for line in lines:
+        fields = line.split()
+        if fields[1] == "BEGIN":
+            if int(fields[2]) != FORMAT_VERSION:
+                sys.exit("bench.py: unknown result format %s" % fields[2])
+            frequency = int(fields[3])
+        elif fields[1] != "END":
+            results[fields[1]] = (int(fields[2]), int(fields[3]))
+
+    return frequency, results
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Run and compare the kernel benchmarks")
+    parser.add_argument("image")
+    parser.add_argument("baseline")
+    parser.add_argument("--update", action="store_true")
+    parser.add_argument("--results")
+    parser.add_argument("--threshold", type=float, default=1.0)
+    parser.add_argument("--qemu", default="qemu-system-aarch64")
+    parser.add_argument("--timeout", type=float, default=300)
+    parser.add_argument("--console", choices=["mini", "pl011"], default="mini")
+    args = parser.parse_args()
+
+    lines = run_kernel(args.qemu, args.image, args.timeout, args.console)
+    frequency, results = parse(lines)
+
+    if args.results:
+        with open(args.results, "w") as file:
+            file.write("\n".join(lines) + "\n")
+
+    if args.update:
+        with open(args.baseline, "w") as file:
+            file.write("\n".join(lines) + "\n")
+        print("Baseline written to %s" % args.baseline)
+
+    try:
+        with open(args.baseline) as file:
+            base_frequency, baseline = parse([l.strip() for l in file if l.startswith("BENCH ")])
+    except FileNotFoundError:
+        base_frequency, baseline = frequency, {}
+        print("No baseline in %s; run 'make bench-baseline' to store one" % args.baseline)
+
+    if base_frequency != frequency:
+        print("Warning: the counter frequency changed from %s to %s Hz" %
+              (base_frequency, frequency))
+
+    print("%-16s %10s %14s %14s %9s" % ("workload", "iterations", "ticks/iter",
+                                         "baseline", "change"))
+    slower = False
+    for name, (iterations, ticks) in results.items():
+        per_iteration = ticks / iterations
+        if name not in baseline:
+            print("%-16s %10d %14.2f %14s %9s" % (name, iterations, per_iteration, "-", "new"))
+            continue
+
+        before = baseline[name][1] / baseline[name][0]
+        change = ((per_iteration - before) * 100.0 / before) if before else 0.0
+        note = ""
+        if change >= args.threshold:
+            note = "  slower"
+            slower = True
+        elif change <= -args.threshold:
+            note = "  faster"
+        print("%-16s %10d %14.2f %14.2f %+8.2f%%%s" % (name, iterations, per_iteration, before,
+                                                     change, note))
+
+    return 1 if slower else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,303 @@
+// The functions in this file control the clock rates through the video
+// core's property mailbox. The firmware boots the ARM at a low rate and
+// only raises it when asked, so clock_init() asks for the maximum, and
+// clock_governor_frame() then steps it between the minimum and maximum
+// rates as the game goes idle and busy again.
+//
+// Building with CLOCK_RAISE_CORE defined also raises the core (VPU) clock.
+// The Mini UART's baud rate is divided from the core clock, so the UART is
+// reprogrammed for the new rate. The firmware refuses if the core clock is
+// fixed in config.txt, as it is by enable_uart=1.
+
+// Needed header files
+#include "uart.h"
+#include "kprintf.h"
+#include "systimer.h"
+#include "mailbox.h"
+#include "clock.h"
+
+// The ARM rates the governor steps between, in Hz, and the current one
+static unsigned int armMinRate;
+static unsigned int armMaxRate;
+static unsigned int armRate;
+
+// How many idle frames there have been in a row
+static unsigned int idleFrames;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       clockQuery
+//
+//  Arguments:      tag:             The clock property tag
+//                  clock:           The clock ID (CLOCK_ARM, CLOCK_CORE...)
+//                  rate:            The rate to set in Hz, ignored by the
+//                                   tags that only read a rate
+//
+//  Returns:        The rate in the video core's response, or 0 if the
+//                  request failed
+//
+//  Description:    This function sends one clock rate tag to the video core.
+//                  All of the rate tags take the clock ID and a rate, and
+//                  respond with the clock ID and a rate.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int clockQuery(unsigned int tag, unsigned int clock, unsigned int rate)
+{
+    mailbox_buffer[0] = 9 * 4;
+    mailbox_buffer[1] = MAILBOX_REQUEST;
+
+    mailbox_buffer[2] = tag;
+    mailbox_buffer[3] = 12;
+    mailbox_buffer[4] = 0;
+    mailbox_buffer[5] = clock;
+    mailbox_buffer[6] = rate;
+    mailbox_buffer[7] = 0;                      // Do not skip turbo settings
+
+    mailbox_buffer[8] = TAG_LAST;
+
+    if (!mailbox_query(CHANNEL_PROPERTY_TAGS_ARMTOVC) ||
+        !(mailbox_buffer[4] & TAG_RESPONSE) || mailbox_buffer[5] != clock) {
+        return 0;
+    }
+
+    return mailbox_buffer[6];
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       clock_get_rate
+//
+//  Arguments:      clock:           The clock ID (CLOCK_ARM, CLOCK_CORE...)
+//
+//  Returns:        The current rate of the clock in Hz, or 0 if unknown
+//
+//  Description:    This function asks the video core for a clock's rate.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int clock_get_rate(unsigned int clock)
+{
+    return clockQuery(TAG_GET_CLOCK_RATE, clock, 0);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       clock_get_max_rate
+//
+//  Arguments:      clock:           The clock ID (CLOCK_ARM, CLOCK_CORE...)
+//
+//  Returns:        The highest rate the clock can be set to in Hz, or 0 if
+//                  unknown
+//
+//  Description:    This function asks the video core for a clock's maximum
+//                  rate.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int clock_get_max_rate(unsigned int clock)
+{
+    return clockQuery(TAG_GET_MAX_CLOCK_RATE, clock, 0);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       clock_get_min_rate
+//
+//  Arguments:      clock:           The clock ID (CLOCK_ARM, CLOCK_CORE...)
+//
+//  Returns:        The lowest rate the clock can be set to in Hz, or 0 if
+//                  unknown
+//
+//  Description:    This function asks the video core for a clock's minimum
+//                  rate.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int clock_get_min_rate(unsigned int clock)
+{
+    return clockQuery(TAG_GET_MIN_CLOCK_RATE, clock, 0);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       clock_set_rate
+//
+//  Arguments:      clock:           The clock ID (CLOCK_ARM, CLOCK_CORE...)
+//                  rate:            The rate wanted in Hz
+//
+//  Returns:        The rate the clock was set to in Hz, or 0 if the request
+//                  failed
+//
+//  Description:    This function asks the video core to change a clock's
+//                  rate. The firmware may round the rate or clamp it to its
+//                  limits, so the rate returned is the one to rely on.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int clock_set_rate(unsigned int clock, unsigned int rate)
+{
+    return clockQuery(TAG_SET_CLOCK_RATE, clock, rate);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       timeWorkload
+//
+//  Arguments:      workload:        The function to time, or 0
+//
+//  Returns:        The time the function took in microseconds
+//
+//  Description:    This function runs a function once and times it with the
+//                  system timer, which does not change with the ARM clock.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int timeWorkload(void (*workload)())
+{
+    unsigned long start;
+
+
+    if (!workload) {
+        return 0;
+    }
+
+    start = get_timer_counter();
+    workload();
+
+    return (unsigned int)(get_timer_counter() - start);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       clock_init
+//
+//  Arguments:      workload:        A function to time before and after the
+//                                   clock is raised, such as a full redraw,
+//                                   or 0 for none
+//
+//  Returns:        void
+//
+//  Description:    This function raises the ARM clock to its maximum rate,
+//                  and reports the rates and the workload's time before and
+//                  after. It must be called once, after uart_init().
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void clock_init(void (*workload)())
+{
+    unsigned int bootRate, before, rate;
+#ifdef CLOCK_RAISE_CORE
+    unsigned int coreRate;
+#endif
+
+
+    bootRate = clock_get_rate(CLOCK_ARM);
+    armMinRate = clock_get_min_rate(CLOCK_ARM);
+    armMaxRate = clock_get_max_rate(CLOCK_ARM);
+    before = timeWorkload(workload);
+
+    // The firmware may round the rate, so the one it sets is the maximum
+    armRate = bootRate;
+    if (armMaxRate && (rate = clock_set_rate(CLOCK_ARM, armMaxRate))) {
+        armRate = armMaxRate = rate;
+    }
+
+    // Without known limits there is nothing for the governor to step between
+    if (!armMinRate || armMinRate >= armMaxRate) {
+        armMinRate = armMaxRate = armRate;
+    }
+
+#ifdef CLOCK_RAISE_CORE
+    // Wait for the UART to finish sending before its clock changes
+    uart_flush();
+    coreRate = clock_get_max_rate(CLOCK_CORE);
+    if (coreRate && clock_set_rate(CLOCK_CORE, coreRate)) {
+        uart_set_clock_rate(clock_get_rate(CLOCK_CORE));
+    }
+#endif
+
+    kprintf("Clock: ARM %u -> %u Hz, workload %u -> %u us\n",
+            bootRate, armRate, before, timeWorkload(workload));
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       clock_governor_frame
+//
+//  Arguments:      busy:            The time the frame spent working, in
+//                                   microseconds
+//                  period:          The time between frames, in
+//                                   microseconds
+//
+//  Returns:        void
+//
+//  Description:    This function is called once a frame with how busy the
+//                  frame was. After CLOCK_IDLE_FRAMES idle frames in a row
+//                  the ARM clock is stepped down to its minimum rate, and a
+//                  busy frame steps it back up to its maximum. Each step
+//                  costs a mailbox round trip, so the clock is only changed
+//                  when it needs to be.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void clock_governor_frame(unsigned int busy, unsigned int period)
+{
+    unsigned int rate;
+
+
+    if (busy * CLOCK_IDLE_FRACTION < period) {
+        idleFrames++;
+    } else {
+        idleFrames = 0;
+    }
+
+    if (armRate == armMaxRate && idleFrames >= CLOCK_IDLE_FRAMES) {
+        rate = armMinRate;
+    } else if (armRate == armMinRate && busy * CLOCK_BUSY_FRACTION > period) {
+        rate = armMaxRate;
+    } else {
+        return;
+    }
+
+    if (rate != armRate && clock_set_rate(CLOCK_ARM, rate)) {
+        armRate = rate;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       clock_arm_rate
+//
+//  Arguments:      none
+//
+//  Returns:        The ARM clock rate in Hz the governor last set, or 0 if
+//                  it is unknown
+//
+//  Description:    This function returns the current ARM clock rate without
+//                  a mailbox round trip.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int clock_arm_rate()
+{
+    return armRate;
+}
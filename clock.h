@@ -0,0 +1,17 @@
+// The clock governor runs the ARM at its maximum rate while the game is
+// busy, and steps it down to its minimum once frames have been mostly idle
+// for CLOCK_IDLE_FRAMES in a row. A frame counts as idle when it is busy
+// for less than 1/CLOCK_IDLE_FRACTION of the frame time, and any frame busy
+// for more than 1/CLOCK_BUSY_FRACTION of it steps the clock straight back up.
+#define CLOCK_IDLE_FRAMES       90
+#define CLOCK_IDLE_FRACTION     4
+#define CLOCK_BUSY_FRACTION     2
+
+// Function prototypes
+unsigned int clock_get_rate(unsigned int clock);
+unsigned int clock_get_max_rate(unsigned int clock);
+unsigned int clock_get_min_rate(unsigned int clock);
+unsigned int clock_set_rate(unsigned int clock, unsigned int rate);
+void clock_init(void (*workload)());
+void clock_governor_frame(unsigned int busy, unsigned int period);
+unsigned int clock_arm_rate();
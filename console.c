@@ -0,0 +1,340 @@
+// The functions in this file implement a text console in the frame buffer,
+// which shows the same output that is written to the UART with uart_puts().
+//
+// The console lives in a region of the virtual frame buffer that is twice the
+// height of the screen. Text lines are kept in a ring, and every line is drawn
+// twice: once in the top half of the region and once in the bottom half.
+// Because of this, any screen-sized window starting on a line boundary in the
+// top half shows consecutive lines, so scrolling is done by moving the
+// window with setFrameBufferOffset() instead of copying pixels. Scrolling
+// one line only costs clearing the newly exposed line.
+
+// Needed header files
+#include "uart.h"
+#include "framebuffer.h"
+#include "font.h"
+#include "text.h"
+#include "console.h"
+
+// Console colors
+#define CONSOLE_FOREGROUND    0x00C0C0C0    // Silver
+#define CONSOLE_BACKGROUND    0x00000000    // Black
+
+// The most characters in one console line
+#define CONSOLE_MAX_COLUMNS   256
+
+// Console global variables
+static unsigned int consoleTop;         // First frame buffer row of the region
+static unsigned int consoleColumns;     // Characters per line
+static unsigned int consoleRows;        // Lines on the screen (and in the ring)
+static unsigned int consoleTopLine;     // Ring line shown at the top of screen
+static unsigned int consoleRow;         // Cursor line, relative to the screen
+static unsigned int consoleColumn;      // Cursor column
+static int consoleVisible;
+static unsigned int savedOffsetX;       // Window to go back to when hidden
+static unsigned int savedOffsetY;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       lineY
+//
+//  Arguments:      line:            A line number within the ring
+//
+//  Returns:        The frame buffer row where the first copy of the line starts
+//
+//  Description:    This function converts a ring line number to a pixel y
+//                  coordinate. The second copy of the line is found one screen
+//                  height further down.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int lineY(unsigned int line)
+{
+    return consoleTop + (line * FONT_HEIGHT);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       clearLine
+//
+//  Arguments:      line:            A line number within the ring
+//
+//  Returns:        void
+//
+//  Description:    This function fills both copies of a line with the
+//                  console background color.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void clearLine(unsigned int line)
+{
+    unsigned int y = lineY(line);
+
+    drawRectToFrameBuffer(y, 0, frameBufferWidth, FONT_HEIGHT, CONSOLE_BACKGROUND);
+    drawRectToFrameBuffer(y + frameBufferHeight, 0, frameBufferWidth, FONT_HEIGHT,
+                          CONSOLE_BACKGROUND);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       showWindow
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function moves the screen to the console window, so
+//                  that the top ring line appears at the top of the screen.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void showWindow()
+{
+    setFrameBufferOffset(0, lineY(consoleTopLine));
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       newLine
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function moves the cursor to the start of the next
+//                  line. If the cursor is already on the last line of the
+//                  screen, the console is scrolled up by one line instead:
+//                  the top ring line is recycled as the new bottom line, it
+//                  is cleared, and the window is moved down one line.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void newLine()
+{
+    consoleColumn = 0;
+
+    if (consoleRow < consoleRows - 1) {
+        consoleRow++;
+        return;
+    }
+
+    // The old top line becomes the new bottom line
+    clearLine(consoleTopLine);
+    consoleTopLine++;
+    if (consoleTopLine == consoleRows) {
+        consoleTopLine = 0;
+    }
+
+    if (consoleVisible) {
+        showWindow();
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       drawSpan
+//
+//  Arguments:      s:               The characters to draw
+//                  length:          The number of characters
+//
+//  Returns:        void
+//
+//  Description:    This function draws a run of characters at the cursor,
+//                  into both copies of the cursor line, and advances the
+//                  cursor past them. The run must fit on the current line.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void drawSpan(char *s, unsigned int length)
+{
+    unsigned int line, x, y;
+
+
+    s[length] = '\0';
+
+    line = consoleTopLine + consoleRow;
+    if (line >= consoleRows) {
+        line -= consoleRows;
+    }
+
+    x = consoleColumn * FONT_WIDTH;
+    y = lineY(line);
+
+    draw_text(x, y, s, CONSOLE_FOREGROUND, CONSOLE_BACKGROUND);
+    draw_text(x, y + frameBufferHeight, s, CONSOLE_FOREGROUND, CONSOLE_BACKGROUND);
+
+    consoleColumn += length;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       console_init
+//
+//  Arguments:      top:             The first frame buffer row of the console
+//                                   region. The region is twice the screen
+//                                   height, and must fit in the virtual frame
+//                                   buffer.
+//
+//  Returns:        void
+//
+//  Description:    This function starts clearing the console region, and
+//                  starts mirroring uart_puts() output into it. The frame
+//                  buffer must already have been initialized.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void console_init(unsigned int top)
+{
+    consoleTop = top;
+    consoleColumns = frameBufferWidth / FONT_WIDTH;
+    consoleRows = frameBufferHeight / FONT_HEIGHT;
+    consoleTopLine = 0;
+    consoleRow = 0;
+    consoleColumn = 0;
+    consoleVisible = 0;
+
+    if (consoleColumns > CONSOLE_MAX_COLUMNS) {
+        consoleColumns = CONSOLE_MAX_COLUMNS;
+    }
+
+    // Clear both halves of the region once, with DMA if there is a
+    // channel, so the rest of startup can go on while it runs. After
+    // this, only lines exposed by scrolling are ever cleared.
+    queueRectToFrameBuffer(consoleTop, 0, frameBufferWidth, 2 * frameBufferHeight,
+                           CONSOLE_BACKGROUND);
+    startFrameBufferDma();
+
+    uart_set_mirror(console_puts);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       console_puts
+//
+//  Arguments:      s:               A pointer to the string to write
+//
+//  Returns:        void
+//
+//  Description:    This function writes a string to the console. Printable
+//                  characters are gathered into runs that are drawn with one
+//                  call each. A newline moves to the next line, a carriage
+//                  return moves to the start of the line, and a line that
+//                  is too long is wrapped.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void console_puts(char *s)
+{
+    char span[CONSOLE_MAX_COLUMNS + 1];
+    unsigned int length = 0;
+
+
+    // The region may still be being cleared
+    waitFrameBufferDma();
+
+    while (*s) {
+        if (*s == '\n' || *s == '\r') {
+            if (length) {
+                drawSpan(span, length);
+                length = 0;
+            }
+
+            if (*s == '\n') {
+                newLine();
+            } else {
+                consoleColumn = 0;
+            }
+        } else {
+            if (consoleColumn + length == consoleColumns) {
+                drawSpan(span, length);
+                length = 0;
+                newLine();
+            }
+
+            span[length++] = *s;
+        }
+
+        s++;
+    }
+
+    if (length) {
+        drawSpan(span, length);
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       console_show
+//
+//  Arguments:      visible:         TRUE (non-zero) to show the console,
+//                                   FALSE (zero) to show what was on the
+//                                   screen before
+//
+//  Returns:        void
+//
+//  Description:    This function switches the screen between the console and
+//                  whatever was shown before it, by moving the window into
+//                  the virtual frame buffer. The previous window position is
+//                  saved when the console is shown and restored when it is
+//                  hidden, so a scrolled game view comes back unchanged.
+//                  Nothing happens if console_init() has not been called,
+//                  since there is then no console region to show.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void console_show(int visible)
+{
+    if (consoleRows == 0) {
+        return;
+    }
+
+    waitFrameBufferDma();
+
+    if (visible && !consoleVisible) {
+        savedOffsetX = frameBufferOffsetX;
+        savedOffsetY = frameBufferOffsetY;
+    }
+
+    if (visible) {
+        showWindow();
+    } else if (consoleVisible) {
+        setFrameBufferOffset(savedOffsetX, savedOffsetY);
+    }
+
+    consoleVisible = visible;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       console_is_visible
+//
+//  Arguments:      none
+//
+//  Returns:        TRUE (non-zero) if the console is on the screen
+//
+//  Description:    This function reports whether the console is shown.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int console_is_visible()
+{
+    return consoleVisible;
+}
@@ -0,0 +1,6 @@
+// These are the function prototypes for the frame buffer text console
+
+void console_init(unsigned int top);
+void console_puts(char *s);
+void console_show(int visible);
+int console_is_visible();
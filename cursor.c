@@ -0,0 +1,135 @@
+// The functions in this file drive the hardware cursor of the video core.
+// The cursor is an image that the display hardware draws over the frame
+// buffer, so it can be moved around without touching any frame buffer pixels.
+// The image is uploaded once with cursor_set_image(), after which moving it
+// costs a single mailbox query.
+
+// Needed header files
+#include "mailbox.h"
+#include "cursor.h"
+
+// Cursor state flag, which selects frame buffer (not display) coordinates
+#define CURSOR_FRAMEBUFFER_COORDINATES   1
+
+// Alpha value for opaque cursor pixels
+#define CURSOR_OPAQUE       0xFF000000
+
+// The cursor image. The video core reads the pixels from here, so the
+// buffer must stay in place for as long as the cursor is in use.
+static unsigned int __attribute__((aligned(16))) cursorImage[CURSOR_MAX_SIZE * CURSOR_MAX_SIZE];
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       tagAccepted
+//
+//  Arguments:      none
+//
+//  Returns:        TRUE (non-zero) if the video core processed the single tag
+//                  in the mailbox buffer, and reported it as valid
+//
+//  Description:    This function checks the response to a cursor tag. Older
+//                  firmware, and Qemu, do not implement the cursor tags. In
+//                  that case the tag is left without its response bit set.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static int tagAccepted()
+{
+    return (mailbox_buffer[4] & TAG_RESPONSE) && (mailbox_buffer[5] == 0);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       cursor_set_image
+//
+//  Arguments:      pixels:          The image, one 32-bit pixel per entry,
+//                                   row by row from the top down
+//                  width:           Image width in pixels
+//                  height:          Image height in pixels
+//                  transparent:     Pixels of this color are not drawn
+//
+//  Returns:        TRUE (non-zero) if the video core accepted the image,
+//                  FALSE (zero) otherwise.
+//
+//  Description:    This function copies an image into the cursor buffer,
+//                  giving opaque pixels full alpha and transparent pixels
+//                  zero alpha, and then hands the buffer to the video core
+//                  using the TAG_SET_CURSOR_INFO mailbox property tag. The
+//                  hot spot is the top left pixel, so cursor positions are
+//                  the same as the positions the image would be drawn at.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int cursor_set_image(const unsigned int *pixels, int width, int height,
+                     unsigned int transparent)
+{
+    int i;
+
+
+    if (width > CURSOR_MAX_SIZE || height > CURSOR_MAX_SIZE) {
+        return 0;
+    }
+
+    for (i = 0; i < width * height; i++) {
+        cursorImage[i] = (pixels[i] == transparent) ? 0 : (pixels[i] | CURSOR_OPAQUE);
+    }
+
+    mailbox_buffer[0] = 12 * 4;
+    mailbox_buffer[1] = MAILBOX_REQUEST;
+
+    mailbox_buffer[2] = TAG_SET_CURSOR_INFO;
+    mailbox_buffer[3] = 24;
+    mailbox_buffer[4] = 0;
+    mailbox_buffer[5] = width;
+    mailbox_buffer[6] = height;
+    mailbox_buffer[7] = 0;                      // Unused
+    mailbox_buffer[8] = ARM_TO_BUS(cursorImage);
+    mailbox_buffer[9] = 0;                      // Hot spot x
+    mailbox_buffer[10] = 0;                     // Hot spot y
+
+    mailbox_buffer[11] = TAG_LAST;
+
+    return mailbox_query(CHANNEL_PROPERTY_TAGS_ARMTOVC) && tagAccepted();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       cursor_set_state
+//
+//  Arguments:      visible:         TRUE (non-zero) to show the cursor,
+//                                   FALSE (zero) to hide it
+//                  x:               Left pixel x coordinate
+//                  y:               Top pixel y coordinate
+//
+//  Returns:        TRUE (non-zero) if the video core accepted the state,
+//                  FALSE (zero) otherwise.
+//
+//  Description:    This function shows, hides or moves the cursor with one
+//                  TAG_SET_CURSOR_STATE mailbox property tag. The position is
+//                  given in frame buffer coordinates.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int cursor_set_state(int visible, int x, int y)
+{
+    mailbox_buffer[0] = 10 * 4;
+    mailbox_buffer[1] = MAILBOX_REQUEST;
+
+    mailbox_buffer[2] = TAG_SET_CURSOR_STATE;
+    mailbox_buffer[3] = 16;
+    mailbox_buffer[4] = 0;
+    mailbox_buffer[5] = visible ? 1 : 0;
+    mailbox_buffer[6] = x;
+    mailbox_buffer[7] = y;
+    mailbox_buffer[8] = CURSOR_FRAMEBUFFER_COORDINATES;
+
+    mailbox_buffer[9] = TAG_LAST;
+
+    return mailbox_query(CHANNEL_PROPERTY_TAGS_ARMTOVC) && tagAccepted();
+}
@@ -0,0 +1,7 @@
+// The largest cursor image the video core accepts, in pixels per side
+#define CURSOR_MAX_SIZE     64
+
+// These are the function prototypes for the hardware cursor
+int cursor_set_image(const unsigned int *pixels, int width, int height,
+                     unsigned int transparent);
+int cursor_set_state(int visible, int x, int y);
@@ -0,0 +1,360 @@
+// The functions in this file drive the DMA controller, so that large
+// copies and fills of memory, such as parts of the frame buffer, can run
+// while the CPU does something else.
+//
+// A transfer is a chain of control blocks in memory (see dma.h). The
+// functions below fill in control blocks for linear copies and for 2D
+// copies and fills, which move a rectangle of rows with a pitch between
+// them. The DMA engine only sees bus addresses, so every address in a
+// control block, and the address of the block itself, is an ARM physical
+// address passed through ARM_TO_BUS().
+//
+// The video core uses some of the DMA channels itself, and reports which
+// ones the ARM may use through the TAG_GET_DMA_CHANNELS property tag.
+// Channels are given out from that set with dma_channel_alloc().
+//
+// Completion is found by polling the channel with dma_busy() or
+// dma_wait(). A block with DMA_TI_INTEN set also raises the channel's
+// interrupt when it ends, for use once the kernel handles interrupts.
+
+// Needed header files
+#include "mmio.h"
+#include "gpio.h"
+#include "mailbox.h"
+#include "dma.h"
+
+// The addresses of the DMA channel registers. Each of channels 0 to 14 has
+// a block of registers 0x100 bytes apart.
+//
+// These are defined in section 4 (DMA Controller) of the Broadcom BCM2837
+// ARM Peripherals Manual.
+#define DMA_BASE                (MMIO_BASE + 0x00007000)
+#define DMA_CS(channel)         (DMA_BASE + ((channel) * 0x100) + 0x00)
+#define DMA_CONBLK_AD(channel)  (DMA_BASE + ((channel) * 0x100) + 0x04)
+#define DMA_DEBUG(channel)      (DMA_BASE + ((channel) * 0x100) + 0x20)
+#define DMA_ENABLE              (DMA_BASE + 0x00000FF0)
+
+// Channel control and status bits
+#define DMA_CS_ACTIVE           (1 << 0)
+#define DMA_CS_END              (1 << 1)
+#define DMA_CS_INT              (1 << 2)
+#define DMA_CS_ERROR            (1 << 8)
+#define DMA_CS_PRIORITY(n)      ((n) << 16)
+#define DMA_CS_PANIC_PRIORITY(n) ((n) << 20)
+#define DMA_CS_WAIT_WRITES      (1 << 28)
+#define DMA_CS_RESET            (1U << 31)
+
+// The error bits of the debug register, cleared by writing them back
+#define DMA_DEBUG_ERRORS        0x7
+
+// Bursts of 4 words keep each transfer short enough that the video core's
+// own DMA is not held up
+#define DMA_BURST               4
+
+// The channels the ARM may use, and the ones it has allocated
+static unsigned int dmaUsable;
+static unsigned int dmaAllocated;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       dma_init
+//
+//  Arguments:      none
+//
+//  Returns:        TRUE (non-zero) if the video core reported the channels
+//                  the ARM may use, FALSE (zero) otherwise, in which case
+//                  no channel can be allocated
+//
+//  Description:    This function asks the video core which DMA channels are
+//                  free for the ARM, and enables them. It must be called
+//                  once, before any channel is allocated.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int dma_init()
+{
+    mailbox_buffer[0] = 7 * 4;
+    mailbox_buffer[1] = MAILBOX_REQUEST;
+
+    mailbox_buffer[2] = TAG_GET_DMA_CHANNELS;
+    mailbox_buffer[3] = 4;
+    mailbox_buffer[4] = 0;
+    mailbox_buffer[5] = 0;                      // Response: channel mask
+
+    mailbox_buffer[6] = TAG_LAST;
+
+    if (!mailbox_query(CHANNEL_PROPERTY_TAGS_ARMTOVC) ||
+        !(mailbox_buffer[4] & TAG_RESPONSE)) {
+        dmaUsable = 0;
+        return 0;
+    }
+
+    dmaUsable = mailbox_buffer[5] & ((1 << DMA_CHANNELS) - 1);
+    mmio_write(DMA_ENABLE, mmio_read(DMA_ENABLE) | dmaUsable);
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       dma_channel_alloc
+//
+//  Arguments:      flags:           DMA_CHANNEL_2D if the channel must be
+//                                   able to do 2D transfers, otherwise 0
+//
+//  Returns:        The channel number, or -1 if no suitable channel is free
+//
+//  Description:    This function allocates the lowest numbered free DMA
+//                  channel that the ARM may use, and resets it.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int dma_channel_alloc(unsigned int flags)
+{
+    int channel, last;
+
+
+    last = (flags & DMA_CHANNEL_2D) ? DMA_FIRST_LITE : DMA_CHANNELS;
+
+    for (channel = 0; channel < last; channel++) {
+        if ((dmaUsable & ~dmaAllocated) & (1 << channel)) {
+            dmaAllocated |= 1 << channel;
+            mmio_write(DMA_CS(channel), DMA_CS_RESET);
+            return channel;
+        }
+    }
+
+    return -1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       dma_channel_free
+//
+//  Arguments:      channel:         A channel from dma_channel_alloc()
+//
+//  Returns:        void
+//
+//  Description:    This function stops a channel and gives it back.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void dma_channel_free(int channel)
+{
+    if (channel < 0 || channel >= DMA_CHANNELS) {
+        return;
+    }
+
+    mmio_write(DMA_CS(channel), DMA_CS_RESET);
+    dmaAllocated &= ~(1 << channel);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       dma_block_copy
+//
+//  Arguments:      block:           The control block to fill in
+//                  destination:     Bus address to copy to
+//                  source:          Bus address to copy from
+//                  length:          The number of bytes to copy
+//
+//  Returns:        void
+//
+//  Description:    This function sets up a control block for a linear copy.
+//                  The block ends the chain until dma_block_chain() links
+//                  another block after it.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void dma_block_copy(struct DmaBlock *block, unsigned int destination,
+                    unsigned int source, unsigned int length)
+{
+    block->info = DMA_TI_SRC_INC | DMA_TI_DEST_INC | DMA_TI_WAIT_RESP |
+                  DMA_TI_BURST_LENGTH(DMA_BURST);
+    block->source = source;
+    block->destination = destination;
+    block->length = length;
+    block->stride = 0;
+    block->next = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       dma_block_copy_2d
+//
+//  Arguments:      block:           The control block to fill in
+//                  destination:     Bus address of the first destination row
+//                  destinationPitch: Bytes from one destination row to the
+//                                   next
+//                  source:          Bus address of the first source row
+//                  sourcePitch:     Bytes from one source row to the next
+//                  width:           Bytes per row, at most DMA_MAX_2D_BYTES
+//                  height:          Number of rows, 1 to DMA_MAX_2D_ROWS
+//
+//  Returns:        void
+//
+//  Description:    This function sets up a control block that copies a
+//                  rectangle, such as part of the frame buffer. The engine
+//                  adds a stride after each row, which is the pitch less
+//                  the width, and may be negative. The engine moves
+//                  YLENGTH + 1 rows, so the height is stored less one.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void dma_block_copy_2d(struct DmaBlock *block, unsigned int destination,
+                       unsigned int destinationPitch, unsigned int source,
+                       unsigned int sourcePitch, unsigned int width, unsigned int height)
+{
+    block->info = DMA_TI_TDMODE | DMA_TI_SRC_INC | DMA_TI_DEST_INC | DMA_TI_WAIT_RESP |
+                  DMA_TI_BURST_LENGTH(DMA_BURST);
+    block->source = source;
+    block->destination = destination;
+    block->length = ((height - 1) << 16) | width;
+    block->stride = (((destinationPitch - width) & 0xFFFF) << 16) |
+                    ((sourcePitch - width) & 0xFFFF);
+    block->next = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       dma_block_fill_2d
+//
+//  Arguments:      block:           The control block to fill in
+//                  destination:     Bus address of the first row
+//                  destinationPitch: Bytes from one row to the next
+//                  value:           The word to store, repeated
+//                  width:           Bytes per row, at most DMA_MAX_2D_BYTES
+//                  height:          Number of rows, 1 to DMA_MAX_2D_ROWS
+//
+//  Returns:        void
+//
+//  Description:    This function sets up a control block that fills a
+//                  rectangle with a repeated word. The word is kept in the
+//                  control block itself, in a field the engine does not
+//                  read, and the source address does not increment, so the
+//                  engine reads the same word over and over. Rows should
+//                  start on a word boundary for the word to line up.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void dma_block_fill_2d(struct DmaBlock *block, unsigned int destination,
+                       unsigned int destinationPitch, unsigned int value,
+                       unsigned int width, unsigned int height)
+{
+    dma_block_copy_2d(block, destination, destinationPitch, ARM_TO_BUS(&block->fill), 0,
+                      width, height);
+    block->info &= ~DMA_TI_SRC_INC;
+    block->stride &= 0xFFFF0000;
+    block->fill = value;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       dma_block_chain
+//
+//  Arguments:      block:           A control block
+//                  next:            The block to run after it, or 0 to end
+//                                   the chain with it
+//
+//  Returns:        void
+//
+//  Description:    This function links two control blocks. The engine runs
+//                  the next block as soon as one ends, without the CPU.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void dma_block_chain(struct DmaBlock *block, struct DmaBlock *next)
+{
+    block->next = next ? ARM_TO_BUS(next) : 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       dma_start
+//
+//  Arguments:      channel:         A channel from dma_channel_alloc()
+//                  block:           The first control block of the chain
+//
+//  Returns:        void
+//
+//  Description:    This function starts a chain of control blocks on an
+//                  idle channel, and returns at once. The MMU is off, so
+//                  nothing is cached, and the blocks and data the CPU wrote
+//                  are already in memory for the engine to read.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void dma_start(int channel, struct DmaBlock *block)
+{
+    // Clear the end and interrupt flags and any error left from before
+    mmio_write(DMA_CS(channel), DMA_CS_END | DMA_CS_INT);
+    mmio_write(DMA_DEBUG(channel), DMA_DEBUG_ERRORS);
+
+    mmio_write(DMA_CONBLK_AD(channel), ARM_TO_BUS(block));
+    mmio_write(DMA_CS(channel), DMA_CS_ACTIVE | DMA_CS_WAIT_WRITES | DMA_CS_PRIORITY(8) |
+                                DMA_CS_PANIC_PRIORITY(15));
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       dma_busy
+//
+//  Arguments:      channel:         A channel from dma_channel_alloc()
+//
+//  Returns:        TRUE (non-zero) while the channel is running a chain,
+//                  FALSE (zero) once it has finished
+//
+//  Description:    This function polls a channel without waiting.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int dma_busy(int channel)
+{
+    return mmio_read(DMA_CS(channel)) & DMA_CS_ACTIVE;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       dma_wait
+//
+//  Arguments:      channel:         A channel from dma_channel_alloc()
+//
+//  Returns:        TRUE (non-zero) if the chain finished without an error,
+//                  FALSE (zero) otherwise
+//
+//  Description:    This function waits for a channel to finish its chain.
+//                  It returns at once if the channel is idle.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int dma_wait(int channel)
+{
+    unsigned int status;
+
+
+    do {
+        status = mmio_read(DMA_CS(channel));
+    } while (status & DMA_CS_ACTIVE);
+
+    return !(status & DMA_CS_ERROR);
+}
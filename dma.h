@@ -0,0 +1,54 @@
+// A DMA control block, as read by the DMA engine. A transfer is described
+// by a chain of these, each giving the bus address of the next, and the
+// engine is started with the bus address of the first. Blocks must be
+// 32-byte aligned, and must not change while their transfer runs.
+struct DmaBlock {
+    unsigned int info;              // Transfer information (DMA_TI_ bits)
+    unsigned int source;            // Bus address to read from
+    unsigned int destination;       // Bus address to write to
+    unsigned int length;            // Bytes, or rows and bytes per row in 2D
+    unsigned int stride;            // Bytes skipped after each row in 2D
+    unsigned int next;              // Bus address of the next block, or 0
+    unsigned int fill;              // Not read by the engine. Holds the
+    unsigned int reserved;          // source word of dma_block_fill_2d().
+} __attribute__((aligned(32)));
+
+// Transfer information bits of a control block
+#define DMA_TI_INTEN            (1 << 0)    // Interrupt when this block ends
+#define DMA_TI_TDMODE           (1 << 1)    // 2D transfer
+#define DMA_TI_WAIT_RESP        (1 << 3)    // Wait for each write to finish
+#define DMA_TI_DEST_INC         (1 << 4)
+#define DMA_TI_DEST_WIDTH       (1 << 5)    // 128-bit writes
+#define DMA_TI_SRC_INC          (1 << 8)
+#define DMA_TI_SRC_WIDTH        (1 << 9)    // 128-bit reads
+#define DMA_TI_BURST_LENGTH(n)  ((n) << 12)
+#define DMA_TI_NO_WIDE_BURSTS   (1 << 26)
+
+// The largest 2D transfer: bytes per row, and rows
+#define DMA_MAX_2D_BYTES        0xFFFF
+#define DMA_MAX_2D_ROWS         0x4000
+
+// Channel 15 is not in the same register block, and channels 7 to 14 are
+// lite channels, which cannot do 2D transfers
+#define DMA_CHANNELS            15
+#define DMA_FIRST_LITE          7
+
+// Flags for dma_channel_alloc()
+#define DMA_CHANNEL_2D          1
+
+// Function prototypes
+int dma_init();
+int dma_channel_alloc(unsigned int flags);
+void dma_channel_free(int channel);
+void dma_block_copy(struct DmaBlock *block, unsigned int destination,
+                    unsigned int source, unsigned int length);
+void dma_block_copy_2d(struct DmaBlock *block, unsigned int destination,
+                       unsigned int destinationPitch, unsigned int source,
+                       unsigned int sourcePitch, unsigned int width, unsigned int height);
+void dma_block_fill_2d(struct DmaBlock *block, unsigned int destination,
+                       unsigned int destinationPitch, unsigned int value,
+                       unsigned int width, unsigned int height);
+void dma_block_chain(struct DmaBlock *block, struct DmaBlock *next);
+void dma_start(int channel, struct DmaBlock *block);
+int dma_busy(int channel);
+int dma_wait(int channel);
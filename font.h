@@ -0,0 +1,13 @@
+// Font dimensions in pixels
+#define FONT_WIDTH      8
+#define FONT_HEIGHT     16
+
+// The font covers the printable ASCII characters only
+#define FONT_FIRST      0x20
+#define FONT_LAST       0x7E
+#define FONT_GLYPHS     (FONT_LAST - FONT_FIRST + 1)
+
+
+// External declaration for the font bitmaps.
+// They are defined in font.c
+extern const unsigned char font[FONT_GLYPHS][FONT_HEIGHT];
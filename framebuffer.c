@@ -2,6 +2,9 @@
 #include "uart.h"
 #include "mailbox.h"
 #include "framebuffer.h"
+#include "pixelformat.h"
+#include "memops.h"
+#include "dma.h"
 
 // HTML RGB color codes.  These can be found at:
 // https://htmlcolorcodes.com/
@@ -25,17 +28,98 @@
 // Frame buffer constants
 #define FRAMEBUFFER_WIDTH      1024  // in pixels
 #define FRAMEBUFFER_HEIGHT     768   // in pixels
-#define FRAMEBUFFER_DEPTH      32    // bits per pixel (4 bytes per pixel)
 #define FRAMEBUFFER_ALIGNMENT  4     // framebuffer address preferred alignment
 #define VIRTUAL_X_OFFSET       0
 #define VIRTUAL_Y_OFFSET       0
-#define PIXEL_ORDER_BGR        0     // needed for the above color codes
+
+// The most palette entries one TAG_SET_PALETTE request can carry in the
+// 36-word mailbox buffer
+#define PALETTE_ENTRIES_PER_QUERY   28
 
 // Frame buffer global variables
 unsigned int frameBufferWidth, frameBufferHeight, frameBufferPitch;
+unsigned int frameBufferVirtualWidth, frameBufferVirtualHeight;
 unsigned int frameBufferDepth, frameBufferPixelOrder, frameBufferSize;
-unsigned int *frameBuffer;
+unsigned int frameBufferOffsetX, frameBufferOffsetY;
+unsigned char *frameBuffer;
+const struct PixelFormat *frameBufferFormat;
+
+// The palette, as RGB codes. Shared colors are given out from the bottom
+// and reserved ones from the top, so the shared ones can be searched
+// without meeting a reserved entry whose color may change.
+static unsigned int palette[FRAMEBUFFER_PALETTE_SIZE] = {
+    BLACK, WHITE, RED, LIME, BLUE, AQUA, FUCHSIA, YELLOW,
+    GRAY, MAROON, OLIVE, GREEN, TEAL, NAVY, PURPLE, SILVER
+};
+static unsigned int paletteShared = 16;
+static unsigned int paletteReserved = FRAMEBUFFER_PALETTE_SIZE;
+
+// Fills and copies offloaded to DMA are queued as control blocks, and run
+// as one chain by startFrameBufferDma(). The blocks cannot be changed
+// while the chain runs, so queueing more waits for it first.
+#define FRAMEBUFFER_DMA_BLOCKS      8
 
+static struct DmaBlock frameBufferDmaBlocks[FRAMEBUFFER_DMA_BLOCKS];
+static int frameBufferDmaChannel = -1;
+static int frameBufferDmaQueued;
+static int frameBufferDmaRunning;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       uploadPalette
+//
+//  Arguments:      first:           The first palette entry to send
+//                  count:           The number of entries to send
+//
+//  Returns:        TRUE (non-zero) if the video core took every entry,
+//                  FALSE (zero) otherwise.
+//
+//  Description:    This function sends palette entries to the video core
+//                  with the TAG_SET_PALETTE mailbox property tag, in as few
+//                  queries as the mailbox buffer allows. The video core
+//                  wants each entry as 0xAABBGGRR, the reverse of an RGB
+//                  code, and any change is on the screen straight away.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static int uploadPalette(unsigned int first, unsigned int count)
+{
+    unsigned int length, i, color;
+
+
+    while (count) {
+        length = count < PALETTE_ENTRIES_PER_QUERY ? count : PALETTE_ENTRIES_PER_QUERY;
+
+        mailbox_buffer[0] = (8 + length) * 4;
+        mailbox_buffer[1] = MAILBOX_REQUEST;
+
+        mailbox_buffer[2] = TAG_SET_PALETTE;
+        mailbox_buffer[3] = (2 + length) * 4;
+        mailbox_buffer[4] = 0;
+        mailbox_buffer[5] = first;              // First entry
+        mailbox_buffer[6] = length;             // Number of entries
+
+        for (i = 0; i < length; i++) {
+            color = palette[first + i];
+            mailbox_buffer[7 + i] = ((color >> 16) & 0xFF) | (color & 0xFF00) |
+                                    ((color & 0xFF) << 16);
+        }
+
+        mailbox_buffer[7 + length] = TAG_LAST;
+
+        // The response is 0 if the palette was accepted
+        if (!mailbox_query(CHANNEL_PROPERTY_TAGS_ARMTOVC) || mailbox_buffer[5] != 0) {
+            return 0;
+        }
+
+        first += length;
+        count -= length;
+    }
+
+    return 1;
+}
 
 
 
@@ -45,20 +129,67 @@ unsigned int *frameBuffer;
 //
 //  Arguments:      none
 //
-//  Returns:        void
+//  Returns:        TRUE (non-zero) if the frame buffer was allocated,
+//                  FALSE (zero) otherwise
+//
+//  Description:    This function allocates a frame buffer whose virtual size
+//                  is the same as the physical screen size.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int initFrameBuffer()
+{
+    return initFrameBufferVirtual(0, 0);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       initFrameBufferVirtual
+//
+//  Arguments:      virtualWidth:    Width of the frame buffer in pixels, or 0
+//                                   to use the physical screen width
+//                  virtualHeight:   Height of the frame buffer in pixels, or 0
+//                                   to use the physical screen height
+//
+//  Returns:        TRUE (non-zero) if the frame buffer was allocated,
+//                  FALSE (zero) otherwise, in which case frameBuffer is 0
+//                  and nothing may be drawn
 //
 //  Description:    This function uses the mailbox request/response protocol
 //                  to allocate and set the frame buffer. This includes the
 //                  width, height, and depth of the framebuffer, plus the
-//                  desired pixel order (BGR). The mailbox response is used
+//                  desired pixel order (BGR). The virtual frame buffer may be
+//                  larger than the physical screen, in which case the screen
+//                  shows a window into it, positioned with
+//                  setFrameBufferOffset(). The mailbox response is used
 //                  to set the frame buffer global variables that can be used
 //                  later on when drawing to the screen. The most important of
-//                  these is the frame buffer address.
+//                  these is the frame buffer address. The drawing functions
+//                  are then picked to match the depth and pixel order the
+//                  video core actually set up. If the video core cannot find
+//                  the memory for a large virtual size, it answers the query
+//                  but returns no address, so the caller can try a smaller
+//                  one.
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-void initFrameBuffer()
+int initFrameBufferVirtual(unsigned int virtualWidth, unsigned int virtualHeight)
 {
+    if (virtualWidth == 0) {
+        virtualWidth = FRAMEBUFFER_WIDTH;
+    }
+    if (virtualHeight == 0) {
+        virtualHeight = FRAMEBUFFER_HEIGHT;
+    }
+
+    // Nothing may still be drawing into an old frame buffer
+    waitFrameBufferDma();
+
+    // The format asked for, kept if the query fails
+    frameBufferFormat = findPixelFormat(FRAMEBUFFER_DEPTH, PIXEL_ORDER_BGR);
+
     // Initialize the mailbox data structure.
     // It contains a series of tags that specify the
     // desired settings for the frame buffer.
@@ -74,8 +205,8 @@ void initFrameBuffer()
     mailbox_buffer[7] = TAG_SET_VIRTUAL_WIDTH_HEIGHT;
     mailbox_buffer[8] = 8;
     mailbox_buffer[9] = 0;
-    mailbox_buffer[10] = FRAMEBUFFER_WIDTH;
-    mailbox_buffer[11] = FRAMEBUFFER_HEIGHT;
+    mailbox_buffer[10] = virtualWidth;
+    mailbox_buffer[11] = virtualHeight;
 
     mailbox_buffer[12] = TAG_SET_VIRTUAL_OFFSET;
     mailbox_buffer[13] = 8;
@@ -91,7 +222,7 @@ void initFrameBuffer()
     mailbox_buffer[21] = TAG_SET_PIXEL_ORDER;
     mailbox_buffer[22] = 4;
     mailbox_buffer[23] = 0;
-    mailbox_buffer[24] = PIXEL_ORDER_BGR;
+    mailbox_buffer[24] = PIXEL_ORDER_BGR;   // Needed for the above color codes
 
     mailbox_buffer[25] = TAG_ALLOCATE_BUFFER;
     mailbox_buffer[26] = 8;
@@ -108,22 +239,45 @@ void initFrameBuffer()
     mailbox_buffer[34] = TAG_LAST;
 
 
-    // Make a mailbox request using the above mailbox data structure
-    if (mailbox_query(CHANNEL_PROPERTY_TAGS_ARMTOVC)) {
+    // Make a mailbox request using the above mailbox data structure. The
+    // query can succeed without the buffer being allocated, so the
+    // allocate tag's own response and address are checked too.
+    if (mailbox_query(CHANNEL_PROPERTY_TAGS_ARMTOVC) &&
+        (mailbox_buffer[27] & TAG_RESPONSE) && (mailbox_buffer[28] & 0x3FFFFFFF) != 0) {
 	// If here, the query succeeded, and we can check the response
 
 	// Get the returned frame buffer address, masking out 2 upper bits
         mailbox_buffer[28] &= 0x3FFFFFFF;
-        frameBuffer = (void *)((unsigned long)mailbox_buffer[28]);
+        frameBuffer = (unsigned char *)((unsigned long)mailbox_buffer[28]);
 
 	// Read the frame buffer settings from the mailbox buffer
         frameBufferWidth = mailbox_buffer[5];
         frameBufferHeight = mailbox_buffer[6];
+        frameBufferVirtualWidth = mailbox_buffer[10];
+        frameBufferVirtualHeight = mailbox_buffer[11];
         frameBufferPitch = mailbox_buffer[33];
 	frameBufferDepth = mailbox_buffer[20];
 	frameBufferPixelOrder = mailbox_buffer[24];
 	frameBufferSize = mailbox_buffer[29];
 
+	// Pick the drawing functions for the depth and pixel order the
+	// video core chose, which may not be the ones asked for
+	frameBufferFormat = findPixelFormat(frameBufferDepth, frameBufferPixelOrder);
+	if (!frameBufferFormat) {
+	    uart_puts("Unsupported frame buffer depth\n");
+	    frameBufferFormat = findPixelFormat(32, PIXEL_ORDER_BGR);
+	}
+
+	// Load the whole palette, since the firmware's default is unknown
+	if (frameBufferDepth == 8) {
+	    uploadPalette(0, FRAMEBUFFER_PALETTE_SIZE);
+	}
+
+	// Take a DMA channel for offloaded fills and copies, if there is one
+	if (frameBufferDmaChannel < 0) {
+	    frameBufferDmaChannel = dma_channel_alloc(DMA_CHANNEL_2D);
+	}
+
 	// Display frame buffer settings to the terminal
 	// uart_puts("Frame buffer settings:\n");
 	//
@@ -155,8 +309,95 @@ void initFrameBuffer()
 	// uart_puthex(frameBufferSize);
 	// uart_puts(" bytes\n");
 
-    } else {
-        uart_puts("Cannot initialize frame buffer\n");
+        return 1;
+    }
+
+    uart_puts("Cannot initialize frame buffer\n");
+    frameBuffer = 0;
+    frameBufferSize = 0;
+
+    return 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       setFrameBufferOffset
+//
+//  Arguments:      x:               Left pixel x coordinate of the window
+//                  y:               Top pixel y coordinate of the window
+//
+//  Returns:        TRUE (non-zero) if the video core moved the window,
+//                  FALSE (zero) otherwise.
+//
+//  Description:    This function sets which part of the virtual frame buffer
+//                  is shown on the screen, using the TAG_SET_VIRTUAL_OFFSET
+//                  mailbox property tag. No pixels are copied, so scrolling
+//                  this way costs a single mailbox query. The window position
+//                  is kept in frameBufferOffsetX and frameBufferOffsetY.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int setFrameBufferOffset(unsigned int x, unsigned int y)
+{
+    mailbox_buffer[0] = 8 * 4;
+    mailbox_buffer[1] = MAILBOX_REQUEST;
+
+    mailbox_buffer[2] = TAG_SET_VIRTUAL_OFFSET;
+    mailbox_buffer[3] = 8;
+    mailbox_buffer[4] = 0;
+    mailbox_buffer[5] = x;
+    mailbox_buffer[6] = y;
+
+    mailbox_buffer[7] = TAG_LAST;
+
+    frameBufferOffsetX = x;
+    frameBufferOffsetY = y;
+
+    return mailbox_query(CHANNEL_PROPERTY_TAGS_ARMTOVC);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       drawRectToFrameBuffer
+//
+//  Arguments:      rowStart:        Top left pixel y coordinate
+//                  columnStart:     Top left pixel x coordinate
+//                  width:           Rectangle width in pixels
+//                  height:          Rectangle height in pixels
+//                  color:           RGB color code
+//
+//  Returns:        void
+//
+//  Description:    This function draws a solid rectangle into the frame
+//                  buffer. Rows are addressed using the frame buffer pitch,
+//                  so this works anywhere in a virtual frame buffer. The
+//                  color is converted once, and each row is filled by the
+//                  pixel format's fill function, which for 8 and 32 bits
+//                  per pixel is memset() or memset32(), storing 64 bytes
+//                  per loop.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void drawRectToFrameBuffer(int rowStart, int columnStart, int width, int height, unsigned int color)
+{
+    unsigned char *pixel = FRAMEBUFFER_PIXEL(columnStart, rowStart);
+    int row;
+
+
+    if (width <= 0) {
+        return;
+    }
+
+    color = frameBufferFormat->color(color);
+
+    // Fill the rectangle row by row, from the top down
+    for (row = 0; row < height; row++) {
+        frameBufferFormat->fill(pixel, color, width);
+        pixel += frameBufferPitch;
     }
 }
 
@@ -184,23 +425,418 @@ void initFrameBuffer()
 
 void drawSquareToFrameBuffer(int rowStart, int columnStart, int squareSize, unsigned int color)
 {
-    int row, column, rowEnd, columnEnd;
-    unsigned int *pixel = frameBuffer;
+    drawRectToFrameBuffer(rowStart, columnStart, squareSize, squareSize, color);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       nextFrameBufferDmaBlock
+//
+//  Arguments:      none
+//
+//  Returns:        A control block to add to the queued chain
+//
+//  Description:    This function waits for a running chain to finish, since
+//                  its blocks are reused, and runs the queued chain first
+//                  if it is already full.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static struct DmaBlock *nextFrameBufferDmaBlock()
+{
+    waitFrameBufferDma();
 
+    if (frameBufferDmaQueued == FRAMEBUFFER_DMA_BLOCKS) {
+        startFrameBufferDma();
+        waitFrameBufferDma();
+    }
+
+    return &frameBufferDmaBlocks[frameBufferDmaQueued++];
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       queueRectToFrameBuffer
+//
+//  Arguments:      rowStart:        Top left pixel y coordinate
+//                  columnStart:     Top left pixel x coordinate
+//                  width:           Rectangle width in pixels
+//                  height:          Rectangle height in pixels
+//                  color:           RGB color code
+//
+//  Returns:        TRUE (non-zero) if the fill was queued for DMA, FALSE
+//                  (zero) if it has been drawn by the CPU instead
+//
+//  Description:    This function queues a solid rectangle to be filled by
+//                  the DMA engine from a repeated word, when
+//                  startFrameBufferDma() is called. At 24 bits per pixel a
+//                  pixel does not fit a repeated word, and without a DMA
+//                  channel, or for a rectangle too large for one transfer,
+//                  the work queued so far is finished and the rectangle is
+//                  drawn at once with drawRectToFrameBuffer().
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int queueRectToFrameBuffer(int rowStart, int columnStart, int width, int height,
+                           unsigned int color)
+{
+    unsigned int bytes = frameBufferFormat->bytes;
+    unsigned int pixel;
 
-    // Calculate where the row and columns end
-    rowEnd = rowStart + squareSize;
-    columnEnd = columnStart + squareSize;
 
-    // Draw the square row by row, from the top down
-    for (row = rowStart; row < rowEnd; row++) {
-	// Draw each pixel in the row from left to right
-        for (column = columnStart; column < columnEnd; column++) {
-	    // Draw the individual pixel by setting its
-	    // RGB value in the frame buffer
-            pixel[(row * frameBufferWidth) + column] = color;
+    if (frameBufferDmaChannel < 0 || bytes == 3 || width <= 0 || height <= 0 ||
+        width * bytes > DMA_MAX_2D_BYTES || height > DMA_MAX_2D_ROWS) {
+        startFrameBufferDma();
+        waitFrameBufferDma();
+        drawRectToFrameBuffer(rowStart, columnStart, width, height, color);
+        return 0;
+    }
+
+    // Repeat the pixel to fill a word
+    pixel = frameBufferFormat->color(color);
+    if (bytes == 1) {
+        pixel *= 0x01010101;
+    } else if (bytes == 2) {
+        pixel |= pixel << 16;
+    }
+
+    dma_block_fill_2d(nextFrameBufferDmaBlock(),
+                      ARM_TO_BUS(FRAMEBUFFER_PIXEL(columnStart, rowStart)),
+                      frameBufferPitch, pixel, width * bytes, height);
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       queueBlit
+//
+//  Arguments:      destination:     The first pixel to copy to
+//                  destinationPitch: Bytes from one destination row to the
+//                                   next
+//                  source:          The first pixel to copy from
+//                  sourcePitch:     Bytes from one source row to the next
+//                  rowBytes:        Bytes to copy from each row
+//                  height:          Number of rows
+//
+//  Returns:        TRUE (non-zero) if the copy was queued for DMA, FALSE
+//                  (zero) if it has been done by the CPU instead
+//
+//  Description:    This function queues a copy of a rectangle of pixels
+//                  between any memory the DMA engine can reach, such as the
+//                  frame buffer and off-screen surfaces. The rectangles
+//                  must not overlap. Queued copies run in order when
+//                  startFrameBufferDma() is called, so a copy may read what
+//                  an earlier one wrote. Without a DMA channel, or for a
+//                  rectangle too large for one transfer, the work queued so
+//                  far is finished and the rows are copied at once with
+//                  memcpy().
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int queueBlit(unsigned char *destination, unsigned int destinationPitch,
+              const unsigned char *source, unsigned int sourcePitch,
+              unsigned int rowBytes, int height)
+{
+    int row;
+
+
+    if (frameBufferDmaChannel < 0 || rowBytes == 0 || height <= 0 ||
+        rowBytes > DMA_MAX_2D_BYTES || height > DMA_MAX_2D_ROWS) {
+        startFrameBufferDma();
+        waitFrameBufferDma();
+        for (row = 0; row < height; row++) {
+            memcpy(destination, source, rowBytes);
+            destination += destinationPitch;
+            source += sourcePitch;
+        }
+        return 0;
+    }
+
+    dma_block_copy_2d(nextFrameBufferDmaBlock(), ARM_TO_BUS(destination), destinationPitch,
+                      ARM_TO_BUS(source), sourcePitch, rowBytes, height);
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       queueCopyInFrameBuffer
+//
+//  Arguments:      rowStart:        Top left pixel y coordinate to copy to
+//                  columnStart:     Top left pixel x coordinate to copy to
+//                  sourceRow:       Top left pixel y coordinate to copy from
+//                  sourceColumn:    Top left pixel x coordinate to copy from
+//                  width:           Rectangle width in pixels
+//                  height:          Rectangle height in pixels
+//
+//  Returns:        TRUE (non-zero) if the copy was queued for DMA, FALSE
+//                  (zero) if it has been done by the CPU instead
+//
+//  Description:    This function queues a copy of a rectangle from one part
+//                  of the frame buffer to another, which must not overlap,
+//                  with queueBlit().
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int queueCopyInFrameBuffer(int rowStart, int columnStart, int sourceRow, int sourceColumn,
+                           int width, int height)
+{
+    if (width <= 0) {
+        return 0;
+    }
+
+    return queueBlit(FRAMEBUFFER_PIXEL(columnStart, rowStart), frameBufferPitch,
+                     FRAMEBUFFER_PIXEL(sourceColumn, sourceRow), frameBufferPitch,
+                     width * frameBufferFormat->bytes, height);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       startFrameBufferDma
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function chains the queued fills and copies and
+//                  starts the DMA engine on them, then returns at once, so
+//                  the CPU can carry on with other work. Nothing should be
+//                  drawn by the CPU where they write until
+//                  waitFrameBufferDma() has returned, or
+//                  frameBufferDmaBusy() reports they are done.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void startFrameBufferDma()
+{
+    int i;
+
+
+    if (frameBufferDmaQueued == 0) {
+        return;
+    }
+
+    for (i = 0; i < frameBufferDmaQueued - 1; i++) {
+        dma_block_chain(&frameBufferDmaBlocks[i], &frameBufferDmaBlocks[i + 1]);
+    }
+
+    dma_start(frameBufferDmaChannel, frameBufferDmaBlocks);
+    frameBufferDmaRunning = 1;
+    frameBufferDmaQueued = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       frameBufferDmaBusy
+//
+//  Arguments:      none
+//
+//  Returns:        TRUE (non-zero) while started fills and copies are still
+//                  running, FALSE (zero) once they are done
+//
+//  Description:    This function polls the DMA engine without waiting.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int frameBufferDmaBusy()
+{
+    if (frameBufferDmaRunning && !dma_busy(frameBufferDmaChannel)) {
+        waitFrameBufferDma();
+    }
+
+    return frameBufferDmaRunning;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       waitFrameBufferDma
+//
+//  Arguments:      none
+//
+//  Returns:        TRUE (non-zero) if the started fills and copies finished
+//                  without an error, or none were running, FALSE (zero)
+//                  otherwise
+//
+//  Description:    This function waits for the started fills and copies to
+//                  finish. Fills and copies that are queued but not started
+//                  are left queued.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int waitFrameBufferDma()
+{
+    if (!frameBufferDmaRunning) {
+        return 1;
+    }
+
+    frameBufferDmaRunning = 0;
+    if (!dma_wait(frameBufferDmaChannel)) {
+        uart_puts("Frame buffer DMA error\n");
+        return 0;
+    }
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       frameBufferColor
+//
+//  Arguments:      color:           RGB color code
+//
+//  Returns:        The pixel value to store for the color
+//
+//  Description:    This function converts an RGB color code into a pixel
+//                  in the frame buffer's pixel format. Drawing code converts
+//                  a color once, not for every pixel.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int frameBufferColor(unsigned int color)
+{
+    return frameBufferFormat->color(color);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       frameBufferPaletteColor
+//
+//  Arguments:      color:           RGB color code
+//
+//  Returns:        The palette entry holding the color
+//
+//  Description:    This function is the color conversion of the 8 bits per
+//                  pixel format. The color is added to the palette the
+//                  first time it is used. Once the palette is full, the
+//                  nearest color is used.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int frameBufferPaletteColor(unsigned int color)
+{
+    static unsigned int lastColor = BLACK, lastPixel = 0;
+    unsigned int i, best = 0, bestDistance = ~0U, distance;
+    int red, green, blue;
+
+
+    color &= 0x00FFFFFF;
+
+    // Colors are mostly converted several times in a row
+    if (color == lastColor) {
+        return lastPixel;
+    }
+
+    for (i = 0; i < paletteShared; i++) {
+        if (palette[i] == color) {
+            break;
+        }
+    }
+
+    if (i == paletteShared) {
+        if (paletteShared < paletteReserved) {
+            palette[paletteShared++] = color;
+            uploadPalette(i, 1);
+        } else {
+            // The palette is full, so find the nearest shared color
+            for (i = 0; i < paletteShared; i++) {
+                red = (int)((palette[i] >> 16) & 0xFF) - (int)((color >> 16) & 0xFF);
+                green = (int)((palette[i] >> 8) & 0xFF) - (int)((color >> 8) & 0xFF);
+                blue = (int)(palette[i] & 0xFF) - (int)(color & 0xFF);
+                distance = (red * red) + (green * green) + (blue * blue);
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    best = i;
+                }
+            }
+            i = best;
         }
     }
+
+    lastColor = color;
+    lastPixel = i;
+
+    return i;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       reserveFrameBufferColor
+//
+//  Arguments:      color:           RGB color code to start with
+//
+//  Returns:        The pixel value to store for the color
+//
+//  Description:    This function sets aside a palette entry of its own for
+//                  a color that will be changed later with
+//                  setFrameBufferPaletteColor(), such as a flashing tile.
+//                  Other colors never share the entry. Without a palette,
+//                  or when the palette is full, it is the same as
+//                  frameBufferColor().
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int reserveFrameBufferColor(unsigned int color)
+{
+    if (frameBufferFormat->depth != 8 || paletteReserved <= paletteShared) {
+        return frameBufferColor(color);
+    }
+
+    palette[--paletteReserved] = color & 0x00FFFFFF;
+    uploadPalette(paletteReserved, 1);
+
+    return paletteReserved;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       setFrameBufferPaletteColor
+//
+//  Arguments:      pixel:           A pixel value from
+//                                   reserveFrameBufferColor()
+//                  color:           Its new RGB color code
+//
+//  Returns:        TRUE (non-zero) if every pixel of that value now shows
+//                  the new color, FALSE (zero) if nothing changed on the
+//                  screen, which is always the case without a palette
+//
+//  Description:    This function changes a reserved palette entry. It is a
+//                  single mailbox query, however many pixels it recolors.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int setFrameBufferPaletteColor(unsigned int pixel, unsigned int color)
+{
+    if (frameBufferFormat->depth != 8 || pixel < paletteReserved ||
+        pixel >= FRAMEBUFFER_PALETTE_SIZE) {
+        return 0;
+    }
+
+    palette[pixel] = color & 0x00FFFFFF;
+
+    return uploadPalette(pixel, 1);
 }
 
 
@@ -1,3 +1,53 @@
-void initFrameBuffer();
+// The frame buffer depth in bits per pixel to ask the video core for,
+// chosen when the kernel is built (make FRAMEBUFFER_DEPTH=16). It may be
+// 8, 16, 24 or 32. At 8 bits a pixel is an index into a palette of 256
+// colors, and every pixel of a color can be changed at once by changing
+// its palette entry. The pixel format actually used is the one for the
+// depth and pixel order the video core sets up (see pixelformat.h).
+#ifndef FRAMEBUFFER_DEPTH
+#define FRAMEBUFFER_DEPTH      32
+#endif
+
+#if FRAMEBUFFER_DEPTH != 8 && FRAMEBUFFER_DEPTH != 16 && \
+    FRAMEBUFFER_DEPTH != 24 && FRAMEBUFFER_DEPTH != 32
+#error "FRAMEBUFFER_DEPTH must be 8, 16, 24 or 32"
+#endif
+
+// The number of palette entries at 8 bits per pixel
+#define FRAMEBUFFER_PALETTE_SIZE   256
+
+// The address of a pixel in the frame buffer. This needs pixelformat.h.
+#define FRAMEBUFFER_PIXEL(x, y)    (frameBuffer + ((y) * frameBufferPitch) + \
+                                    ((x) * frameBufferFormat->bytes))
+
+int initFrameBuffer();
+int initFrameBufferVirtual(unsigned int virtualWidth, unsigned int virtualHeight);
+int setFrameBufferOffset(unsigned int x, unsigned int y);
 // void displayFrameBuffer();
+void drawRectToFrameBuffer(int rowStart, int columnStart, int width, int height, unsigned int color);
 void drawSquareToFrameBuffer(int, int, int, unsigned int);
+int queueRectToFrameBuffer(int rowStart, int columnStart, int width, int height,
+                           unsigned int color);
+int queueBlit(unsigned char *destination, unsigned int destinationPitch,
+              const unsigned char *source, unsigned int sourcePitch,
+              unsigned int rowBytes, int height);
+int queueCopyInFrameBuffer(int rowStart, int columnStart, int sourceRow, int sourceColumn,
+                           int width, int height);
+void startFrameBufferDma();
+int frameBufferDmaBusy();
+int waitFrameBufferDma();
+unsigned int frameBufferColor(unsigned int color);
+unsigned int frameBufferPaletteColor(unsigned int color);
+unsigned int reserveFrameBufferColor(unsigned int color);
+int setFrameBufferPaletteColor(unsigned int pixel, unsigned int color);
+
+
+// External declarations for the frame buffer settings and pixel format.
+// They are set by initFrameBufferVirtual() and setFrameBufferOffset()
+// in framebuffer.c
+extern unsigned int frameBufferWidth, frameBufferHeight, frameBufferPitch;
+extern unsigned int frameBufferVirtualWidth, frameBufferVirtualHeight;
+extern unsigned int frameBufferDepth, frameBufferPixelOrder, frameBufferSize;
+extern unsigned int frameBufferOffsetX, frameBufferOffsetY;
+extern unsigned char *frameBuffer;
+extern const struct PixelFormat *frameBufferFormat;
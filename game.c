@@ -0,0 +1,707 @@
+// The functions in this file implement the maze game itself: the maze, the
+// character, the HUD, and what each controller button does. The game runs
+// one frame each time game_frame() is called with the controller state. It
+// does not read the controller or wait between frames itself, so the same
+// code runs on the Raspberry Pi (see main.c) and in the host build (see
+// host/host.c).
+
+
+// Include files
+#include "uart.h"
+#include "kprintf.h"
+#include "systimer.h"
+#include "framebuffer.h"
+#include "text.h"
+#include "console.h"
+#include "tiles.h"
+#include "cursor.h"
+#include "maze.h"
+#include "mazegen.h"
+#include "viewport.h"
+#include "solver.h"
+#include "graph.h"
+#include "memory.h"
+#include "game.h"
+
+
+// Function prototypes
+void drawMaze();
+void followCharacter(int x, int y);
+void drawCharacter(int x, int y, int sprite);
+void eraseCharacter();
+void hideCharacter();
+void drawHUD(int moves, unsigned int distance);
+void setExitColor(unsigned int color);
+
+
+//Defines
+#define MAZEX 16
+#define MAZEY 12
+#define SIZE 64
+
+//Size of the generated levels, in cells. Generated mazes have odd sizes,
+//and levels larger than the screen are scrolled to follow the character.
+#define LEVELX 127
+#define LEVELY 95
+
+//Size of the maze storage, which holds either the maze above or a level
+#define STOREX ((LEVELX > MAZEX) ? LEVELX : MAZEX)
+#define STOREY ((LEVELY > MAZEY) ? LEVELY : MAZEY)
+
+#define HUDX 16
+#define HUDY 24
+#define HUDCELLS 3
+
+//Colors of the exit: flashing between the first two while a game is
+//played, every EXITFLASHFRAMES frames, and the last once it is reached
+#define EXITCOLOR 0x00FFFF00
+#define EXITDIM 0x00808000
+#define EXITWIN 0x0000FF00
+#define EXITFLASHFRAMES 8
+
+#define FALSE 0
+#define TRUE 1
+
+#define NUMBUTTONS 8
+
+struct Button {
+    int number;
+    char* name;
+};
+
+struct Point {
+    int x;
+    int y;
+};
+
+
+void loadMaze();
+void generateMaze();
+void solveGraph();
+
+struct Button createButton(int number, char* name);
+struct Point createPoint(int x, int y);
+
+void printPoint(const struct Point *p);
+
+//The controller buttons the game uses
+struct Button buttons[NUMBUTTONS];
+
+//The controller state seen on the last frame
+unsigned short currentState;
+
+//Whether a game has been started, the number of moves made in it,
+//and the place of the character
+int gameInProgress;
+int moves;
+struct Point character;
+
+struct Point exitPoint;
+struct Point entrancePoint;
+
+//The maze background saved from under the character sprite
+struct SpriteSave characterSave;
+
+//How much optional drawing to do, and what the HUD last showed and where.
+//At reduced detail the HUD is only drawn again when one of these changes.
+int detail;
+int hudMoves;
+unsigned int hudDistance;
+int hudCameraX;
+int hudCameraY;
+
+//The frames run so far, and the current color of the exit
+unsigned int frameCount;
+unsigned int exitColor;
+
+//Whether the character is shown with the hardware cursor, which sprite
+//the cursor image holds, and whether the character is currently drawn
+int hardwareCursor;
+int cursorSprite;
+int characterDrawn;
+
+//The maze, kept as a wall bitset with precomputed neighbor masks.
+//The storage is taken from the memory arena in game_init(), sized for
+//the mazes the game uses, not the largest one the generator can build
+struct Maze maze;
+unsigned long *mazeWalls;
+unsigned char *mazeNeighbors;
+unsigned int mazeSeed;
+
+//The screen-sized view of the maze, which scrolls to follow the character
+struct Viewport view;
+
+//The distance from every cell to the exit, for hints and auto-solving.
+//The generated levels are the largest mazes played, so they set the size
+struct Solver solver;
+unsigned int *solverDistance;
+unsigned int *solverQueue;
+int autoSolve;
+
+//The maze collapsed into a graph of junctions and corridors. In a
+//generated maze only rooms, the entrance and the exit can be nodes
+#define GRAPHNODES ((((LEVELX - 1) / 2) * ((LEVELY - 1) / 2)) + 2)
+struct Graph graph;
+unsigned int *graphMemory;
+unsigned char graphPath[LEVELX * LEVELY];
+
+const int mazeLayout[MAZEY][MAZEX] = {
+							{1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
+							{1, 0, 1, 0, 1, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1},
+							{2, 0, 0, 0, 1, 0, 1, 0, 1, 0, 0, 0, 1, 1, 0, 1},
+							{1, 0, 1, 1, 1, 0, 1, 0, 1, 1, 1, 1, 1, 1, 0, 1},
+							{1, 0, 0, 1, 0, 0, 1, 0, 0, 0, 0, 0, 0, 1, 0, 1},
+							{1, 1, 0, 0, 0, 1, 1, 1, 1, 1, 0, 1, 1, 1, 0, 1},
+							{1, 0, 0, 1, 0, 1, 0, 0, 0, 1, 0, 1, 0, 0, 0, 1},
+							{1, 0, 1, 1, 0, 1, 0, 1, 1, 1, 0, 1, 0, 1, 1, 1},
+							{1, 0, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 3},
+							{1, 1, 0, 1, 0, 0, 0, 1, 0, 1, 0, 1, 1, 1, 0, 1},
+							{1, 0, 0, 1, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 1},
+							{1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}};
+
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       game_init
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function sets up the frame buffer, the console and the
+//                  tiles, loads the starting maze, and draws it. It must be
+//                  called once, after uart_init(), before any call to
+//                  game_frame().
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void game_init()
+{
+	//Allocate the scrolling maze view, plus two screens below it for the console.
+	//If the video core cannot find that much memory, go without the console,
+	//whose output still goes to the UART
+	if (initFrameBufferVirtual(VIEWPORT_REGION_WIDTH(MAZEX), VIEWPORT_REGION_HEIGHT(MAZEY) + (MAZEY * SIZE * 2))) {
+		console_init(VIEWPORT_REGION_HEIGHT(MAZEY));
+	} else if (initFrameBufferVirtual(VIEWPORT_REGION_WIDTH(MAZEX), VIEWPORT_REGION_HEIGHT(MAZEY))) {
+		uart_puts("Not enough video memory for the console, using the UART only\n");
+	} else {
+		uart_puts("Not enough video memory for the maze view\n");
+		while (1);
+	}
+
+	//Decode the maze tiles and character sprites
+	tiles_init();
+
+	//Upload the character as the hardware cursor image. If the firmware
+	//rejects it, the character is drawn into the frame buffer instead.
+	hardwareCursor = cursor_set_image(tilePixels(SPRITE_CHARACTER), TILE_SIZE, TILE_SIZE, TILE_TRANSPARENT);
+	cursorSprite = SPRITE_CHARACTER;
+	characterDrawn = FALSE;
+	if (!hardwareCursor) {
+		uart_puts("Hardware cursor unavailable, drawing the character in software\n");
+	}
+
+    buttons[0] = createButton(3, "Start");
+    buttons[1] = createButton(4, "Up");
+    buttons[2] = createButton(5, "Down");
+    buttons[3] = createButton(6, "Left");
+    buttons[4] = createButton(7, "Right");
+    buttons[5] = createButton(9, "X");
+    buttons[6] = createButton(2, "Select");
+    buttons[7] = createButton(1, "Y");
+
+    // Print out a message to the console
+    uart_puts("Maze game starting. Press Select to show the console.\n");
+
+	//No game has been started yet, and no buttons are known to be pressed
+	gameInProgress = FALSE;
+	moves = 0;
+	currentState = 0xFFFF;
+
+	//Draw everything until told to cut back, starting with the HUD
+	detail = GAME_DETAIL_FULL;
+	hudMoves = -1;
+	frameCount = 0;
+	exitColor = EXITCOLOR;
+
+	//Take the maze, solver and graph storage from the memory arena. It
+	//is kept for as long as the game runs
+	mazeWalls = memory_alloc(MAZE_WALL_WORDS(STOREX, STOREY) * sizeof(unsigned long));
+	mazeNeighbors = memory_alloc(MAZE_NEIGHBOR_BYTES(STOREX, STOREY));
+	solverDistance = memory_alloc(LEVELX * LEVELY * sizeof(unsigned int));
+	solverQueue = memory_alloc(LEVELX * LEVELY * sizeof(unsigned int));
+	graphMemory = memory_alloc(GRAPH_MEMORY_WORDS(GRAPHNODES) * sizeof(unsigned int));
+	if (!mazeWalls || !mazeNeighbors || !solverDistance || !solverQueue || !graphMemory) {
+		uart_puts("Not enough memory for the maze\n");
+		while (1);
+	}
+
+	//Build the maze, and find the entrance and exit points
+	loadMaze();
+	viewport_init(&view, &maze, MAZEX, MAZEY, 0);
+	solver_init(&solver, &maze, solverDistance, solverQueue, LEVELX * LEVELY);
+	graph_init(&graph, &maze, graphMemory, GRAPHNODES);
+	autoSolve = FALSE;
+
+	//The character is not placed until a game starts
+	character = createPoint(-1, -1);
+
+	drawMaze();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       game_frame
+//
+//  Arguments:      data:            The controller button presses, encoded
+//                                   as returned by get_SNES()
+//
+//  Returns:        void
+//
+//  Description:    This function runs one frame of the game. When the
+//                  controller state changes, the pressed buttons are acted on.
+//                  Then auto-solve makes its move, the view follows the
+//                  character, and the character and HUD are drawn.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void game_frame(unsigned short data)
+{
+	//The direction of a move, whether the maze is open that way,
+	//and whether the controller state has changed
+	int direction, open, changed;
+	unsigned int distance;
+
+
+	//Act on the buttons when the state of the controller has changed,
+	//unless they have all just been released
+	changed = (data != currentState) && (data != 0);
+
+	// Record the state of the controller
+	currentState = data;
+	frameCount++;
+
+	if (changed) {
+
+		//Erase the character, so it is drawn again in its new place
+		eraseCharacter();
+
+        for(int i = 0; i < NUMBUTTONS; i++) {
+            if(((1 << buttons[i].number) & data) != 0) {
+                //The game is paused while the console is shown
+                if(console_is_visible() && buttons[i].number != 2) {
+                    continue;
+                }
+
+                switch(buttons[i].number) {
+                    // Start
+                    case 3 :
+					if(gameInProgress == FALSE){
+						character.x = entrancePoint.x;
+						character.y = entrancePoint.y;
+						// character.x = 2;//Hard code, talke out later
+						// character.y = 0;//Hard code, take out later
+						gameInProgress = TRUE;
+						moves = 0;
+						uart_puts("Game started\n");
+					}
+                    break;
+
+                    // Up, Down, Left and Right. The button numbers are in
+                    // the same order as the maze directions.
+                    case 4 :
+                    case 5 :
+                    case 6 :
+                    case 7 :
+                    if(gameInProgress == TRUE) {
+                        direction = buttons[i].number - 4;
+                        open = maze_can_move(&maze, character.x, character.y, direction);
+                        character.x += directionX[direction] * open;
+                        character.y += directionY[direction] * open;
+                        moves += open;
+                    }
+                    break;
+
+                    // Y
+                    case 1 :
+                    //Toggle auto-solve, starting a game if needed
+                    autoSolve = !autoSolve;
+                    if(autoSolve && gameInProgress == FALSE) {
+                        character.x = entrancePoint.x;
+                        character.y = entrancePoint.y;
+                        gameInProgress = TRUE;
+                        moves = 0;
+                        uart_puts("Game started\n");
+                    }
+                    break;
+
+                    // Select
+                    case 2 :
+                    console_show(!console_is_visible());
+                    eraseCharacter();
+                    break;
+
+                    // X
+                    case 9 :
+                    //Replace the maze with a newly generated one
+                    hideCharacter();
+                    generateMaze();
+                    viewport_jump(&view, entrancePoint.x, entrancePoint.y);
+                    hudMoves = -1;
+                    gameInProgress = FALSE;
+                    character = createPoint(-1, -1);
+                	break;
+
+                    default :
+                    break;
+                }
+            }
+        }
+
+
+	}
+
+		//Let the solver drive the character, one move per frame
+		if (autoSolve && gameInProgress && !console_is_visible()){
+			direction = solver_next_move(&solver, character.x, character.y);
+			if (direction != SOLVER_NO_MOVE){
+				eraseCharacter();
+				character.x += directionX[direction];
+				character.y += directionY[direction];
+				moves++;
+			}
+		}
+
+		//Scroll the view to keep the character near the middle of the screen
+		if (gameInProgress){
+			followCharacter(character.x, character.y);
+		}
+
+		//Check if the character is in the end state
+		if ((character.x == exitPoint.x) && (character.y == exitPoint.y)){
+			//The game is over and ready to be restarted
+			if (gameInProgress) {
+				kprintf("Maze solved in %d moves\n", moves);
+			}
+			gameInProgress = FALSE;
+			autoSolve = FALSE;
+			//Draw the character in green, unless it is already drawn
+			if (!characterDrawn){
+				drawCharacter(character.x, character.y, SPRITE_CHARACTER_WIN);
+			}
+		}
+		//If not at the end state then draw the character in red where it is
+		else if(gameInProgress && !characterDrawn){
+			drawCharacter(character.x, character.y, SPRITE_CHARACTER);
+		}
+
+		//Flash the exit while a game is played, and show it in green once
+		//it is reached. These are palette changes, so they only happen at
+		//8 bits per pixel, where nothing has to be drawn for them.
+		if (gameInProgress){
+			setExitColor(((frameCount / EXITFLASHFRAMES) & 1) ? EXITDIM : EXITCOLOR);
+		}
+		else if ((character.x == exitPoint.x) && (character.y == exitPoint.y)){
+			setExitColor(EXITWIN);
+		}
+		else {
+			setExitColor(EXITCOLOR);
+		}
+
+		//Redraw the HUD line over the top wall of the maze, with the
+		//distance left to the exit as a hint
+		if (gameInProgress){
+			distance = solver_distance(&solver, character.x, character.y);
+		}
+		else {
+			distance = solver_distance(&solver, entrancePoint.x, entrancePoint.y);
+		}
+
+		//At reduced detail, skip the HUD when it would look the same
+		if (detail == GAME_DETAIL_FULL || moves != hudMoves || distance != hudDistance ||
+		    view.cameraX != hudCameraX || view.cameraY != hudCameraY){
+			drawHUD(moves, distance);
+			hudMoves = moves;
+			hudDistance = distance;
+			hudCameraX = view.cameraX;
+			hudCameraY = view.cameraY;
+		}
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       game_seed
+//
+//  Arguments:      seed:            The seed for the first generated maze
+//
+//  Returns:        void
+//
+//  Description:    This function sets where the sequence of generated mazes
+//                  starts. The same seed and the same button presses always
+//                  play out the same way.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void game_seed(unsigned int seed)
+{
+	mazeSeed = seed;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       game_redraw
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function redraws the whole view of the maze, which
+//                  is the most work a frame can do. It leaves the screen as
+//                  it was, so it can be used to time the renderer.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void game_redraw()
+{
+	drawMaze();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       game_set_detail
+//
+//  Arguments:      level:           GAME_DETAIL_FULL or GAME_DETAIL_REDUCED
+//
+//  Returns:        void
+//
+//  Description:    This function sets how much optional drawing each frame
+//                  does. At reduced detail the HUD is only drawn when what
+//                  it shows has changed or the view has scrolled.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void game_set_detail(int level)
+{
+	detail = level;
+}
+
+
+struct Button createButton(int number, char* name){
+    struct Button b;
+    b.number = number;
+    b.name = name;
+    return b;
+}
+
+
+
+struct Point createPoint(int x, int y){
+    struct Point p;
+    p.x = x;
+    p.y = y;
+    return p;
+}
+
+
+void printPoint(const struct Point *p)
+{
+    // When you are using pointers you need to use -> to access members
+    kprintf("X = %d  Y = %d\n", p->x, p->y);
+}
+
+
+void drawMaze(){
+	//Cells past the edge of a smaller maze are drawn as walls
+	viewport_draw(&view);
+
+	//The HUD has been drawn over, so it must be drawn again
+	hudMoves = -1;
+}
+
+
+void followCharacter(int x, int y){
+	int oldX = view.cameraX;
+	int oldY = view.cameraY;
+
+	//The HUD was drawn over the cells at the old top left of the screen,
+	//which takes the first HUDCELLS cells of the row. Any of them still in
+	//view after scrolling are drawn again, so the HUD is not left behind.
+	//Cells that went out of view are redrawn before they come back.
+	if (viewport_follow(&view, x, y)){
+		for (int i = 0; i < HUDCELLS; i++){
+			if ((oldX + i >= view.cameraX) && (oldX + i < view.cameraX + MAZEX) &&
+			    (oldY >= view.cameraY) && (oldY < view.cameraY + MAZEY)){
+				viewport_draw_row(&view, oldX + i, oldY, 1);
+			}
+		}
+	}
+}
+
+
+void drawCharacter(int x, int y, int sprite){
+	int pixelX, pixelY;
+
+	if (hardwareCursor){
+		//Only upload a new cursor image when the sprite changes
+		if (sprite != cursorSprite){
+			cursorSprite = sprite;
+			hardwareCursor = cursor_set_image(tilePixels(sprite), TILE_SIZE, TILE_SIZE, TILE_TRANSPARENT);
+		}
+
+		//Moving the cursor is one mailbox query, and it is hidden while
+		//the console is on the screen. Its position is on the screen,
+		//not in the frame buffer, so it is relative to the camera.
+		if (hardwareCursor){
+			hardwareCursor = cursor_set_state(!console_is_visible(), (x - view.cameraX) * SIZE, (y - view.cameraY) * SIZE);
+		}
+
+		//Fall back to drawing into the frame buffer if the cursor failed
+		if (!hardwareCursor){
+			cursor_set_state(FALSE, 0, 0);
+			viewport_cell_to_framebuffer(&view, x, y, &pixelX, &pixelY);
+			drawSprite(&characterSave, pixelX, pixelY, sprite);
+		}
+	}
+	else {
+		//Draw over the copy of the cell that is on the screen
+		viewport_cell_to_framebuffer(&view, x, y, &pixelX, &pixelY);
+		drawSprite(&characterSave, pixelX, pixelY, sprite);
+	}
+
+	characterDrawn = TRUE;
+}
+
+
+void eraseCharacter(){
+	//The hardware cursor is simply moved by the next draw
+	if (!hardwareCursor){
+		restoreSprite(&characterSave);
+	}
+
+	characterDrawn = FALSE;
+}
+
+
+void hideCharacter(){
+	eraseCharacter();
+
+	//The hardware cursor has to be hidden explicitly
+	if (hardwareCursor){
+		cursor_set_state(FALSE, 0, 0);
+	}
+}
+
+
+void drawHUD(int moves, unsigned int distance){
+	int x, y;
+
+	//The HUD stays at the top left of the screen, wherever the view has
+	//scrolled to in the frame buffer
+	viewport_screen_to_framebuffer(&view, HUDX, HUDY, &x, &y);
+	x = draw_text(x, y, "MOVES ", 0x00FFFFFF, 0x00000000);
+	x = draw_decimal(x, y, moves, 5, 0x00FFFF00, 0x00000000);
+
+	//An unsolvable maze shows no distance
+	x = draw_text(x, y, " EXIT ", 0x00FFFFFF, 0x00000000);
+	if (distance == SOLVER_UNREACHABLE){
+		draw_text(x, y, "-----", 0x00FFFF00, 0x00000000);
+	}
+	else {
+		draw_decimal(x, y, distance, 5, 0x00FFFF00, 0x00000000);
+	}
+}
+
+
+void setExitColor(unsigned int color){
+	//The palette is only updated when the color changes
+	if ((color != exitColor) && tiles_set_accent(TILE_EXIT, color)){
+		exitColor = color;
+	}
+}
+
+
+void loadMaze(){
+	maze_init(&maze, MAZEX, MAZEY, mazeWalls, mazeNeighbors);
+	maze_load(&maze, &mazeLayout[0][0]);
+
+	entrancePoint = createPoint(maze.entranceX, maze.entranceY);
+	exitPoint = createPoint(maze.exitX, maze.exitY);
+}
+
+
+void generateMaze(){
+	struct MazeGenStats stats;
+	unsigned long mark;
+	unsigned char *scratch;
+
+	//The generator's scratch memory is only needed while it runs, so it
+	//is taken from the top of the arena and given back straight after
+	mark = arena_mark(&memoryArena);
+	scratch = arena_alloc(&memoryArena, MAZEGEN_SCRATCH_BYTES(LEVELX, LEVELY), MEMORY_CACHE_LINE);
+	if (!scratch) {
+		uart_puts("Not enough memory to generate a maze\n");
+		return;
+	}
+
+	//Each maze comes from the next seed after the one set with
+	//game_seed(), so a replayed session gets the same mazes
+	maze.width = LEVELX;
+	maze.height = LEVELY;
+	maze_generate(&maze, mazeSeed++, scratch, &stats);
+	arena_reset(&memoryArena, mark);
+
+	entrancePoint = createPoint(maze.entranceX, maze.entranceY);
+	exitPoint = createPoint(maze.exitX, maze.exitY);
+
+	kprintf("Generated maze: rooms %u, time %lu us, memory %lu bytes\n",
+	        stats.rooms, stats.microseconds, stats.bytes);
+
+	//Check the new maze can be solved
+	if (solver_distance(&solver, entrancePoint.x, entrancePoint.y) == SOLVER_UNREACHABLE){
+		uart_puts("Generated maze has no path to the exit\n");
+	}
+	else {
+		kprintf("Shortest path %u moves\n",
+		        solver_distance(&solver, entrancePoint.x, entrancePoint.y));
+	}
+
+	solveGraph();
+}
+
+
+void solveGraph(){
+	unsigned long startTime, buildTime, searchTime;
+	unsigned int length;
+	int expanded;
+
+	//Build the corridor graph and find the shortest path on it
+	startTime = get_timer_counter();
+	if (!graph_build(&graph)){
+		uart_puts("Maze graph has too many nodes\n");
+		return;
+	}
+	buildTime = get_timer_counter() - startTime;
+
+	startTime = get_timer_counter();
+	length = graph_shortest_path(&graph, graph_node_at(&graph, entrancePoint.x, entrancePoint.y),
+	                             graph_node_at(&graph, exitPoint.x, exitPoint.y));
+	searchTime = get_timer_counter() - startTime;
+
+	//Expand the path back into cell moves, which should match its length
+	expanded = graph_expand_path(&graph, graph_node_at(&graph, exitPoint.x, exitPoint.y),
+	                          graphPath, sizeof(graphPath));
+
+	kprintf("Maze graph: nodes %u, edges %u, build %lu us, search %lu us, path %u moves%s\n",
+	        graph.nodes, graph.edges, buildTime, searchTime, length,
+	        expanded == (int)length ? "" : " (expansion failed)");
+}
@@ -0,0 +1,13 @@
+// The time between frames, in microseconds (30 frames a second)
+#define GAME_FRAME_MICROSECONDS  33333
+
+// How much optional drawing a frame does, set with game_set_detail()
+#define GAME_DETAIL_FULL         0
+#define GAME_DETAIL_REDUCED      1
+
+// Function prototypes
+void game_init();
+void game_frame(unsigned short data);
+void game_seed(unsigned int seed);
+void game_redraw();
+void game_set_detail(int level);
@@ -0,0 +1,488 @@
+// The functions in this file collapse a maze into a weighted graph of its
+// junctions, dead ends, entrance and exit, and find shortest paths on it.
+// Most cells of a maze are in one-wide corridors, where there is no choice
+// to make, so searching the graph does work in proportion to the number of
+// junctions instead of the number of open cells. A path found on the graph
+// can be expanded back into single cell moves for drawing or playing.
+//
+// Shortest paths are found with Dijkstra's algorithm and a binary heap.
+// Entries are not removed from the heap when a node's distance improves;
+// stale entries are skipped when they come out instead.
+
+// Needed header files
+#include "maze.h"
+#include "graph.h"
+
+// The number of open neighbors for each neighbor mask
+static const unsigned char maskDegree[16] = {
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+};
+
+// The lowest direction in each (non-zero) neighbor mask
+static const unsigned char maskFirst[16] = {
+    0, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0
+};
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       isNode
+//
+//  Arguments:      graph:           The graph
+//                  index:           Row-major index of an open cell
+//
+//  Returns:        TRUE (non-zero) if the cell is a graph node
+//
+//  Description:    This function decides whether a cell is a node. Every
+//                  open cell that is not a node has exactly two open
+//                  neighbors, so it lies in the middle of a corridor.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static int isNode(struct Graph *graph, unsigned int index)
+{
+    struct Maze *maze = graph->maze;
+
+
+    return maskDegree[maze_neighbors_at(maze, index)] != 2 ||
+           index == (unsigned int)((maze->entranceY * maze->width) + maze->entranceX) ||
+           index == (unsigned int)((maze->exitY * maze->width) + maze->exitX);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       walkCorridor
+//
+//  Arguments:      graph:           The graph
+//                  index:           Row-major index of the starting node
+//                  direction:       The direction to leave the node in
+//                  end:             Where to return the index of the node at
+//                                   the other end of the corridor
+//                  moves:           Where to record the direction of every
+//                                   move, or 0 if not wanted
+//
+//  Returns:        The number of moves to the other end of the corridor
+//
+//  Description:    This function follows a corridor from a node until it
+//                  reaches another node. In the middle of a corridor the
+//                  way on is the open neighbor that is not the way back.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int walkCorridor(struct Graph *graph, unsigned int index, int direction,
+                                 unsigned int *end, unsigned char *moves)
+{
+    struct Maze *maze = graph->maze;
+    unsigned int length = 0;
+
+
+    while (1) {
+        if (moves) {
+            moves[length] = direction;
+        }
+        length++;
+
+        index += (directionY[direction] * maze->width) + directionX[direction];
+
+        if (isNode(graph, index)) {
+            *end = index;
+            return length;
+        }
+
+        // Directions come in opposite pairs, so the way back is direction ^ 1
+        direction = maskFirst[maze_neighbors_at(maze, index) & ~(1 << (direction ^ 1))];
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       findNode
+//
+//  Arguments:      graph:           The graph
+//                  index:           Row-major cell index
+//
+//  Returns:        The node number of the cell, or GRAPH_NO_NODE
+//
+//  Description:    This function finds the node at a cell with a binary
+//                  search, since nodes are numbered in cell order.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static int findNode(struct Graph *graph, unsigned int index)
+{
+    unsigned int low = 0, high = graph->nodes, middle;
+
+
+    while (low < high) {
+        middle = (low + high) / 2;
+
+        if (graph->nodeCell[middle] < index) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    if (low < graph->nodes && graph->nodeCell[low] == index) {
+        return low;
+    }
+
+    return GRAPH_NO_NODE;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       graph_init
+//
+//  Arguments:      graph:           The graph to set up
+//                  maze:            The maze to build it from
+//                  memory:          Storage of at least
+//                                   GRAPH_MEMORY_WORDS(maxNodes) words
+//                  maxNodes:        The most nodes the graph can hold
+//
+//  Returns:        void
+//
+//  Description:    This function sets up an empty graph, dividing up the
+//                  storage between its arrays. The graph is built from the
+//                  maze by graph_build().
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void graph_init(struct Graph *graph, struct Maze *maze, unsigned int *memory,
+                unsigned int maxNodes)
+{
+    graph->maze = maze;
+    graph->maxNodes = maxNodes;
+    graph->nodes = 0;
+    graph->edges = 0;
+    graph->generation = 0;
+    graph->valid = 0;
+
+    graph->nodeCell = memory;
+    memory += maxNodes;
+    graph->firstEdge = memory;
+    memory += maxNodes + 1;
+    graph->distance = memory;
+    memory += maxNodes;
+    graph->previousNode = memory;
+    memory += maxNodes;
+    graph->previousEdge = memory;
+    memory += maxNodes;
+    graph->edge = (struct GraphEdge *)memory;
+    memory += (maxNodes * DIRECTIONS * sizeof(struct GraphEdge)) / 4;
+    graph->heap = (struct GraphHeapEntry *)memory;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       graph_build
+//
+//  Arguments:      graph:           The graph
+//
+//  Returns:        TRUE (non-zero) if the graph is usable, FALSE (zero) if
+//                  the maze has more nodes than the graph can hold
+//
+//  Description:    This function builds the graph from the maze, if the maze
+//                  has changed since it was last built. The nodes are found
+//                  by scanning the cells in order, and then every corridor
+//                  leaving each node is walked to find its length and the
+//                  node at its far end.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int graph_build(struct Graph *graph)
+{
+    struct Maze *maze = graph->maze;
+    unsigned int index, node, end, mask;
+    int x, y, direction;
+
+
+    if (graph->valid && graph->generation == maze->generation) {
+        return 1;
+    }
+
+    graph->valid = 0;
+    graph->nodes = 0;
+    graph->edges = 0;
+
+    // Find the nodes, skipping whole words of wall at a time
+    for (y = 0; y < maze->height; y++) {
+        for (x = 0; x < maze->width; x++) {
+            if ((x & 63) == 0 && maze->walls[(y * maze->wordsPerRow) + (x >> 6)] == ~0UL) {
+                x += 63;
+                continue;
+            }
+
+            index = (y * maze->width) + x;
+            if (!maze_is_wall(maze, x, y) && isNode(graph, index)) {
+                if (graph->nodes == graph->maxNodes) {
+                    return 0;
+                }
+                graph->nodeCell[graph->nodes++] = index;
+            }
+        }
+    }
+
+    // Walk the corridors leaving each node
+    for (node = 0; node < graph->nodes; node++) {
+        graph->firstEdge[node] = graph->edges;
+        mask = maze_neighbors_at(maze, graph->nodeCell[node]);
+
+        for (direction = 0; direction < DIRECTIONS; direction++) {
+            if ((mask >> direction) & 1) {
+                graph->edge[graph->edges].length =
+                    walkCorridor(graph, graph->nodeCell[node], direction, &end, 0);
+                graph->edge[graph->edges].node = findNode(graph, end);
+                graph->edge[graph->edges].direction = direction;
+                graph->edges++;
+            }
+        }
+    }
+    graph->firstEdge[graph->nodes] = graph->edges;
+
+    graph->generation = maze->generation;
+    graph->valid = 1;
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       graph_node_at
+//
+//  Arguments:      graph:           The graph
+//                  x:               Cell x coordinate
+//                  y:               Cell y coordinate
+//
+//  Returns:        The node number of the cell, or GRAPH_NO_NODE if the cell
+//                  is not a node or the graph cannot be built
+//
+//  Description:    This function finds the node at a cell, building the
+//                  graph first if needed.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int graph_node_at(struct Graph *graph, int x, int y)
+{
+    if (!graph_build(graph)) {
+        return GRAPH_NO_NODE;
+    }
+
+    return findNode(graph, (y * graph->maze->width) + x);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       heapPush
+//
+//  Arguments:      graph:           The graph
+//                  size:            The number of entries in the heap
+//                  distance:        Distance of the new entry
+//                  node:            Node of the new entry
+//
+//  Returns:        The new number of entries
+//
+//  Description:    This function adds an entry to the search heap, moving it
+//                  up until its parent is no further away.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int heapPush(struct Graph *graph, unsigned int size, unsigned int distance,
+                             unsigned int node)
+{
+    struct GraphHeapEntry *heap = graph->heap;
+    unsigned int child = size, parent;
+
+
+    while (child > 0) {
+        parent = (child - 1) / 2;
+        if (heap[parent].distance <= distance) {
+            break;
+        }
+        heap[child] = heap[parent];
+        child = parent;
+    }
+
+    heap[child].distance = distance;
+    heap[child].node = node;
+
+    return size + 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       heapPop
+//
+//  Arguments:      graph:           The graph
+//                  size:            The number of entries in the heap, which
+//                                   must not be zero
+//
+//  Returns:        The new number of entries. The nearest entry is left just
+//                  past the end of the heap, at heap[size - 1].
+//
+//  Description:    This function removes the nearest entry from the search
+//                  heap, moving the last entry down from the top to fill
+//                  the gap.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int heapPop(struct Graph *graph, unsigned int size)
+{
+    struct GraphHeapEntry *heap = graph->heap;
+    struct GraphHeapEntry top = heap[0], last = heap[size - 1];
+    unsigned int parent = 0, child;
+
+
+    size--;
+
+    while ((child = (2 * parent) + 1) < size) {
+        if (child + 1 < size && heap[child + 1].distance < heap[child].distance) {
+            child++;
+        }
+        if (last.distance <= heap[child].distance) {
+            break;
+        }
+        heap[parent] = heap[child];
+        parent = child;
+    }
+
+    heap[parent] = last;
+    heap[size] = top;
+
+    return size;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       graph_shortest_path
+//
+//  Arguments:      graph:           The graph
+//                  from:            The starting node
+//                  to:              The destination node
+//
+//  Returns:        The number of cell moves on the shortest path, or
+//                  GRAPH_UNREACHABLE if there is no path
+//
+//  Description:    This function searches the graph with Dijkstra's
+//                  algorithm, stopping once the destination is reached. The
+//                  path found is kept for graph_expand_path().
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int graph_shortest_path(struct Graph *graph, int from, int to)
+{
+    struct GraphEdge *edge;
+    unsigned int size, node, distance, i;
+
+
+    if (!graph_build(graph) || from < 0 || to < 0 ||
+        from >= (int)graph->nodes || to >= (int)graph->nodes) {
+        return GRAPH_UNREACHABLE;
+    }
+
+    for (node = 0; node < graph->nodes; node++) {
+        graph->distance[node] = GRAPH_UNREACHABLE;
+    }
+
+    graph->distance[from] = 0;
+    graph->previousNode[from] = from;
+    size = heapPush(graph, 0, 0, from);
+
+    while (size) {
+        size = heapPop(graph, size);
+        node = graph->heap[size].node;
+        distance = graph->heap[size].distance;
+
+        // Skip entries left behind when a shorter way was found
+        if (distance != graph->distance[node]) {
+            continue;
+        }
+
+        if (node == (unsigned int)to) {
+            break;
+        }
+
+        for (i = graph->firstEdge[node]; i < graph->firstEdge[node + 1]; i++) {
+            edge = &graph->edge[i];
+
+            if (distance + edge->length < graph->distance[edge->node]) {
+                graph->distance[edge->node] = distance + edge->length;
+                graph->previousNode[edge->node] = node;
+                graph->previousEdge[edge->node] = i;
+                size = heapPush(graph, size, distance + edge->length, edge->node);
+            }
+        }
+    }
+
+    return graph->distance[to];
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       graph_expand_path
+//
+//  Arguments:      graph:           The graph
+//                  to:              The destination node of the last call to
+//                                   graph_shortest_path()
+//                  moves:           Where to write the direction of each move
+//                  maxMoves:        The number of moves there is room for
+//
+//  Returns:        The number of moves written, or -1 if there is no path or
+//                  it does not fit
+//
+//  Description:    This function turns the path found by the last search
+//                  into single cell moves, from the starting node to the
+//                  destination. The path is traced back from the
+//                  destination, and each corridor is walked again to fill
+//                  in its moves at the right place in the list.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int graph_expand_path(struct Graph *graph, int to, unsigned char *moves,
+                      unsigned int maxMoves)
+{
+    struct GraphEdge *edge;
+    unsigned int length, position, node, end;
+
+
+    if (to < 0 || to >= (int)graph->nodes) {
+        return -1;
+    }
+
+    length = graph->distance[to];
+    if (length == GRAPH_UNREACHABLE || length > maxMoves) {
+        return -1;
+    }
+
+    position = length;
+    node = to;
+
+    while (position) {
+        edge = &graph->edge[graph->previousEdge[node]];
+        position -= edge->length;
+        walkCorridor(graph, graph->nodeCell[graph->previousNode[node]], edge->direction,
+                     &end, &moves[position]);
+        node = graph->previousNode[node];
+    }
+
+    return length;
+}
@@ -0,0 +1,55 @@
+// Returned when a cell is not a graph node, or a node cannot be reached
+#define GRAPH_NO_NODE       -1
+#define GRAPH_UNREACHABLE   0xFFFFFFFF
+
+// A corridor between two nodes. It leaves its source node in the given
+// direction and reaches the target node after the given number of moves.
+struct GraphEdge {
+    unsigned int node;
+    unsigned int length;
+    unsigned int direction;
+};
+
+// A shortest-path search queue entry
+struct GraphHeapEntry {
+    unsigned int distance;
+    unsigned int node;
+};
+
+// The memory, in words, a graph of up to the given number of nodes needs:
+// five words per node, one edge per direction, and a search queue holding
+// at most one entry per edge plus the starting node.
+#define GRAPH_MEMORY_WORDS(maxNodes) \
+    (((maxNodes) * (5 + (DIRECTIONS * (sizeof(struct GraphEdge) + \
+                                       sizeof(struct GraphHeapEntry)) / 4))) + 3)
+
+// A maze collapsed into a weighted graph. The nodes are the cells where a
+// choice can be made or the path ends: junctions, dead ends, the entrance
+// and the exit. Runs of cells with exactly two open neighbors become edges,
+// weighted by their length. Nodes are numbered in row-major cell order, so
+// the node of a cell is found with a binary search. Edges are stored grouped
+// by their source node, starting at firstEdge[node].
+struct Graph {
+    struct Maze *maze;
+    unsigned int maxNodes;
+    unsigned int nodes;
+    unsigned int edges;
+    unsigned int *nodeCell;         // Row-major cell index of each node
+    unsigned int *firstEdge;        // First edge of each node, plus an end
+    struct GraphEdge *edge;
+    unsigned int *distance;         // Results of the last search
+    unsigned int *previousNode;
+    unsigned int *previousEdge;
+    struct GraphHeapEntry *heap;
+    unsigned int generation;        // Maze generation the graph is for
+    int valid;                      // Whether the graph has been built
+};
+
+// Function prototypes
+void graph_init(struct Graph *graph, struct Maze *maze, unsigned int *memory,
+                unsigned int maxNodes);
+int graph_build(struct Graph *graph);
+int graph_node_at(struct Graph *graph, int x, int y);
+unsigned int graph_shortest_path(struct Graph *graph, int from, int to);
+int graph_expand_path(struct Graph *graph, int to, unsigned char *moves,
+                      unsigned int maxMoves);
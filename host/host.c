@@ -0,0 +1,427 @@
+// This program runs the maze game on the host machine, for profiling and
+// benchmarking the game and renderer without a Raspberry Pi or Qemu. It
+// runs the same frames as the kernel's main(), but flat out, with the
+// controller driven by a script, and prints how long each frame took. The
+// drivers are the kernel's own, running against the peripheral models (see
+// host.h), so each frame reads the controller through the GPIO pins.
+//
+// Usage: maze-host [-n frames] [-i script] [-r journal] [-j] [-o screen.ppm]
+//                  [-t temperature] [-T] [-q] [-d]
+//
+//     -n frames       Number of frames to run (default 1000, or to the end
+//                     of the journal when replaying one)
+//     -i script       Controller script (see host/script.c)
+//     -r journal      Replay a journal exported by the kernel (see journal.c)
+//                     instead of a script
+//     -j              Export the journal of the run over the UART at the end
+//     -o screen.ppm   Save the screen after the last frame as a PPM image
+//     -t temperature  The SoC temperature the mailbox reports, in
+//                     thousandths of a degree (default 50000)
+//     -T              Send telemetry packets over the UART (see telemetry.c),
+//                     with the host time of each frame as its busy time
+//     -q              Only print the summary, not every frame
+//     -d              Benchmark the UART, SNES and mailbox drivers instead
+//                     of running the game
+
+// Needed header files
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../uart.h"
+#include "../framebuffer.h"
+#include "../snes.h"
+#include "../game.h"
+#include "../mailbox.h"
+#include "../journal.h"
+#include "../memory.h"
+#include "../clock.h"
+#include "../thermal.h"
+#include "../dma.h"
+#include "../telemetry.h"
+#include "host.h"
+
+// The number of calls each driver benchmark makes
+#define DRIVER_BENCHMARK_CALLS  1000
+
+// The characters sent by the console. Both UART models are counted, since
+// a console built for the PL011 falls back to the Mini UART if the PL011
+// cannot run at its Baud rate.
+#define consoleTransmitted()    (sim_uart_transmitted() + sim_pl011_transmitted())
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       hostMicroseconds
+//
+//  Arguments:      none
+//
+//  Returns:        The host's monotonic clock in microseconds
+//
+//  Description:    This function reads the real time on the host, for
+//                  timing frames. The kernel's timer driver reports
+//                  simulated time in the host build.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned long hostMicroseconds()
+{
+    struct timespec now;
+
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((unsigned long)now.tv_sec * 1000000) + (now.tv_nsec / 1000);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       reportDriver
+//
+//  Arguments:      name:            What was benchmarked
+//                  calls:           The number of calls made
+//                  hostTime:        Host time taken, in microseconds
+//                  simulated:       Simulated time taken, in nanoseconds
+//
+//  Returns:        void
+//
+//  Description:    This function prints the cost of one call on the host,
+//                  and on the simulated Raspberry Pi.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void reportDriver(const char *name, unsigned long calls, unsigned long hostTime,
+                         unsigned long simulated)
+{
+    printf("%-10s %6lu calls, host %8.1f ns/call, simulated %8.2f us/call\n", name, calls,
+           (hostTime * 1000.0) / calls, (simulated / 1000.0) / calls);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       benchmarkDrivers
+//
+//  Arguments:      none
+//
+//  Returns:        TRUE (non-zero) if the drivers behaved as expected
+//
+//  Description:    This function times the kernel drivers against the
+//                  peripheral models: sending text through the UART,
+//                  reading the controller, and a property tag request.
+//                  Each result is also checked against the models.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static int benchmarkDrivers()
+{
+    static char text[DRIVER_BENCHMARK_CALLS + 1];
+    unsigned long start, simStart, sent, i;
+    unsigned short buttons;
+    int ok = 1;
+
+
+    uart_init();
+    memory_init();
+    snes_init();
+    initFrameBuffer();
+    if (!hostDisplay.frameBuffer) {
+        return 0;
+    }
+
+    // Send a block of text, one character per call, without echoing it
+    memset(text, 'x', DRIVER_BENCHMARK_CALLS);
+    simUartEcho = 0;
+    sent = consoleTransmitted();
+    start = hostMicroseconds();
+    simStart = simTime;
+    uart_puts(text);
+    reportDriver("uart_putc", DRIVER_BENCHMARK_CALLS, hostMicroseconds() - start,
+                 simTime - simStart);
+    simUartEcho = 1;
+    if (consoleTransmitted() - sent != DRIVER_BENCHMARK_CALLS) {
+        printf("uart_putc: %lu characters sent\n", consoleTransmitted() - sent);
+        ok = 0;
+    }
+
+    // Read the controller with a different set of buttons each time
+    start = hostMicroseconds();
+    simStart = simTime;
+    for (i = 0; i < DRIVER_BENCHMARK_CALLS; i++) {
+        sim_snes_set_buttons(i & 0x0FFF);
+        buttons = get_SNES();
+        if (buttons != (i & 0x0FFF)) {
+            printf("get_SNES: read %04X for %04lX\n", buttons, i & 0x0FFF);
+            ok = 0;
+            break;
+        }
+    }
+    reportDriver("get_SNES", i, hostMicroseconds() - start, simTime - simStart);
+
+    // Move the screen window, which is one property tag request
+    start = hostMicroseconds();
+    simStart = simTime;
+    for (i = 0; i < DRIVER_BENCHMARK_CALLS; i++) {
+        setFrameBufferOffset(i & 0xFF, 0);
+        if (hostDisplay.offsetX != (i & 0xFF)) {
+            printf("mailbox_query: offset %u for %lu\n", hostDisplay.offsetX, i & 0xFF);
+            ok = 0;
+            break;
+        }
+    }
+    reportDriver("mailbox", i, hostMicroseconds() - start, simTime - simStart);
+
+    return ok;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       screenPixel
+//
+//  Arguments:      x:               Screen pixel x coordinate
+//                  y:               Screen pixel y coordinate
+//
+//  Returns:        The color shown at the pixel
+//
+//  Description:    This function finds what the display shows at a screen
+//                  pixel: the hardware cursor where it is opaque, otherwise
+//                  the frame buffer through the current window, decoded
+//                  from its depth and pixel order, and looked up in the
+//                  palette at 8 bits per pixel.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int screenPixel(int x, int y)
+{
+    int cursorX = x - hostDisplay.cursorX;
+    int cursorY = y - hostDisplay.cursorY;
+    unsigned long offset;
+    unsigned int pixel;
+    unsigned char *bytes;
+
+
+    if (hostDisplay.cursorVisible && hostDisplay.cursorImage &&
+        cursorX >= 0 && cursorX < (int)hostDisplay.cursorWidth &&
+        cursorY >= 0 && cursorY < (int)hostDisplay.cursorHeight) {
+        pixel = hostDisplay.cursorImage[(cursorY * hostDisplay.cursorWidth) + cursorX];
+        if (pixel >> 24) {
+            return pixel;
+        }
+    }
+
+    offset = ((hostDisplay.offsetY + y) * hostDisplay.virtualWidth) + hostDisplay.offsetX + x;
+    bytes = hostDisplay.frameBuffer + (offset * (hostDisplay.depth / 8));
+
+    switch (hostDisplay.depth) {
+    case 8:
+        return hostDisplay.palette[bytes[0]];
+    case 16:
+        // Widen RGB565 to 8 bits per component
+        pixel = bytes[0] | (bytes[1] << 8);
+        pixel = ((pixel & 0xF800) << 8) | ((pixel & 0x07E0) << 5) | ((pixel & 0x001F) << 3);
+        pixel |= (pixel >> 5) & 0x070007;
+        pixel |= (pixel >> 6) & 0x000300;
+        break;
+    case 24:
+        pixel = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16);
+        break;
+    default:
+        pixel = *(unsigned int *)bytes & 0x00FFFFFF;
+        break;
+    }
+
+    // In RGB order, red is in the low bits
+    if (hostDisplay.pixelOrder) {
+        pixel = ((pixel & 0xFF) << 16) | (pixel & 0xFF00) | ((pixel >> 16) & 0xFF);
+    }
+
+    return pixel;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       writeScreen
+//
+//  Arguments:      path:            The file to write
+//
+//  Returns:        TRUE (non-zero) if the file was written
+//
+//  Description:    This function saves what is on the screen as a binary
+//                  PPM image.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static int writeScreen(const char *path)
+{
+    FILE *file = fopen(path, "wb");
+    unsigned int pixel, x, y;
+
+
+    if (!file) {
+        perror(path);
+        return 0;
+    }
+
+    fprintf(file, "P6\n%u %u\n255\n", hostDisplay.width, hostDisplay.height);
+
+    for (y = 0; y < hostDisplay.height; y++) {
+        for (x = 0; x < hostDisplay.width; x++) {
+            pixel = screenPixel(x, y);
+            fputc((pixel >> 16) & 0xFF, file);
+            fputc((pixel >> 8) & 0xFF, file);
+            fputc(pixel & 0xFF, file);
+        }
+    }
+
+    fclose(file);
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       main
+//
+//  Arguments:      argc, argv:      The command line (see the top of file)
+//
+//  Returns:        0 on success, 1 on a usage or file error
+//
+//  Description:    This function sets up the game, runs the frames, and
+//                  prints the time each frame took and a summary.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv)
+{
+    unsigned long frames = 1000, frame, start, elapsed;
+    unsigned long total = 0, fastest = ~0UL, slowest = 0;
+    const char *screenPath = 0;
+    int quiet = 0, drivers = 0, replay = 0, framesGiven = 0, exportJournal = 0, telemetry = 0;
+    int i;
+    unsigned short data;
+
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            frames = strtoul(argv[++i], 0, 0);
+            framesGiven = 1;
+        } else if (!strcmp(argv[i], "-i") && i + 1 < argc) {
+            if (!host_script_load(argv[++i])) {
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            if (!host_journal_load(argv[++i])) {
+                return 1;
+            }
+            replay = 1;
+        } else if (!strcmp(argv[i], "-j")) {
+            exportJournal = 1;
+        } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            screenPath = argv[++i];
+        } else if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+            simTemperature = strtoul(argv[++i], 0, 0);
+        } else if (!strcmp(argv[i], "-T")) {
+            telemetry = 1;
+        } else if (!strcmp(argv[i], "-q")) {
+            quiet = 1;
+        } else if (!strcmp(argv[i], "-d")) {
+            drivers = 1;
+        } else {
+            fprintf(stderr, "Usage: %s [-n frames] [-i script] [-r journal] [-j] "
+                    "[-o screen.ppm] [-t temperature] [-T] [-q] [-d]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (drivers) {
+        return benchmarkDrivers() ? 0 : 1;
+    }
+
+    uart_init();
+    memory_init();
+    dma_init();
+    snes_init();
+
+    // A replay gets the seed it was recorded with. Otherwise the run is
+    // recorded, with a fixed seed so that it is the same every time.
+    if (replay) {
+        if (!framesGiven) {
+            frames = journal_frames();
+        }
+    } else {
+        journal_init(0);
+    }
+
+    start = hostMicroseconds();
+    game_init();
+    game_seed(journal_seed());
+    clock_init(game_redraw);
+    thermal_init();
+    printf("init: %lu us\n", hostMicroseconds() - start);
+
+    if (telemetry) {
+        telemetry_init();
+    }
+
+    if (!hostDisplay.frameBuffer) {
+        return 1;
+    }
+
+    for (frame = 0; frame < frames; frame++) {
+        sim_snes_set_buttons(replay ? journal_replay_next() : host_script_next());
+        game_set_detail(thermal_frame() == THERMAL_NORMAL ? GAME_DETAIL_FULL :
+                                                            GAME_DETAIL_REDUCED);
+        start = hostMicroseconds();
+        data = get_SNES();
+        if (!replay) {
+            journal_record(data);
+        }
+        game_frame(data);
+        elapsed = hostMicroseconds() - start;
+
+        telemetry_frame(elapsed, thermal_frame_period(GAME_FRAME_MICROSECONDS));
+        telemetry_input(data);
+        telemetry_counter(TELEMETRY_TEMPERATURE, thermal_temperature());
+        telemetry_counter(TELEMETRY_ARM_RATE, clock_arm_rate());
+        telemetry_counter(TELEMETRY_THERMAL_LEVEL, thermal_level());
+
+        total += elapsed;
+        if (elapsed < fastest) {
+            fastest = elapsed;
+        }
+        if (elapsed > slowest) {
+            slowest = elapsed;
+        }
+
+        if (!quiet) {
+            printf("frame %lu: %lu us\n", frame, elapsed);
+        }
+    }
+
+    if (frames) {
+        printf("frames: %lu, total %lu us, min %lu us, mean %lu us, max %lu us\n",
+               frames, total, fastest, total / frames, slowest);
+    }
+
+    telemetry_flush();
+
+    if (exportJournal) {
+        journal_export();
+    }
+
+    if (screenPath && !writeScreen(screenPath)) {
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,79 @@
+// The host build runs the game as a Linux program. The kernel's own drivers
+// are compiled with MMIO_SIMULATION defined, so their register accesses go
+// to the software models of the peripherals in this directory instead of
+// the hardware:
+//
+//     sim.c           Register dispatch, simulated time, the system timer
+//     sim_uart.c      The Mini UART and its transmit FIFO
+//     sim_pl011.c     The PL011 UART and its FIFOs
+//     sim_gpio.c      The GPIO pins, with an SNES controller on 9, 10, 11
+//     sim_mailbox.c   The property mailbox and the video core display
+//     sim_dma.c       The DMA controller
+//
+// Simulated time only moves forward with register accesses, each of which
+// takes SIM_ACCESS_NANOSECONDS, so a polling loop waits for as many
+// accesses as the time it waits for. Runs are repeatable from one host to
+// another.
+
+// The simulated cost of one register access, and of a mailbox round trip
+// through the video core. These are rough figures for the Raspberry Pi 3.
+#define SIM_ACCESS_NANOSECONDS      50
+#define SIM_MAILBOX_NANOSECONDS     10000
+
+// The register blocks that are modelled, as offsets from MMIO_BASE
+#define SIM_TIMER_OFFSET            0x00003000
+#define SIM_MAILBOX_OFFSET          0x0000B880
+#define SIM_GPIO_OFFSET             0x00200000
+#define SIM_AUX_OFFSET              0x00215000
+#define SIM_PL011_OFFSET            0x00201000
+#define SIM_BLOCK_SIZE              0x100
+#define SIM_DMA_OFFSET              0x00007000
+#define SIM_DMA_SIZE                0x1000
+
+// The state of the simulated video core, kept by the mailbox model
+struct HostDisplay {
+    unsigned char *frameBuffer;     // In-memory frame buffer
+    unsigned int width, height;     // Physical (screen) size in pixels
+    unsigned int virtualWidth;      // Virtual size in pixels
+    unsigned int virtualHeight;
+    unsigned int depth;             // Bits per pixel, 8, 16, 24 or 32
+    unsigned int pixelOrder;        // 0 for BGR, 1 for RGB
+    unsigned int palette[256];      // RGB colors of 8-bit pixels
+    unsigned int offsetX, offsetY;  // Screen window into the frame buffer
+    const unsigned int *cursorImage;
+    unsigned int cursorWidth, cursorHeight;
+    int cursorVisible;
+    int cursorX, cursorY;
+};
+
+extern struct HostDisplay hostDisplay;
+
+// Simulated time in nanoseconds, whether characters sent by the UART
+// are echoed to the standard error stream, and the SoC temperature the
+// mailbox reports in thousandths of a degree
+extern unsigned long simTime;
+extern int simUartEcho;
+extern unsigned int simTemperature;
+
+// Function prototypes for the host program
+int host_script_load(const char *path);
+unsigned short host_script_next();
+int host_journal_load(const char *path);
+
+// Function prototypes for the peripheral models. The register offsets are
+// from the start of each model's register block.
+unsigned int sim_uart_read(unsigned int offset);
+void sim_uart_write(unsigned int offset, unsigned int value);
+unsigned long sim_uart_transmitted();
+void sim_uart_receive(char c);
+unsigned int sim_pl011_read(unsigned int offset);
+void sim_pl011_write(unsigned int offset, unsigned int value);
+unsigned long sim_pl011_transmitted();
+void sim_pl011_receive(char c);
+unsigned int sim_gpio_read(unsigned int offset);
+void sim_gpio_write(unsigned int offset, unsigned int value);
+void sim_snes_set_buttons(unsigned short buttons);
+unsigned int sim_mailbox_read(unsigned int offset);
+void sim_mailbox_write(unsigned int offset, unsigned int value);
+unsigned int sim_dma_read(unsigned int offset);
+void sim_dma_write(unsigned int offset, unsigned int value);
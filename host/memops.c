@@ -0,0 +1,34 @@
+// The function in this file stands in for memset32() in memops.s, which
+// is AArch64 assembly and is not part of the host build. The other memory
+// functions come from the host's C library.
+
+// Needed header files
+#include "../memops.h"
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       memset32
+//
+//  Arguments:      destination:     Where to store, word aligned
+//                  value:           The word to store
+//                  count:           The number of words
+//
+//  Returns:        The destination address
+//
+//  Description:    This function fills memory with a 32-bit value.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void *memset32(void *destination, unsigned int value, unsigned long count)
+{
+    unsigned int *word = destination;
+
+
+    while (count--) {
+        *word++ = value;
+    }
+
+    return destination;
+}
@@ -0,0 +1,174 @@
+// The functions in this file drive the simulated SNES controller in the host
+// build. Button presses come from a script instead of a player. Each
+// script line gives a frame number and the buttons (in hexadecimal, encoded
+// as get_SNES() returns them) held from that frame until the next line:
+//
+//     # Generate a new maze, then let the solver play it
+//     1 200
+//     2 0
+//     3 2
+//     4 0
+//
+// Lines starting with # are comments.
+//
+// A journal exported by the kernel can be replayed instead (see journal.c),
+// and is read here too.
+
+// Needed header files
+#include <stdio.h>
+#include "../journal.h"
+#include "host.h"
+
+// The most lines a script can have
+#define SNES_MAX_STEPS  1024
+
+// A script step: the buttons held from the given frame on
+struct SnesStep {
+    unsigned long frame;
+    unsigned short buttons;
+};
+
+// The script used when none is given: press X to generate a large maze,
+// then Y to auto-solve it, which scrolls the view every frame
+static struct SnesStep script[SNES_MAX_STEPS] = {
+    {0, 0x0000}, {1, 0x0200}, {2, 0x0000}, {3, 0x0002}, {4, 0x0000}
+};
+static int scriptSteps = 5;
+
+// The current frame, and the script step it is in
+static unsigned long frame;
+static int step = -1;
+
+// The journal file being read
+static FILE *journalFile;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       host_script_load
+//
+//  Arguments:      path:            The script file to read
+//
+//  Returns:        TRUE (non-zero) if the script was read, FALSE (zero)
+//                  otherwise
+//
+//  Description:    This function replaces the button script with one read
+//                  from a file. The steps must be in frame order.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int host_script_load(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    char line[128];
+    unsigned long lineFrame;
+    unsigned int buttons;
+
+
+    if (!file) {
+        perror(path);
+        return 0;
+    }
+
+    scriptSteps = 0;
+    while (fgets(line, sizeof(line), file) && scriptSteps < SNES_MAX_STEPS) {
+        if (line[0] == '#' || sscanf(line, "%lu %x", &lineFrame, &buttons) != 2) {
+            continue;
+        }
+
+        script[scriptSteps].frame = lineFrame;
+        script[scriptSteps].buttons = buttons;
+        scriptSteps++;
+    }
+
+    fclose(file);
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       host_script_next
+//
+//  Arguments:      none
+//
+//  Returns:        The buttons the script holds for the next frame
+//
+//  Description:    This function is called once per frame, before the
+//                  frame reads the controller, and steps through the script.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned short host_script_next()
+{
+    while (step + 1 < scriptSteps && script[step + 1].frame <= frame) {
+        step++;
+    }
+
+    frame++;
+
+    return (step < 0) ? 0 : script[step].buttons;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       journalGetc
+//
+//  Arguments:      none
+//
+//  Returns:        The next character of the journal file, or 0 at its end
+//
+//  Description:    This function stands in for uart_getc() when a journal
+//                  is read from a file.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static char journalGetc()
+{
+    int c = fgetc(journalFile);
+
+
+    return (c == EOF) ? 0 : c;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       host_journal_load
+//
+//  Arguments:      path:            A file holding an exported journal
+//
+//  Returns:        TRUE (non-zero) if the journal was read, FALSE (zero)
+//                  otherwise
+//
+//  Description:    This function reads a journal for replay. Other text in
+//                  the file, such as the rest of a serial log, is skipped.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int host_journal_load(const char *path)
+{
+    int loaded;
+
+
+    journalFile = fopen(path, "r");
+    if (!journalFile) {
+        perror(path);
+        return 0;
+    }
+
+    loaded = journal_import(journalGetc);
+    fclose(journalFile);
+
+    if (!loaded) {
+        fprintf(stderr, "%s: no journal found\n", path);
+    }
+
+    return loaded;
+}
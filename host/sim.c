@@ -0,0 +1,159 @@
+// The functions in this file are the simulation backend of mmio.h. Each
+// register access advances simulated time and is passed to the model of
+// the peripheral that owns the address. The system timer is modelled here,
+// since it only reports simulated time.
+
+// Needed header files
+#include <stdio.h>
+#include "../mmio.h"
+#include "../gpio.h"
+#include "host.h"
+
+// System timer register offsets
+#define TIMER_CS        0x00
+#define TIMER_CLO       0x04
+#define TIMER_CHI       0x08
+
+// Simulated time in nanoseconds
+unsigned long simTime;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       timerRead
+//
+//  Arguments:      offset:          Register offset in the timer block
+//
+//  Returns:        The register value
+//
+//  Description:    This function models the free-running 64-bit system
+//                  timer counter, which counts microseconds. The compare
+//                  registers are not modelled.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int timerRead(unsigned int offset)
+{
+    unsigned long microseconds = simTime / 1000;
+
+
+    switch (offset) {
+    case TIMER_CLO:
+        return (unsigned int)microseconds;
+    case TIMER_CHI:
+        return (unsigned int)(microseconds >> 32);
+    default:
+        return 0;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       unmodelled
+//
+//  Arguments:      address:         The register address
+//
+//  Returns:        void
+//
+//  Description:    This function reports the first access to a register
+//                  outside the modelled blocks. Such reads return 0 and
+//                  writes are ignored.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void unmodelled(unsigned long address)
+{
+    static int reported;
+
+
+    if (!reported) {
+        fprintf(stderr, "Unmodelled register access at 0x%08lX\n", address);
+        reported = 1;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       mmio_read
+//
+//  Arguments:      address:         The register address
+//
+//  Returns:        The register value
+//
+//  Description:    This function reads a simulated register.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int mmio_read(unsigned long address)
+{
+    unsigned long offset = address - MMIO_BASE;
+
+
+    simTime += SIM_ACCESS_NANOSECONDS;
+
+    if (offset - SIM_AUX_OFFSET < SIM_BLOCK_SIZE) {
+        return sim_uart_read(offset - SIM_AUX_OFFSET);
+    }
+    if (offset - SIM_GPIO_OFFSET < SIM_BLOCK_SIZE) {
+        return sim_gpio_read(offset - SIM_GPIO_OFFSET);
+    }
+    if (offset - SIM_PL011_OFFSET < SIM_BLOCK_SIZE) {
+        return sim_pl011_read(offset - SIM_PL011_OFFSET);
+    }
+    if (offset - SIM_TIMER_OFFSET < SIM_BLOCK_SIZE) {
+        return timerRead(offset - SIM_TIMER_OFFSET);
+    }
+    if (offset - SIM_MAILBOX_OFFSET < SIM_BLOCK_SIZE) {
+        return sim_mailbox_read(offset - SIM_MAILBOX_OFFSET);
+    }
+    if (offset - SIM_DMA_OFFSET < SIM_DMA_SIZE) {
+        return sim_dma_read(offset - SIM_DMA_OFFSET);
+    }
+
+    unmodelled(address);
+    return 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       mmio_write
+//
+//  Arguments:      address:         The register address
+//                  value:           The value to write
+//
+//  Returns:        void
+//
+//  Description:    This function writes a simulated register.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void mmio_write(unsigned long address, unsigned int value)
+{
+    unsigned long offset = address - MMIO_BASE;
+
+
+    simTime += SIM_ACCESS_NANOSECONDS;
+
+    if (offset - SIM_AUX_OFFSET < SIM_BLOCK_SIZE) {
+        sim_uart_write(offset - SIM_AUX_OFFSET, value);
+    } else if (offset - SIM_GPIO_OFFSET < SIM_BLOCK_SIZE) {
+        sim_gpio_write(offset - SIM_GPIO_OFFSET, value);
+    } else if (offset - SIM_PL011_OFFSET < SIM_BLOCK_SIZE) {
+        sim_pl011_write(offset - SIM_PL011_OFFSET, value);
+    } else if (offset - SIM_TIMER_OFFSET < SIM_BLOCK_SIZE) {
+        // The timer counter is read-only
+    } else if (offset - SIM_MAILBOX_OFFSET < SIM_BLOCK_SIZE) {
+        sim_mailbox_write(offset - SIM_MAILBOX_OFFSET, value);
+    } else if (offset - SIM_DMA_OFFSET < SIM_DMA_SIZE) {
+        sim_dma_write(offset - SIM_DMA_OFFSET, value);
+    } else {
+        unmodelled(address);
+    }
+}
@@ -0,0 +1,274 @@
+// The functions in this file model the DMA controller. Starting a channel
+// runs its whole chain of control blocks at once, reading the blocks and
+// moving the data in host memory, since every bus address the kernel uses
+// is in the low 1 GB. The channel then reports itself active for as long
+// as the transfer would take, at SIM_DMA_BYTES_PER_MICROSECOND, so a
+// driver that polls it waits as long as it would on the Pi.
+
+// Needed header files
+#include <stdio.h>
+#include <string.h>
+#include "host.h"
+
+// Channel register offsets from the start of each channel's block
+#define DMA_CS              0x00
+#define DMA_CONBLK_AD       0x04
+#define DMA_DEBUG           0x20
+#define DMA_CHANNEL_SIZE    0x100
+#define DMA_CHANNELS        15
+
+// Global register offsets
+#define DMA_ENABLE          0xFF0
+
+// Channel control and status bits
+#define DMA_CS_ACTIVE       (1 << 0)
+#define DMA_CS_END          (1 << 1)
+#define DMA_CS_INT          (1 << 2)
+#define DMA_CS_ERROR        (1 << 8)
+#define DMA_CS_RESET        (1U << 31)
+
+// Transfer information bits
+#define DMA_TI_INTEN        (1 << 0)
+#define DMA_TI_TDMODE       (1 << 1)
+#define DMA_TI_DEST_INC     (1 << 4)
+#define DMA_TI_SRC_INC      (1 << 8)
+
+// The simulated transfer rate
+#define SIM_DMA_BYTES_PER_MICROSECOND   400
+
+// A control block, as the kernel lays it out
+struct ControlBlock {
+    unsigned int info;
+    unsigned int source;
+    unsigned int destination;
+    unsigned int length;
+    unsigned int stride;
+    unsigned int next;
+    unsigned int reserved[2];
+};
+
+// The state of each channel
+struct Channel {
+    unsigned int status;            // CS bits other than ACTIVE
+    unsigned int controlBlock;      // CONBLK_AD
+    unsigned long doneTime;         // When the running chain ends
+};
+
+static struct Channel channels[DMA_CHANNELS];
+static unsigned int enable;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       busToHost
+//
+//  Arguments:      address:         A bus address
+//
+//  Returns:        The host address of the same memory
+//
+//  Description:    This function drops the bus alias bits of an address.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned char *busToHost(unsigned int address)
+{
+    return (unsigned char *)(unsigned long)(address & 0x3FFFFFFF);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       transfer
+//
+//  Arguments:      block:           The control block to carry out
+//
+//  Returns:        The number of bytes moved
+//
+//  Description:    This function moves the data of one control block, one
+//                  row at a time in 2D mode. A source that does not
+//                  increment is read as one repeated word, and a
+//                  destination that does not increment keeps only the last
+//                  word written, as a peripheral register would.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned long transfer(const struct ControlBlock *block)
+{
+    unsigned char *source = busToHost(block->source);
+    unsigned char *destination = busToHost(block->destination);
+    unsigned int width, rows, row, i;
+    short sourceStride, destinationStride;
+
+
+    if (block->info & DMA_TI_TDMODE) {
+        width = block->length & 0xFFFF;
+        rows = ((block->length >> 16) & 0x3FFF) + 1;
+        sourceStride = (short)(block->stride & 0xFFFF);
+        destinationStride = (short)(block->stride >> 16);
+    } else {
+        width = block->length & 0x3FFFFFFF;
+        rows = 1;
+        sourceStride = destinationStride = 0;
+    }
+
+    for (row = 0; row < rows; row++) {
+        if ((block->info & DMA_TI_SRC_INC) && (block->info & DMA_TI_DEST_INC)) {
+            memcpy(destination, source, width);
+        } else if (block->info & DMA_TI_DEST_INC) {
+            for (i = 0; i < width; i++) {
+                destination[i] = source[i & 3];
+            }
+        } else if (width >= 4) {
+            memcpy(destination, source + ((block->info & DMA_TI_SRC_INC) ? width - 4 : 0), 4);
+        }
+
+        if (block->info & DMA_TI_SRC_INC) {
+            source += width;
+        }
+        if (block->info & DMA_TI_DEST_INC) {
+            destination += width;
+        }
+        source += sourceStride;
+        destination += destinationStride;
+    }
+
+    return (unsigned long)width * rows;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       start
+//
+//  Arguments:      channel:         The channel to start
+//
+//  Returns:        void
+//
+//  Description:    This function runs a channel's chain of control blocks,
+//                  and works out when it will have finished.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void start(struct Channel *channel)
+{
+    const struct ControlBlock *block;
+    unsigned long bytes = 0;
+    unsigned int address = channel->controlBlock;
+    unsigned int interrupt = 0;
+
+
+    if (!(enable & (1 << (channel - channels)))) {
+        fprintf(stderr, "DMA channel %d started while disabled\n", (int)(channel - channels));
+        channel->status |= DMA_CS_ERROR;
+        return;
+    }
+
+    while (address) {
+        if (address & 31) {
+            channel->status |= DMA_CS_ERROR;
+            break;
+        }
+        block = (const struct ControlBlock *)busToHost(address);
+        bytes += transfer(block);
+        interrupt |= block->info & DMA_TI_INTEN;
+        address = block->next;
+    }
+
+    channel->doneTime = simTime + (bytes * 1000) / SIM_DMA_BYTES_PER_MICROSECOND;
+    channel->status |= DMA_CS_END | (interrupt ? DMA_CS_INT : 0);
+    channel->controlBlock = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       sim_dma_read
+//
+//  Arguments:      offset:          Register offset in the DMA block
+//
+//  Returns:        The register value
+//
+//  Description:    This function reads a DMA register. A channel is active
+//                  until its chain's transfer time has passed.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int sim_dma_read(unsigned int offset)
+{
+    struct Channel *channel;
+
+
+    if (offset == DMA_ENABLE) {
+        return enable;
+    }
+    if (offset / DMA_CHANNEL_SIZE >= DMA_CHANNELS) {
+        return 0;
+    }
+
+    channel = &channels[offset / DMA_CHANNEL_SIZE];
+    switch (offset % DMA_CHANNEL_SIZE) {
+    case DMA_CS:
+        return channel->status | (simTime < channel->doneTime ? DMA_CS_ACTIVE : 0);
+    case DMA_CONBLK_AD:
+        return channel->controlBlock;
+    default:
+        return 0;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       sim_dma_write
+//
+//  Arguments:      offset:          Register offset in the DMA block
+//                  value:           The value to write
+//
+//  Returns:        void
+//
+//  Description:    This function writes a DMA register. Writing the END or
+//                  INT bit of CS clears it, and setting ACTIVE starts the
+//                  chain at CONBLK_AD.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void sim_dma_write(unsigned int offset, unsigned int value)
+{
+    struct Channel *channel;
+
+
+    if (offset == DMA_ENABLE) {
+        enable = value & ((1 << DMA_CHANNELS) - 1);
+        return;
+    }
+    if (offset / DMA_CHANNEL_SIZE >= DMA_CHANNELS) {
+        return;
+    }
+
+    channel = &channels[offset / DMA_CHANNEL_SIZE];
+    switch (offset % DMA_CHANNEL_SIZE) {
+    case DMA_CS:
+        if (value & DMA_CS_RESET) {
+            channel->status = 0;
+            channel->controlBlock = 0;
+            channel->doneTime = 0;
+            break;
+        }
+        channel->status &= ~(value & (DMA_CS_END | DMA_CS_INT));
+        if ((value & DMA_CS_ACTIVE) && simTime >= channel->doneTime) {
+            channel->status &= ~DMA_CS_ERROR;
+            start(channel);
+        }
+        break;
+    case DMA_CONBLK_AD:
+        channel->controlBlock = value;
+        break;
+    case DMA_DEBUG:
+        break;
+    }
+}
@@ -0,0 +1,167 @@
+// The functions in this file model the GPIO pins, with an SNES controller
+// connected the way snes.c expects: LATCH on pin 9 and CLOCK on pin 11 as
+// outputs, and DATA on pin 10 as an input. The controller is a 16-bit
+// parallel-in, serial-out shift register. While LATCH is high it loads the
+// buttons, and each rising edge of CLOCK shifts the next button onto DATA.
+// DATA is low for a pressed button.
+
+// Needed header files
+#include "host.h"
+
+// GPIO register offsets
+#define GPSET0          0x1C
+#define GPCLR0          0x28
+#define GPLEV0          0x34
+
+// The pins the controller is connected to
+#define SNES_LATCH      9
+#define SNES_DATA       10
+#define SNES_CLOCK      11
+
+// The number of bits the controller shifts out
+#define SNES_BITS       16
+
+// Registers that only hold what was written, such as GPFSELn and GPPUD
+static unsigned int registers[SIM_BLOCK_SIZE / 4];
+
+// The output levels set with GPSET0 and GPCLR0
+static unsigned int outputLevels;
+
+// The buttons held, as get_SNES() encodes them (1 means pressed), the
+// buttons latched into the shift register, and the bit on DATA
+static unsigned short snesButtons;
+static unsigned short snesLatched;
+static int snesBit;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       snesData
+//
+//  Arguments:      none
+//
+//  Returns:        The level of the DATA line, 0 or 1
+//
+//  Description:    This function works out what the controller puts on the
+//                  DATA line. Once all 16 bits have been shifted out, the
+//                  line stays low.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int snesData()
+{
+    if (snesBit >= SNES_BITS) {
+        return 0;
+    }
+
+    return ((snesLatched >> snesBit) & 1) ? 0 : 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       setOutputs
+//
+//  Arguments:      levels:          The new output levels
+//
+//  Returns:        void
+//
+//  Description:    This function changes the output levels and lets the
+//                  controller react to the LATCH and CLOCK lines.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void setOutputs(unsigned int levels)
+{
+    unsigned int rising = levels & ~outputLevels;
+
+
+    outputLevels = levels;
+
+    if (outputLevels & (1 << SNES_LATCH)) {
+        snesLatched = snesButtons;
+        snesBit = 0;
+    } else if ((rising & (1 << SNES_CLOCK)) && snesBit < SNES_BITS) {
+        snesBit++;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       sim_gpio_read
+//
+//  Arguments:      offset:          Register offset in the GPIO block
+//
+//  Returns:        The register value
+//
+//  Description:    This function reads a GPIO register. GPLEV0 shows the
+//                  output levels, with the controller DATA line on pin 10.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int sim_gpio_read(unsigned int offset)
+{
+    if (offset == GPLEV0) {
+        return (outputLevels & ~(1 << SNES_DATA)) | (snesData() << SNES_DATA);
+    }
+
+    return registers[(offset / 4) % (SIM_BLOCK_SIZE / 4)];
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       sim_gpio_write
+//
+//  Arguments:      offset:          Register offset in the GPIO block
+//                  value:           The value written
+//
+//  Returns:        void
+//
+//  Description:    This function writes a GPIO register. GPSET0 and GPCLR0
+//                  set and clear output levels, and the rest are kept.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void sim_gpio_write(unsigned int offset, unsigned int value)
+{
+    switch (offset) {
+    case GPSET0:
+        setOutputs(outputLevels | value);
+        break;
+
+    case GPCLR0:
+        setOutputs(outputLevels & ~value);
+        break;
+
+    default:
+        registers[(offset / 4) % (SIM_BLOCK_SIZE / 4)] = value;
+        break;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       sim_snes_set_buttons
+//
+//  Arguments:      buttons:         The buttons held, encoded as get_SNES()
+//                                   returns them
+//
+//  Returns:        void
+//
+//  Description:    This function sets which controller buttons are held.
+//                  They are read by the next LATCH pulse.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void sim_snes_set_buttons(unsigned short buttons)
+{
+    snesButtons = buttons;
+}
@@ -0,0 +1,486 @@
+// The functions in this file model the video core mailboxes. A request
+// written to mailbox 1 on the property tag channel is answered in the
+// buffer, as the firmware would, and its address appears in mailbox 0
+// SIM_MAILBOX_NANOSECONDS later. The frame buffer is allocated in ordinary
+// memory, and the state of the display is kept in hostDisplay, so the
+// screen can be saved to a file. ARM memory is a second mapping, which the
+// kernel's memory arena manages, and GPU memory a third, given out to
+// TAG_ALLOCATE_MEMORY requests.
+
+// Needed header files
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "../mailbox.h"
+#include "host.h"
+
+// Mailbox register offsets
+#define MAILBOX0_READ       0x00
+#define MAILBOX0_STATUS     0x18
+#define MAILBOX1_WRITE      0x20
+#define MAILBOX1_STATUS     0x38
+
+#define MAILBOX_EMPTY       0x40000000
+
+// Where the frame buffer is mapped. The kernel passes frame buffer and
+// cursor addresses as 30-bit bus addresses, so everything the video core
+// sees must be in the low 1 GB of the address space. This is also why the
+// host build is linked without position-independent code.
+#define HOST_FRAMEBUFFER_ADDRESS    0x10000000UL
+
+// Where the simulated ARM memory is mapped, and its size. It only needs to
+// hold what the game allocates, not the whole of a Raspberry Pi's memory.
+#define HOST_ARM_MEMORY_ADDRESS     0x20000000UL
+#define HOST_ARM_MEMORY_SIZE        0x04000000UL
+
+// Where the simulated GPU memory is mapped, its size, and the most blocks
+// that can be allocated from it at once. Blocks are handed out upwards,
+// and only the space of the last one is reused when it is released.
+#define HOST_GPU_MEMORY_ADDRESS     0x30000000UL
+#define HOST_GPU_MEMORY_SIZE        0x01000000UL
+#define HOST_GPU_HANDLES            64
+
+// The DMA channels the firmware leaves to the ARM, as on the Pi 3
+#define HOST_DMA_CHANNELS           0x7F35
+
+struct HostDisplay hostDisplay;
+
+// The limits and current rates of the clocks that are modelled, in Hz,
+// indexed by clock ID. The ARM boots at its minimum rate, as on the Pi 3,
+// and the UART clock runs at the 48 MHz the firmware sets by default.
+static const unsigned int clockMinRate[CLOCK_PWM + 1] = {
+    [CLOCK_UART] = 48000000, [CLOCK_ARM] = 600000000, [CLOCK_CORE] = 250000000
+};
+static const unsigned int clockMaxRate[CLOCK_PWM + 1] = {
+    [CLOCK_UART] = 48000000, [CLOCK_ARM] = 1200000000, [CLOCK_CORE] = 400000000
+};
+static unsigned int clockRate[CLOCK_PWM + 1] = {
+    [CLOCK_UART] = 48000000, [CLOCK_ARM] = 600000000, [CLOCK_CORE] = 250000000
+};
+
+// The SoC temperature, and the limit the firmware throttles at
+#define HOST_MAX_TEMPERATURE        85000
+unsigned int simTemperature = 50000;
+
+// The GPU memory blocks, indexed by handle less one, and the next free
+// offset. A block with no size is free.
+static struct {
+    unsigned long offset;
+    unsigned long size;
+    int locked;
+} gpuBlocks[HOST_GPU_HANDLES];
+static unsigned long gpuTop;
+
+// The response waiting in mailbox 0, and when it arrives
+static unsigned int response;
+static unsigned long responseTime;
+static int responsePending;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       allocateFrameBuffer
+//
+//  Arguments:      none
+//
+//  Returns:        The bus address of the frame buffer, or 0 if it cannot
+//                  be allocated
+//
+//  Description:    This function maps memory for a frame buffer of the
+//                  current virtual size at a fixed low address.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int allocateFrameBuffer()
+{
+    static unsigned long mappedSize;
+    unsigned long size = hostDisplay.virtualWidth * hostDisplay.virtualHeight *
+                         (hostDisplay.depth / 8);
+    void *address;
+
+
+    if (hostDisplay.frameBuffer) {
+        munmap(hostDisplay.frameBuffer, mappedSize);
+    }
+
+    address = mmap((void *)HOST_FRAMEBUFFER_ADDRESS, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (address == MAP_FAILED) {
+        perror("Cannot map the frame buffer");
+        hostDisplay.frameBuffer = 0;
+        return 0;
+    }
+
+    hostDisplay.frameBuffer = address;
+    mappedSize = size;
+
+    return (unsigned int)HOST_FRAMEBUFFER_ADDRESS | 0xC0000000;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       mapArmMemory
+//
+//  Arguments:      none
+//
+//  Returns:        The size of the simulated ARM memory, or 0 if it cannot
+//                  be mapped
+//
+//  Description:    This function maps the simulated ARM memory at a fixed
+//                  low address the first time it is asked for.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int mapArmMemory()
+{
+    static int mapped;
+    void *address;
+
+
+    if (!mapped) {
+        address = mmap((void *)HOST_ARM_MEMORY_ADDRESS, HOST_ARM_MEMORY_SIZE,
+                       PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED_NOREPLACE,
+                       -1, 0);
+        if (address == MAP_FAILED) {
+            perror("Cannot map the ARM memory");
+            return 0;
+        }
+        mapped = 1;
+    }
+
+    return HOST_ARM_MEMORY_SIZE;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       allocateGpuMemory
+//
+//  Arguments:      size:            Bytes wanted
+//                  alignment:       Alignment wanted, a power of two
+//
+//  Returns:        A handle, or 0 if the memory cannot be allocated
+//
+//  Description:    This function gives out a block of the simulated GPU
+//                  memory, mapping it the first time. New blocks are
+//                  always zero, since their memory has not been used.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int allocateGpuMemory(unsigned int size, unsigned int alignment)
+{
+    static int mapped;
+    unsigned long offset;
+    unsigned int handle;
+    void *address;
+
+
+    if (!mapped) {
+        address = mmap((void *)HOST_GPU_MEMORY_ADDRESS, HOST_GPU_MEMORY_SIZE,
+                       PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED_NOREPLACE,
+                       -1, 0);
+        if (address == MAP_FAILED) {
+            perror("Cannot map the GPU memory");
+            return 0;
+        }
+        mapped = 1;
+    }
+
+    if (alignment == 0 || (alignment & (alignment - 1))) {
+        alignment = 1;
+    }
+    offset = (gpuTop + alignment - 1) & ~(unsigned long)(alignment - 1);
+    if (size == 0 || offset + size > HOST_GPU_MEMORY_SIZE) {
+        return 0;
+    }
+
+    for (handle = 0; handle < HOST_GPU_HANDLES; handle++) {
+        if (gpuBlocks[handle].size == 0) {
+            gpuBlocks[handle].offset = offset;
+            gpuBlocks[handle].size = size;
+            gpuBlocks[handle].locked = 0;
+            gpuTop = offset + size;
+            return handle + 1;
+        }
+    }
+
+    return 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       gpuBlock
+//
+//  Arguments:      handle:          A GPU memory handle
+//
+//  Returns:        The index of the block, or -1 if the handle is not
+//                  allocated
+//
+//  Description:    This function checks a handle from the kernel.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static int gpuBlock(unsigned int handle)
+{
+    if (handle == 0 || handle > HOST_GPU_HANDLES || gpuBlocks[handle - 1].size == 0) {
+        return -1;
+    }
+
+    return handle - 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       answerTags
+//
+//  Arguments:      buffer:          The property tag request
+//
+//  Returns:        void
+//
+//  Description:    This function answers each property tag in the request
+//                  that the kernel uses, and marks it as a response. Unknown
+//                  tags are left unanswered.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void answerTags(volatile unsigned int *buffer)
+{
+    volatile unsigned int *tag = &buffer[2];
+    volatile unsigned int *value;
+    unsigned int i, color;
+    int block;
+
+
+    while (*tag != TAG_LAST) {
+        value = &tag[3];
+        tag[2] = TAG_RESPONSE | tag[1];
+
+        switch (tag[0]) {
+        case TAG_SET_PHYSICAL_WIDTH_HEIGHT:
+            hostDisplay.width = value[0];
+            hostDisplay.height = value[1];
+            break;
+
+        case TAG_SET_VIRTUAL_WIDTH_HEIGHT:
+            hostDisplay.virtualWidth = value[0];
+            hostDisplay.virtualHeight = value[1];
+            break;
+
+        case TAG_SET_VIRTUAL_OFFSET:
+            hostDisplay.offsetX = value[0];
+            hostDisplay.offsetY = value[1];
+            break;
+
+        case TAG_SET_DEPTH:
+            hostDisplay.depth = (value[0] == 8 || value[0] == 16 || value[0] == 24) ?
+                                value[0] : 32;
+            value[0] = hostDisplay.depth;
+            break;
+
+        case TAG_SET_PIXEL_ORDER:
+            hostDisplay.pixelOrder = value[0] ? 1 : 0;
+            value[0] = hostDisplay.pixelOrder;
+            break;
+
+        case TAG_SET_PALETTE:
+            // Entries come as 0xAABBGGRR, and are kept as RGB codes
+            if (value[0] + value[1] > 256) {
+                value[0] = 1;
+                break;
+            }
+            for (i = 0; i < value[1]; i++) {
+                color = value[2 + i];
+                hostDisplay.palette[value[0] + i] = ((color & 0xFF) << 16) | (color & 0xFF00) |
+                                                    ((color >> 16) & 0xFF);
+            }
+            value[0] = 0;
+            break;
+
+        case TAG_GET_CLOCK_RATE:
+        case TAG_GET_MIN_CLOCK_RATE:
+        case TAG_GET_MAX_CLOCK_RATE:
+        case TAG_SET_CLOCK_RATE:
+            if (value[0] > CLOCK_PWM || !clockMaxRate[value[0]]) {
+                tag[2] = 0;
+                break;
+            }
+            if (tag[0] == TAG_SET_CLOCK_RATE) {
+                clockRate[value[0]] = value[1] < clockMinRate[value[0]] ? clockMinRate[value[0]] :
+                                      value[1] > clockMaxRate[value[0]] ? clockMaxRate[value[0]] :
+                                      value[1];
+            }
+            value[1] = tag[0] == TAG_GET_MIN_CLOCK_RATE ? clockMinRate[value[0]] :
+                       tag[0] == TAG_GET_MAX_CLOCK_RATE ? clockMaxRate[value[0]] :
+                       clockRate[value[0]];
+            break;
+
+        case TAG_GET_TEMPERATURE:
+            value[1] = simTemperature;
+            break;
+
+        case TAG_GET_MAX_TEMPERATURE:
+            value[1] = HOST_MAX_TEMPERATURE;
+            break;
+
+        case TAG_GET_DMA_CHANNELS:
+            value[0] = HOST_DMA_CHANNELS;
+            break;
+
+        case TAG_GET_ARM_MEMORY:
+            value[1] = mapArmMemory();
+            value[0] = value[1] ? HOST_ARM_MEMORY_ADDRESS : 0;
+            break;
+
+        case TAG_ALLOCATE_MEMORY:
+            value[0] = allocateGpuMemory(value[0], value[1]);
+            break;
+
+        case TAG_LOCK_MEMORY:
+            block = gpuBlock(value[0]);
+            if (block < 0) {
+                value[0] = 0;
+                break;
+            }
+            gpuBlocks[block].locked = 1;
+            value[0] = (unsigned int)(HOST_GPU_MEMORY_ADDRESS + gpuBlocks[block].offset) |
+                       0xC0000000;
+            break;
+
+        case TAG_UNLOCK_MEMORY:
+            block = gpuBlock(value[0]);
+            if (block >= 0) {
+                gpuBlocks[block].locked = 0;
+            }
+            value[0] = block < 0;
+            break;
+
+        case TAG_RELEASEMEMORY:
+            block = gpuBlock(value[0]);
+            if (block >= 0) {
+                if (gpuBlocks[block].locked) {
+                    fprintf(stderr, "GPU memory released while locked\n");
+                }
+                if (gpuBlocks[block].offset + gpuBlocks[block].size == gpuTop) {
+                    gpuTop = gpuBlocks[block].offset;
+                    memset((void *)(HOST_GPU_MEMORY_ADDRESS + gpuTop), 0,
+                           gpuBlocks[block].size);
+                }
+                gpuBlocks[block].size = 0;
+            }
+            value[0] = block < 0;
+            break;
+
+        case TAG_ALLOCATE_BUFFER:
+            value[0] = allocateFrameBuffer();
+            value[1] = hostDisplay.virtualWidth * hostDisplay.virtualHeight *
+                       (hostDisplay.depth / 8);
+            break;
+
+        case TAG_GET_PITCH:
+            value[0] = hostDisplay.virtualWidth * (hostDisplay.depth / 8);
+            break;
+
+        case TAG_SET_CURSOR_INFO:
+            hostDisplay.cursorWidth = value[0];
+            hostDisplay.cursorHeight = value[1];
+            hostDisplay.cursorImage = (const unsigned int *)(unsigned long)(value[3] & 0x3FFFFFFF);
+            value[0] = 0;
+            break;
+
+        case TAG_SET_CURSOR_STATE:
+            hostDisplay.cursorVisible = value[0];
+            hostDisplay.cursorX = value[1];
+            hostDisplay.cursorY = value[2];
+            value[0] = 0;
+            break;
+
+        default:
+            tag[2] = 0;
+            break;
+        }
+
+        // Step over the tag header and its value buffer
+        tag += 3 + (tag[1] / 4);
+    }
+
+    buffer[1] = 0x80000000;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       sim_mailbox_read
+//
+//  Arguments:      offset:          Register offset in the mailbox block
+//
+//  Returns:        The register value
+//
+//  Description:    This function reads a mailbox register. Mailbox 1 is
+//                  never full, and mailbox 0 is empty until the response to
+//                  the last request is due.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int sim_mailbox_read(unsigned int offset)
+{
+    int ready = responsePending && simTime >= responseTime;
+
+
+    switch (offset) {
+    case MAILBOX0_STATUS:
+        return ready ? 0 : MAILBOX_EMPTY;
+
+    case MAILBOX0_READ:
+        if (!ready) {
+            return 0;
+        }
+        responsePending = 0;
+        return response;
+
+    default:
+        return 0;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       sim_mailbox_write
+//
+//  Arguments:      offset:          Register offset in the mailbox block
+//                  value:           The value written
+//
+//  Returns:        void
+//
+//  Description:    This function writes a mailbox register. A message on
+//                  the property tag channel is the address of a request
+//                  buffer in its upper 28 bits, which is answered at once,
+//                  while the reply is held back for the simulated round
+//                  trip time. Messages on other channels are dropped.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void sim_mailbox_write(unsigned int offset, unsigned int value)
+{
+    if (offset != MAILBOX1_WRITE || (value & 0xF) != CHANNEL_PROPERTY_TAGS_ARMTOVC) {
+        return;
+    }
+
+    answerTags((volatile unsigned int *)(unsigned long)(value & ~0xF));
+
+    response = value;
+    responseTime = simTime + SIM_MAILBOX_NANOSECONDS;
+    responsePending = 1;
+}
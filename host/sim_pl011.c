@@ -0,0 +1,283 @@
+// The functions in this file model the PL011 UART (UART0), for kernels
+// built with CONSOLE_PL011 defined. Characters written to the data
+// register enter a 16-entry transmit FIFO, which drains at the Baud rate
+// set by the divisor registers, so a driver that polls the flags waits as
+// long as it would on the Pi. The raw transmit and receive interrupt
+// status follow the FIFO levels set in IFLS. Transmitted characters are
+// echoed to the standard error stream, as the Mini UART model does.
+
+// Needed header files
+#include <stdio.h>
+#include "host.h"
+
+// PL011 register offsets
+#define UART0_DR        0x00
+#define UART0_FR        0x18
+#define UART0_IBRD      0x24
+#define UART0_FBRD      0x28
+#define UART0_CR        0x30
+#define UART0_IFLS      0x34
+#define UART0_RIS       0x3C
+#define UART0_MIS       0x40
+#define UART0_IMSC      0x38
+#define UART0_ICR       0x44
+
+// Flag register bits
+#define FR_BUSY         (1 << 3)
+#define FR_RXFE         (1 << 4)
+#define FR_TXFF         (1 << 5)
+#define FR_RXFF         (1 << 6)
+#define FR_TXFE         (1 << 7)
+
+// Control register bits
+#define CR_UARTEN       (1 << 0)
+#define CR_TXE          (1 << 8)
+
+// Interrupt bits
+#define INT_RX          (1 << 4)
+#define INT_TX          (1 << 5)
+
+// FIFO depth
+#define FIFO_SIZE       16
+
+// The UART clock the mailbox model reports, in Hz
+#define SIM_PL011_CLOCK 48000000UL
+
+// Registers that only hold what was written
+static unsigned int registers[SIM_BLOCK_SIZE / 4];
+
+// The time the last character queued for transmission will have been sent,
+// and the number of characters sent so far
+static unsigned long transmitDoneTime;
+static unsigned long transmitted;
+
+// The receive FIFO
+static char receiveFifo[FIFO_SIZE];
+static int receiveHead, receiveCount;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       characterTime
+//
+//  Arguments:      none
+//
+//  Returns:        The time to send one character, in nanoseconds
+//
+//  Description:    This function works out the time for one start bit,
+//                  eight data bits and one stop bit at the programmed Baud
+//                  rate, which is clock / (16 * divisor), where the divisor
+//                  is IBRD with FBRD as 64ths.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned long characterTime()
+{
+    unsigned long divisor = (registers[UART0_IBRD / 4] << 6) | (registers[UART0_FBRD / 4] & 0x3F);
+
+
+    return (10UL * 1000000000UL * divisor) / (4 * SIM_PL011_CLOCK);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       transmitFifoCount
+//
+//  Arguments:      none
+//
+//  Returns:        The number of characters still in the transmit FIFO
+//
+//  Description:    This function works out how many queued characters have
+//                  not been sent yet at the current simulated time.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned long transmitFifoCount()
+{
+    unsigned long each = characterTime();
+
+
+    if (transmitDoneTime <= simTime || each == 0) {
+        return 0;
+    }
+
+    return (transmitDoneTime - simTime + each - 1) / each;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       rawInterrupts
+//
+//  Arguments:      none
+//
+//  Returns:        The raw interrupt status
+//
+//  Description:    This function works out the transmit and receive
+//                  interrupts from the FIFO levels. IFLS gives each level
+//                  in eighths: 1, 2, 4, 6 or 7 of 8.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int rawInterrupts()
+{
+    static const unsigned int eighths[8] = { 1, 2, 4, 6, 7, 7, 7, 7 };
+    unsigned int status = 0;
+
+
+    if (transmitFifoCount() <= (FIFO_SIZE * eighths[registers[UART0_IFLS / 4] & 0x7]) / 8) {
+        status |= INT_TX;
+    }
+    if (receiveCount >= (FIFO_SIZE * eighths[(registers[UART0_IFLS / 4] >> 3) & 0x7]) / 8) {
+        status |= INT_RX;
+    }
+
+    return status;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       sim_pl011_read
+//
+//  Arguments:      offset:          Register offset in the UART0 block
+//
+//  Returns:        The register value
+//
+//  Description:    This function reads a PL011 register.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int sim_pl011_read(unsigned int offset)
+{
+    unsigned int flags = 0;
+    char c;
+
+
+    switch (offset) {
+    case UART0_DR:
+        if (receiveCount == 0) {
+            return 0;
+        }
+        c = receiveFifo[receiveHead];
+        receiveHead = (receiveHead + 1) % FIFO_SIZE;
+        receiveCount--;
+        return (unsigned char)c;
+
+    case UART0_FR:
+        if (transmitDoneTime > simTime) {
+            flags |= FR_BUSY;
+        }
+        if (transmitFifoCount() == 0) {
+            flags |= FR_TXFE;
+        }
+        if (transmitFifoCount() >= FIFO_SIZE) {
+            flags |= FR_TXFF;
+        }
+        flags |= receiveCount ? 0 : FR_RXFE;
+        flags |= receiveCount == FIFO_SIZE ? FR_RXFF : 0;
+        return flags;
+
+    case UART0_RIS:
+        return rawInterrupts();
+
+    case UART0_MIS:
+        return rawInterrupts() & registers[UART0_IMSC / 4];
+
+    default:
+        return registers[(offset / 4) % (SIM_BLOCK_SIZE / 4)];
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       sim_pl011_write
+//
+//  Arguments:      offset:          Register offset in the UART0 block
+//                  value:           The value written
+//
+//  Returns:        void
+//
+//  Description:    This function writes a PL011 register. A character
+//                  written to the data register is queued if the UART and
+//                  its transmitter are enabled and the FIFO has room, and
+//                  is lost otherwise, as on the hardware.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void sim_pl011_write(unsigned int offset, unsigned int value)
+{
+    if (offset == UART0_ICR) {
+        return;
+    }
+    if (offset != UART0_DR) {
+        registers[(offset / 4) % (SIM_BLOCK_SIZE / 4)] = value;
+        return;
+    }
+
+    if ((registers[UART0_CR / 4] & (CR_UARTEN | CR_TXE)) != (CR_UARTEN | CR_TXE) ||
+        transmitFifoCount() >= FIFO_SIZE) {
+        return;
+    }
+
+    // The character starts when the ones before it have been sent
+    if (transmitDoneTime < simTime) {
+        transmitDoneTime = simTime;
+    }
+    transmitDoneTime += characterTime();
+    transmitted++;
+
+    if (simUartEcho) {
+        fputc(value & 0xFF, stderr);
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       sim_pl011_transmitted
+//
+//  Arguments:      none
+//
+//  Returns:        The number of characters transmitted so far
+//
+//  Description:    This function lets tests and benchmarks check what the
+//                  driver sent.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned long sim_pl011_transmitted()
+{
+    return transmitted;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       sim_pl011_receive
+//
+//  Arguments:      c:               The character arriving on the RXD line
+//
+//  Returns:        void
+//
+//  Description:    This function puts a character into the receive FIFO.
+//                  It is lost if the FIFO is full.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void sim_pl011_receive(char c)
+{
+    if (receiveCount < FIFO_SIZE) {
+        receiveFifo[(receiveHead + receiveCount) % FIFO_SIZE] = c;
+        receiveCount++;
+    }
+}
@@ -0,0 +1,228 @@
+// The functions in this file model the Mini UART (UART1). Characters written
+// to AUX_MU_IO enter an 8-byte transmit FIFO, which drains at the rate set
+// in AUX_MU_BAUD, so a driver that polls AUX_MU_LSR waits as long as it
+// would on the Pi. Transmitted characters are echoed to the standard error
+// stream. Received characters are queued with sim_uart_receive().
+
+// Needed header files
+#include <stdio.h>
+#include "host.h"
+
+// Mini UART register offsets from the AUX block
+#define AUX_ENABLE      0x04
+#define AUX_MU_IO       0x40
+#define AUX_MU_LSR      0x54
+#define AUX_MU_CNTL     0x60
+#define AUX_MU_STAT     0x64
+#define AUX_MU_BAUD     0x68
+
+// Line status bits
+#define LSR_DATA_READY          0x01
+#define LSR_TRANSMITTER_EMPTY   0x20    // The FIFO can accept a character
+#define LSR_TRANSMITTER_IDLE    0x40    // The FIFO is empty and idle
+
+// FIFO depths
+#define TRANSMIT_FIFO_SIZE      8
+#define RECEIVE_FIFO_SIZE       8
+
+// The system clock the baud rate is divided from, in MHz
+#define SYSTEM_CLOCK_MHZ        250
+
+// Whether transmitted characters are echoed
+int simUartEcho = 1;
+
+// Registers that only hold what was written
+static unsigned int registers[SIM_BLOCK_SIZE / 4];
+
+// The time the last character queued for transmission will have been sent,
+// and the number of characters sent so far
+static unsigned long transmitDoneTime;
+static unsigned long transmitted;
+
+// The receive FIFO
+static char receiveFifo[RECEIVE_FIFO_SIZE];
+static int receiveHead, receiveCount;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       characterTime
+//
+//  Arguments:      none
+//
+//  Returns:        The time to send one character, in nanoseconds
+//
+//  Description:    This function works out the time for one start bit,
+//                  eight data bits and one stop bit at the programmed baud
+//                  rate, which is clock / (8 * (AUX_MU_BAUD + 1)).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned long characterTime()
+{
+    return (10UL * 8 * 1000 * (registers[AUX_MU_BAUD / 4] + 1)) / SYSTEM_CLOCK_MHZ;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       transmitFifoCount
+//
+//  Arguments:      none
+//
+//  Returns:        The number of characters still in the transmit FIFO
+//
+//  Description:    This function works out how many queued characters have
+//                  not been sent yet at the current simulated time.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned long transmitFifoCount()
+{
+    unsigned long each = characterTime();
+
+
+    if (transmitDoneTime <= simTime) {
+        return 0;
+    }
+
+    return (transmitDoneTime - simTime + each - 1) / each;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       sim_uart_read
+//
+//  Arguments:      offset:          Register offset in the AUX block
+//
+//  Returns:        The register value
+//
+//  Description:    This function reads a Mini UART register.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int sim_uart_read(unsigned int offset)
+{
+    unsigned int status = 0;
+    char c;
+
+
+    switch (offset) {
+    case AUX_MU_IO:
+        if (receiveCount == 0) {
+            return 0;
+        }
+        c = receiveFifo[receiveHead];
+        receiveHead = (receiveHead + 1) % RECEIVE_FIFO_SIZE;
+        receiveCount--;
+        return (unsigned char)c;
+
+    case AUX_MU_LSR:
+        if (receiveCount) {
+            status |= LSR_DATA_READY;
+        }
+        if (transmitFifoCount() < TRANSMIT_FIFO_SIZE) {
+            status |= LSR_TRANSMITTER_EMPTY;
+        }
+        if (transmitFifoCount() == 0) {
+            status |= LSR_TRANSMITTER_IDLE;
+        }
+        return status;
+
+    case AUX_MU_STAT:
+        // Only the transmit FIFO level (bits 27:24) is modelled
+        return (unsigned int)transmitFifoCount() << 24;
+
+    default:
+        return registers[(offset / 4) % (SIM_BLOCK_SIZE / 4)];
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       sim_uart_write
+//
+//  Arguments:      offset:          Register offset in the AUX block
+//                  value:           The value written
+//
+//  Returns:        void
+//
+//  Description:    This function writes a Mini UART register. A character
+//                  written to AUX_MU_IO is queued if the UART and its
+//                  transmitter are enabled and the FIFO has room, and is
+//                  lost otherwise, as on the hardware.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void sim_uart_write(unsigned int offset, unsigned int value)
+{
+    if (offset != AUX_MU_IO) {
+        registers[(offset / 4) % (SIM_BLOCK_SIZE / 4)] = value;
+        return;
+    }
+
+    if (!(registers[AUX_ENABLE / 4] & 0x1) || !(registers[AUX_MU_CNTL / 4] & 0x2) ||
+        transmitFifoCount() >= TRANSMIT_FIFO_SIZE) {
+        return;
+    }
+
+    // The character starts when the ones before it have been sent
+    if (transmitDoneTime < simTime) {
+        transmitDoneTime = simTime;
+    }
+    transmitDoneTime += characterTime();
+    transmitted++;
+
+    if (simUartEcho) {
+        fputc(value & 0xFF, stderr);
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       sim_uart_transmitted
+//
+//  Arguments:      none
+//
+//  Returns:        The number of characters transmitted so far
+//
+//  Description:    This function lets tests and benchmarks check what the
+//                  driver sent.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned long sim_uart_transmitted()
+{
+    return transmitted;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       sim_uart_receive
+//
+//  Arguments:      c:               The character arriving on the RXD line
+//
+//  Returns:        void
+//
+//  Description:    This function puts a character into the receive FIFO.
+//                  It is lost if the FIFO is full.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void sim_uart_receive(char c)
+{
+    if (receiveCount < RECEIVE_FIFO_SIZE) {
+        receiveFifo[(receiveHead + receiveCount) % RECEIVE_FIFO_SIZE] = c;
+        receiveCount++;
+    }
+}
@@ -0,0 +1,453 @@
+// This program checks the memory functions in memops.s against the C
+// library's. It is not part of the host build of the game. Instead,
+// 'make test-memops' assembles memops.s with an AArch64 Linux cross
+// toolchain, renames its functions to memops_memset() and so on, so that
+// they do not replace the C library's, links them with this file, and runs
+// the result under Qemu's user mode emulation.
+//
+// Each function is run for every length from 0 to TEST_MAX_LENGTH bytes and
+// a few larger ones, and at every alignment of its pointers from 0 to 15
+// bytes (whole words only for memset32()). Its buffers, including guard
+// bytes on either side of what it should write, must then match what the
+// C library's function leaves, and it must return the right value.
+// memmove() is also run with the source and destination overlapping in
+// both directions, and memcmp() with a difference at the start, middle and
+// end, either way round, with bytes that differ in their top bit, so the
+// sign of its result is checked.
+//
+// The first failures are printed, followed by a summary, and the program
+// exits with a non-zero status if anything failed.
+
+// Needed header files
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The functions in memops.s, renamed when it is assembled
+void *memops_memset(void *destination, int value, unsigned long count);
+void *memops_memset32(void *destination, unsigned int value, unsigned long count);
+void *memops_memcpy(void *destination, const void *source, unsigned long count);
+void *memops_memmove(void *destination, const void *source, unsigned long count);
+int memops_memcmp(const void *first, const void *second, unsigned long count);
+
+// Every length up to this is tried, then the large lengths below, which
+// reach the 64-byte loops and DC ZVA
+#define TEST_MAX_LENGTH         300
+static const unsigned int largeLengths[] = { 1000, 1024, 4096 + 7, 65536 + 13 };
+#define TEST_LARGE_LENGTHS      (sizeof(largeLengths) / sizeof(largeLengths[0]))
+#define TEST_LENGTHS            (TEST_MAX_LENGTH + 1 + TEST_LARGE_LENGTHS)
+
+// The pointer alignments tried, from 0 bytes past a 16-byte boundary
+#define TEST_ALIGNMENTS         16
+
+// Bytes around each destination that must not be written
+#define TEST_GUARD              64
+
+// memmove() is tried with the destination up to this many bytes either
+// side of the source. Large lengths only try the distances listed.
+#define TEST_MAX_DISTANCE       24
+static const int largeDistances[] = { -TEST_MAX_DISTANCE, -9, -8, -1, 1, 8, 9, TEST_MAX_DISTANCE };
+#define TEST_LARGE_DISTANCES    (sizeof(largeDistances) / sizeof(largeDistances[0]))
+
+// The size of each buffer, which holds the largest length with its guard
+// bytes, alignment and memmove() distance, rounded up to the alignment
+#define TEST_BUFFER_SIZE        (65536 + 16 + (2 * (TEST_GUARD + TEST_MAX_DISTANCE)) + \
+                                 TEST_ALIGNMENTS)
+
+// How many failures are printed
+#define TEST_MAX_REPORTS        20
+
+// The buffers the functions under test and the C library's work on
+static unsigned char *actual, *expected, *source, *sourceCopy;
+
+// The number of checks made, and how many failed
+static unsigned long checks, failures;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       testLength
+//
+//  Arguments:      index:           From 0 to TEST_LENGTHS - 1
+//
+//  Returns:        The length to try
+//
+//  Description:    This function gives every length up to TEST_MAX_LENGTH,
+//                  followed by the large lengths.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int testLength(unsigned int index)
+{
+    if (index <= TEST_MAX_LENGTH) {
+        return index;
+    }
+
+    return largeLengths[index - TEST_MAX_LENGTH - 1];
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       fillPattern
+//
+//  Arguments:      buffer:          The buffer to fill
+//                  length:          The number of bytes
+//                  seed:            Chooses the pattern
+//
+//  Returns:        void
+//
+//  Description:    This function fills a buffer with pseudo-random bytes,
+//                  so that a byte copied from the wrong place, or left
+//                  unwritten, shows up.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void fillPattern(unsigned char *buffer, unsigned long length, unsigned int seed)
+{
+    unsigned int state = (seed * 2654435761U) + 1;
+
+
+    while (length--) {
+        state = (state * 1103515245U) + 12345;
+        *buffer++ = state >> 16;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       check
+//
+//  Arguments:      passed:          TRUE (non-zero) if the check passed
+//                  function:        The function checked
+//                  length:          The length it was given
+//                  first:           Alignment of its first pointer
+//                  second:          Alignment of its second pointer, or
+//                                   the memmove() distance
+//
+//  Returns:        void
+//
+//  Description:    This function counts a check, and prints the first
+//                  failures.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void check(int passed, const char *function, unsigned long length, int first, int second)
+{
+    checks++;
+    if (passed) {
+        return;
+    }
+
+    failures++;
+    if (failures <= TEST_MAX_REPORTS) {
+        printf("FAIL %s: length %lu, arguments %d %d\n", function, length, first, second);
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       testMemset
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function checks memset() with zero, which may use
+//                  DC ZVA, with other byte values, and with a value that
+//                  does not fit in a byte, whose top bits must be ignored.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void testMemset()
+{
+    static const int values[] = { 0, 0xA5, -1, 0x1234 };
+    unsigned long length, span;
+    unsigned int value, index, align;
+    void *result;
+
+
+    for (value = 0; value < sizeof(values) / sizeof(values[0]); value++) {
+        for (index = 0; index < TEST_LENGTHS; index++) {
+            length = testLength(index);
+            for (align = 0; align < TEST_ALIGNMENTS; align++) {
+                span = (2 * TEST_GUARD) + align + length;
+                fillPattern(expected, span, index + align);
+                memcpy(actual, expected, span);
+
+                result = memops_memset(actual + TEST_GUARD + align, values[value], length);
+                memset(expected + TEST_GUARD + align, values[value], length);
+
+                check(result == actual + TEST_GUARD + align &&
+                      memcmp(actual, expected, span) == 0, "memset", length, align, values[value]);
+            }
+        }
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       testMemset32
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function checks memset32(), which takes a word
+//                  aligned destination and a number of words, at each word
+//                  alignment within 16 bytes.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void testMemset32()
+{
+    static const unsigned int values[] = { 0, 0x80FF0102 };
+    unsigned long count, span, i;
+    unsigned int value, index, align;
+    void *result;
+
+
+    for (value = 0; value < sizeof(values) / sizeof(values[0]); value++) {
+        for (index = 0; index < TEST_LENGTHS; index++) {
+            count = testLength(index) / 4;
+            for (align = 0; align < TEST_ALIGNMENTS; align += 4) {
+                span = (2 * TEST_GUARD) + align + (count * 4);
+                fillPattern(expected, span, index + align);
+                memcpy(actual, expected, span);
+
+                result = memops_memset32(actual + TEST_GUARD + align, values[value], count);
+                for (i = 0; i < count; i++) {
+                    memcpy(expected + TEST_GUARD + align + (i * 4), &values[value], 4);
+                }
+
+                check(result == actual + TEST_GUARD + align &&
+                      memcmp(actual, expected, span) == 0, "memset32", count, align, 0);
+            }
+        }
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       testMemcpy
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function checks memcpy() between separate buffers,
+//                  at every pair of alignments. The source must be left
+//                  unchanged.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void testMemcpy()
+{
+    unsigned long length, span;
+    unsigned int index, to, from;
+    void *result;
+
+
+    for (index = 0; index < TEST_LENGTHS; index++) {
+        length = testLength(index);
+        for (to = 0; to < TEST_ALIGNMENTS; to++) {
+            for (from = 0; from < TEST_ALIGNMENTS; from++) {
+                span = (2 * TEST_GUARD) + TEST_ALIGNMENTS + length;
+                fillPattern(expected, span, index + to);
+                memcpy(actual, expected, span);
+                fillPattern(source, span, index + from + TEST_ALIGNMENTS);
+                memcpy(sourceCopy, source, span);
+
+                result = memops_memcpy(actual + TEST_GUARD + to, source + TEST_GUARD + from,
+                                       length);
+                memcpy(expected + TEST_GUARD + to, source + TEST_GUARD + from, length);
+
+                check(result == actual + TEST_GUARD + to &&
+                      memcmp(actual, expected, span) == 0 &&
+                      memcmp(source, sourceCopy, span) == 0, "memcpy", length, to, from);
+            }
+        }
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       testMemmove
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function checks memmove() within one buffer, with
+//                  the destination below the source, which copies forwards,
+//                  and above it, which copies backwards. Short distances
+//                  overlap for every length but the smallest.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void testMemmove()
+{
+    unsigned long length, span, from;
+    unsigned int index, align, i, distances;
+    int distance;
+    void *result;
+
+
+    for (index = 0; index < TEST_LENGTHS; index++) {
+        length = testLength(index);
+        distances = (length <= TEST_MAX_LENGTH) ? (2 * TEST_MAX_DISTANCE) + 1 :
+                    TEST_LARGE_DISTANCES;
+
+        for (align = 0; align < TEST_ALIGNMENTS; align++) {
+            for (i = 0; i < distances; i++) {
+                distance = (length <= TEST_MAX_LENGTH) ? (int)i - TEST_MAX_DISTANCE :
+                           largeDistances[i];
+
+                span = (2 * (TEST_GUARD + TEST_MAX_DISTANCE)) + TEST_ALIGNMENTS + length;
+                fillPattern(expected, span, index + align + i);
+                memcpy(actual, expected, span);
+
+                from = TEST_GUARD + TEST_MAX_DISTANCE + align;
+                result = memops_memmove(actual + from + distance, actual + from, length);
+                memmove(expected + from + distance, expected + from, length);
+
+                check(result == actual + from + distance &&
+                      memcmp(actual, expected, span) == 0, "memmove", length, align, distance);
+            }
+        }
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       sign
+//
+//  Arguments:      value:           A comparison result
+//
+//  Returns:        -1, 0 or 1
+//
+//  Description:    This function reduces a memcmp() result to its sign,
+//                  which is all the C library promises.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static int sign(int value)
+{
+    return (value > 0) - (value < 0);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       testMemcmp
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function checks memcmp() on equal buffers, on
+//                  buffers that differ just past the length, which must
+//                  compare equal, and on buffers that differ at the first,
+//                  middle or last byte. The differing bytes are 0x7F and
+//                  0x80, tried both ways round, since the bytes must be
+//                  compared as unsigned.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void testMemcmp()
+{
+    unsigned long length, positions[3], position;
+    unsigned int index, first, second, i, swap;
+    unsigned char *left, *right;
+
+
+    for (index = 0; index < TEST_LENGTHS; index++) {
+        length = testLength(index);
+        positions[0] = 0;
+        positions[1] = length / 2;
+        positions[2] = length - 1;
+
+        for (first = 0; first < TEST_ALIGNMENTS; first++) {
+            for (second = 0; second < TEST_ALIGNMENTS; second++) {
+                left = actual + TEST_GUARD + first;
+                right = source + TEST_GUARD + second;
+                fillPattern(left, length + 1, index);
+                memcpy(right, left, length + 1);
+
+                // Equal, and equal up to the length
+                check(memops_memcmp(left, right, length) == 0, "memcmp", length, first, second);
+                right[length] ^= 0xFF;
+                check(memops_memcmp(left, right, length) == 0, "memcmp", length, first, second);
+                right[length] = left[length];
+
+                // Different at one place, each way round
+                for (i = 0; length && i < 3; i++) {
+                    position = positions[i];
+                    for (swap = 0; swap < 2; swap++) {
+                        left[position] = swap ? 0x80 : 0x7F;
+                        right[position] = swap ? 0x7F : 0x80;
+                        check(sign(memops_memcmp(left, right, length)) ==
+                              sign(memcmp(left, right, length)) &&
+                              sign(memops_memcmp(right, left, length)) ==
+                              sign(memcmp(right, left, length)),
+                              "memcmp", length, first, second);
+                    }
+                    right[position] = left[position];
+                }
+            }
+        }
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       main
+//
+//  Arguments:      none
+//
+//  Returns:        0 if every check passed, 1 otherwise
+//
+//  Description:    This function allocates the buffers, 16-byte aligned so
+//                  that the alignments tried are the real ones, runs the
+//                  checks and prints a summary.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int main()
+{
+    actual = aligned_alloc(TEST_ALIGNMENTS, TEST_BUFFER_SIZE);
+    expected = aligned_alloc(TEST_ALIGNMENTS, TEST_BUFFER_SIZE);
+    source = aligned_alloc(TEST_ALIGNMENTS, TEST_BUFFER_SIZE);
+    sourceCopy = aligned_alloc(TEST_ALIGNMENTS, TEST_BUFFER_SIZE);
+    if (!actual || !expected || !source || !sourceCopy) {
+        fprintf(stderr, "Cannot allocate the test buffers\n");
+        return 1;
+    }
+
+    testMemset();
+    testMemset32();
+    testMemcpy();
+    testMemmove();
+    testMemcmp();
+
+    printf("memops: %lu checks, %lu failed\n", checks, failures);
+
+    return failures != 0;
+}
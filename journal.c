@@ -0,0 +1,457 @@
+// The functions in this file keep a journal of the controller input, so a
+// session can be exported over the UART and replayed exactly, in the kernel
+// or in the host build.
+//
+// Only changes are recorded. Each record is three unsigned LEB128 varints
+// (7 bits per byte, low bits first, the top bit set on all but the last):
+//
+//     frames since the previous record
+//     microseconds since the previous record
+//     the buttons that changed (the old state XOR the new state)
+//
+// so a record is usually 3 or 4 bytes. The journal also holds the seed the
+// game was given, since a replay needs the same mazes. The export is text:
+//
+//     JOURNAL BEGIN <seed> <records> <bytes>
+//     <the records in hexadecimal, 32 bytes per line>
+//     JOURNAL END
+//
+// with the numbers as 8 hexadecimal digits. The same text is read back by
+// journal_import().
+
+// Needed header files
+#include "uart.h"
+#include "systimer.h"
+#include "journal.h"
+
+// The recorded changes, and how much of the buffer they use
+static unsigned char journal[JOURNAL_BYTES];
+static unsigned int journalLength;
+static unsigned int journalRecords;
+static int journalFull;
+
+// The seed the game was given
+static unsigned int journalSeedValue;
+
+// While recording: the current frame, and the frame, time and buttons of
+// the last record. While replaying, the same fields track the next record
+// and the read position in the buffer.
+static unsigned long journalFrame;
+static unsigned long lastFrame;
+static unsigned long lastTime;
+static unsigned short lastButtons;
+static unsigned int replayPosition;
+
+// The hexadecimal digits
+static const char hexDigits[] = "0123456789ABCDEF";
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       putVarint
+//
+//  Arguments:      value:           The number to store
+//                  buffer:          Where to store it, at least 10 bytes
+//
+//  Returns:        The number of bytes stored
+//
+//  Description:    This function encodes a number as an unsigned LEB128
+//                  varint.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static int putVarint(unsigned long value, unsigned char *buffer)
+{
+    int length = 0;
+
+
+    while (value >= 0x80) {
+        buffer[length++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    buffer[length++] = value;
+
+    return length;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       getVarint
+//
+//  Arguments:      value:           Where to return the number
+//
+//  Returns:        TRUE (non-zero) if a whole varint was read, FALSE (zero)
+//                  at the end of the journal
+//
+//  Description:    This function decodes the varint at the replay position,
+//                  and moves past it.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static int getVarint(unsigned long *value)
+{
+    unsigned char byte;
+    int shift = 0;
+
+
+    *value = 0;
+    do {
+        if (replayPosition >= journalLength || shift > 63) {
+            return 0;
+        }
+        byte = journal[replayPosition++];
+        *value |= (unsigned long)(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       journal_init
+//
+//  Arguments:      seed:            The seed the game is given
+//
+//  Returns:        void
+//
+//  Description:    This function empties the journal and starts recording
+//                  from frame 0. The controller state before the first
+//                  frame is taken to be no buttons pressed.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void journal_init(unsigned int seed)
+{
+    journalSeedValue = seed;
+    journalLength = 0;
+    journalRecords = 0;
+    journalFull = 0;
+    journalFrame = 0;
+    lastFrame = 0;
+    lastTime = get_timer_counter();
+    lastButtons = 0;
+    replayPosition = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       journal_record
+//
+//  Arguments:      buttons:         The controller state for this frame, as
+//                                   returned by get_SNES()
+//
+//  Returns:        TRUE (non-zero) if the state changed, FALSE (zero)
+//                  otherwise
+//
+//  Description:    This function is called once per frame, and adds a
+//                  record when the controller state has changed. Once the
+//                  buffer is full, changes are no longer recorded, and the
+//                  export says so.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int journal_record(unsigned short buttons)
+{
+    unsigned char record[30];
+    unsigned long now;
+    int length, i;
+
+
+    journalFrame++;
+
+    if (buttons == lastButtons) {
+        return 0;
+    }
+
+    if (!journalFull) {
+        now = get_timer_counter();
+        length = putVarint(journalFrame - 1 - lastFrame, record);
+        length += putVarint(now - lastTime, record + length);
+        length += putVarint(buttons ^ lastButtons, record + length);
+
+        if (journalLength + length > JOURNAL_BYTES) {
+            journalFull = 1;
+        } else {
+            for (i = 0; i < length; i++) {
+                journal[journalLength++] = record[i];
+            }
+            journalRecords++;
+            lastFrame = journalFrame - 1;
+            lastTime = now;
+        }
+    }
+
+    lastButtons = buttons;
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       journal_export
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function sends the journal over the UART as text,
+//                  in the format described at the top of this file.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void journal_export()
+{
+    char line[(32 * 2) + 2];
+    unsigned int i, j;
+
+
+    if (journalFull) {
+        uart_puts("Journal full, later input was not recorded\n");
+    }
+
+    uart_puts("JOURNAL BEGIN ");
+    uart_puthex(journalSeedValue);
+    uart_puts(" ");
+    uart_puthex(journalRecords);
+    uart_puts(" ");
+    uart_puthex(journalLength);
+    uart_puts("\n");
+
+    for (i = 0; i < journalLength; i += 32) {
+        for (j = 0; j < 32 && i + j < journalLength; j++) {
+            line[j * 2] = hexDigits[journal[i + j] >> 4];
+            line[(j * 2) + 1] = hexDigits[journal[i + j] & 0xF];
+        }
+        line[j * 2] = '\n';
+        line[(j * 2) + 1] = '\0';
+        uart_puts(line);
+    }
+
+    uart_puts("JOURNAL END\n");
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       hexValue
+//
+//  Arguments:      c:               A character
+//
+//  Returns:        The value of a hexadecimal digit, or -1 for any other
+//                  character
+//
+//  Description:    This function converts one hexadecimal digit.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+
+    return -1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       readHex
+//
+//  Arguments:      getc:            Returns the next input character, or 0
+//                                   at the end of the input
+//                  value:           Where to return the number
+//
+//  Returns:        TRUE (non-zero) if a number was read
+//
+//  Description:    This function skips spaces and line breaks, then reads
+//                  a hexadecimal number up to the next other character.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static int readHex(char (*getc)(), unsigned int *value)
+{
+    char c;
+    int digits = 0;
+
+
+    do {
+        c = getc();
+    } while (c == ' ' || c == '\n' || c == '\r');
+
+    *value = 0;
+    while (hexValue(c) >= 0) {
+        *value = (*value << 4) | hexValue(c);
+        digits++;
+        c = getc();
+    }
+
+    return digits > 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       journal_import
+//
+//  Arguments:      getc:            Returns the next input character, or 0
+//                                   at the end of the input. In the kernel
+//                                   this is uart_getc().
+//
+//  Returns:        TRUE (non-zero) if a journal was read, FALSE (zero)
+//                  otherwise
+//
+//  Description:    This function reads an exported journal, skipping any
+//                  text before it, and gets it ready to replay from frame 0.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int journal_import(char (*getc)())
+{
+    static const char begin[] = "JOURNAL BEGIN ";
+    unsigned int seed, records, length, i, high, low;
+    int matched = 0;
+    char c;
+
+
+    // Find the start of the journal
+    while (begin[matched]) {
+        c = getc();
+        if (c == 0) {
+            return 0;
+        }
+        matched = (c == begin[matched]) ? matched + 1 : (c == begin[0]);
+    }
+
+    if (!readHex(getc, &seed) || !readHex(getc, &records) || !readHex(getc, &length) ||
+        length > JOURNAL_BYTES) {
+        return 0;
+    }
+
+    // Each byte is two digits, which may be split across lines
+    for (i = 0; i < length; i++) {
+        do {
+            c = getc();
+        } while (c == '\n' || c == '\r');
+        high = hexValue(c);
+        low = hexValue(getc());
+        if (high > 15 || low > 15) {
+            return 0;
+        }
+        journal[i] = (high << 4) | low;
+    }
+
+    journal_init(seed);
+    journalLength = length;
+    journalRecords = records;
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       journal_seed
+//
+//  Arguments:      none
+//
+//  Returns:        The seed the game was given when the journal was recorded
+//
+//  Description:    This function lets a replay give the game the same seed.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int journal_seed()
+{
+    return journalSeedValue;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       journal_frames
+//
+//  Arguments:      none
+//
+//  Returns:        The number of frames up to and including the last change
+//
+//  Description:    This function tells how long a replay must run to see
+//                  all of the recorded input. It reads through the records
+//                  without disturbing the replay.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned long journal_frames()
+{
+    unsigned int position = replayPosition;
+    unsigned long frames = 0, delta, time, changed;
+
+
+    replayPosition = 0;
+    while (getVarint(&delta) && getVarint(&time) && getVarint(&changed)) {
+        frames += delta;
+    }
+    replayPosition = position;
+
+    return journalRecords ? frames + 1 : 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       journal_replay_next
+//
+//  Arguments:      none
+//
+//  Returns:        The recorded controller state for the next frame
+//
+//  Description:    This function is called once per frame in place of
+//                  get_SNES(), and steps through the journal. After the last
+//                  record, the last state is returned for every frame.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned short journal_replay_next()
+{
+    unsigned int position;
+    unsigned long delta, time, changed;
+
+
+    // The next record applies when its frame comes up. Records are only
+    // decoded once they are due, so the read position stays on the next
+    // one until then.
+    position = replayPosition;
+    if (getVarint(&delta) && getVarint(&time) && getVarint(&changed) &&
+        lastFrame + delta == journalFrame) {
+        lastFrame = journalFrame;
+        lastButtons ^= changed;
+    } else {
+        replayPosition = position;
+    }
+
+    journalFrame++;
+
+    return lastButtons;
+}
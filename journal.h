@@ -0,0 +1,15 @@
+// The size of the journal buffer in bytes. A record takes 3 to 8 bytes, so
+// this holds several thousand controller state changes.
+#define JOURNAL_BYTES           65536
+
+// Holding L and R together sends the journal over the UART
+#define JOURNAL_EXPORT_BUTTONS  ((1 << 10) | (1 << 11))
+
+// Function prototypes
+void journal_init(unsigned int seed);
+int journal_record(unsigned short buttons);
+void journal_export();
+int journal_import(char (*getc)());
+unsigned int journal_seed();
+unsigned long journal_frames();
+unsigned short journal_replay_next();
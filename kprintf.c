@@ -0,0 +1,466 @@
+// The functions in this file format text in the manner of printf(), for a
+// kernel that has no C library. ksnprintf() formats into a buffer, and
+// kprintf() formats into a line buffer that is handed to uart_puts() a
+// whole line at a time, so a line of formatted output costs one call to the
+// UART driver (and its mirror) rather than one per piece of the line.
+//
+// The conversions supported are:
+//
+//     %d  %i     signed decimal
+//     %u         unsigned decimal
+//     %x  %X     unsigned hexadecimal, in lower or upper case
+//     %p         pointer, as 0x and hexadecimal digits
+//     %s         string
+//     %c         character
+//     %%         a percent sign
+//
+// A conversion may have the flags - (left justify) and 0 (pad numbers with
+// zeros), a field width, which may be * to take it from the arguments, and
+// the length modifier l for long and unsigned long arguments.
+
+// Needed header files
+#include "uart.h"
+#include "kprintf.h"
+
+// The longest line kprintf() keeps before sending it. A longer line is sent
+// in pieces of this size, less one for the null terminating character.
+#define KPRINTF_LINE_SIZE       128
+
+// Enough digits for the largest unsigned long in decimal
+#define KPRINTF_MAX_DIGITS      20
+
+// The flags of a conversion
+#define FLAG_LEFT               1
+#define FLAG_ZERO               2
+
+// Where formatted characters go. Characters past the end of the buffer are
+// counted but not stored, unless the output is the kprintf() line, which is
+// sent to the UART when it fills.
+struct Output {
+    char *buffer;                   // Where to store characters
+    unsigned int size;              // Room in the buffer, with the null
+    unsigned int length;            // Characters stored
+    unsigned int total;             // Characters formatted
+    int line;                       // TRUE for the kprintf() line buffer
+};
+
+// The kprintf() line buffer, which keeps a line that has not ended yet
+// from one call to the next
+static char kprintfLine[KPRINTF_LINE_SIZE];
+static unsigned int kprintfLength;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       sendLine
+//
+//  Arguments:      output:          The kprintf() line output
+//
+//  Returns:        void
+//
+//  Description:    This function sends the characters in the line buffer to
+//                  the UART with a single call to uart_puts(), and empties
+//                  the buffer.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void sendLine(struct Output *output)
+{
+    if (output->length) {
+        output->buffer[output->length] = '\0';
+        uart_puts(output->buffer);
+        output->length = 0;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       putChar
+//
+//  Arguments:      output:          Where the character goes
+//                  c:               The character
+//
+//  Returns:        void
+//
+//  Description:    This function adds one formatted character to an output.
+//                  The kprintf() line is sent when it fills, or when the
+//                  character is a newline.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void putChar(struct Output *output, char c)
+{
+    output->total++;
+
+    if (output->length + 1 >= output->size) {
+        if (!output->line) {
+            return;
+        }
+        sendLine(output);
+    }
+
+    output->buffer[output->length++] = c;
+
+    if (output->line && c == '\n') {
+        sendLine(output);
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       putField
+//
+//  Arguments:      output:          Where the characters go
+//                  prefix:          Characters that go before any zero
+//                                   padding, such as a sign or 0x, or 0
+//                  s:               The characters of the field
+//                  length:          The number of characters in s
+//                  width:           The least number of characters to output
+//                  flags:           FLAG_LEFT and FLAG_ZERO
+//
+//  Returns:        void
+//
+//  Description:    This function outputs a converted value, padded to the
+//                  field width with spaces on the left or right, or with
+//                  zeros between the prefix and the digits.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void putField(struct Output *output, const char *prefix, const char *s,
+                     unsigned int length, unsigned int width, unsigned int flags)
+{
+    unsigned int prefixLength = 0;
+    unsigned int padding = 0;
+
+
+    while (prefix && prefix[prefixLength]) {
+        prefixLength++;
+    }
+    if (width > prefixLength + length) {
+        padding = width - prefixLength - length;
+    }
+
+    if (!(flags & (FLAG_LEFT | FLAG_ZERO))) {
+        for (; padding; padding--) {
+            putChar(output, ' ');
+        }
+    }
+    while (prefixLength--) {
+        putChar(output, *prefix++);
+    }
+    if (flags & FLAG_ZERO) {
+        for (; padding; padding--) {
+            putChar(output, '0');
+        }
+    }
+    while (length--) {
+        putChar(output, *s++);
+    }
+    for (; padding; padding--) {
+        putChar(output, ' ');
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       putNumber
+//
+//  Arguments:      output:          Where the characters go
+//                  prefix:          A sign or 0x to put before the digits,
+//                                   or 0
+//                  value:           The number, without its sign
+//                  base:            10 or 16
+//                  upperCase:       TRUE for the hexadecimal digits A to F
+//                  width:           The field width
+//                  flags:           FLAG_LEFT and FLAG_ZERO
+//
+//  Returns:        void
+//
+//  Description:    This function converts a number to digits, last digit
+//                  first, and outputs them as a field. Dividing by the
+//                  constant 10 or 16 compiles to a multiply or a shift.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void putNumber(struct Output *output, const char *prefix, unsigned long value,
+                      unsigned int base, int upperCase, unsigned int width, unsigned int flags)
+{
+    const char *digits = upperCase ? "0123456789ABCDEF" : "0123456789abcdef";
+    char buffer[KPRINTF_MAX_DIGITS];
+    int i = KPRINTF_MAX_DIGITS;
+
+
+    if (base == 16) {
+        do {
+            buffer[--i] = digits[value & 0xF];
+            value >>= 4;
+        } while (value);
+    } else {
+        do {
+            buffer[--i] = digits[value % 10];
+            value /= 10;
+        } while (value);
+    }
+
+    putField(output, prefix, &buffer[i], KPRINTF_MAX_DIGITS - i, width, flags);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       format
+//
+//  Arguments:      output:          Where the characters go
+//                  f:               The format string
+//                  arguments:       The values to convert
+//
+//  Returns:        void
+//
+//  Description:    This function does the work of kprintf() and ksnprintf().
+//                  Characters of the format string are output as they are,
+//                  and each conversion outputs the next argument. An
+//                  unknown conversion is output as it was written.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void format(struct Output *output, const char *f, __builtin_va_list arguments)
+{
+    const char *start, *s;
+    unsigned long value;
+    unsigned int flags, width, length;
+    int isLong, number;
+    char c;
+
+
+    while (*f) {
+        if (*f != '%') {
+            putChar(output, *f++);
+            continue;
+        }
+        start = f++;
+
+        // Flags
+        flags = 0;
+        for (;; f++) {
+            if (*f == '-') {
+                flags |= FLAG_LEFT;
+            } else if (*f == '0') {
+                flags |= FLAG_ZERO;
+            } else {
+                break;
+            }
+        }
+
+        // Field width
+        width = 0;
+        if (*f == '*') {
+            number = __builtin_va_arg(arguments, int);
+            if (number < 0) {
+                flags |= FLAG_LEFT;
+                number = -number;
+            }
+            width = number;
+            f++;
+        } else {
+            while (*f >= '0' && *f <= '9') {
+                width = (width * 10) + (*f++ - '0');
+            }
+        }
+        if (flags & FLAG_LEFT) {
+            flags &= ~FLAG_ZERO;
+        }
+
+        // Length
+        isLong = 0;
+        if (*f == 'l') {
+            isLong = 1;
+            f++;
+        }
+
+        switch (*f) {
+        case 'd':
+        case 'i':
+            if (isLong) {
+                long signedValue = __builtin_va_arg(arguments, long);
+                value = signedValue < 0 ? -(unsigned long)signedValue : signedValue;
+                s = signedValue < 0 ? "-" : 0;
+            } else {
+                int signedValue = __builtin_va_arg(arguments, int);
+                value = signedValue < 0 ? -(unsigned long)signedValue : signedValue;
+                s = signedValue < 0 ? "-" : 0;
+            }
+            putNumber(output, s, value, 10, 0, width, flags);
+            break;
+
+        case 'u':
+        case 'x':
+        case 'X':
+            if (isLong) {
+                value = __builtin_va_arg(arguments, unsigned long);
+            } else {
+                value = __builtin_va_arg(arguments, unsigned int);
+            }
+            putNumber(output, 0, value, *f == 'u' ? 10 : 16, *f == 'X', width, flags);
+            break;
+
+        case 'p':
+            value = (unsigned long)__builtin_va_arg(arguments, void *);
+            putNumber(output, "0x", value, 16, 0, width, flags);
+            break;
+
+        case 's':
+            s = __builtin_va_arg(arguments, const char *);
+            if (!s) {
+                s = "(null)";
+            }
+            for (length = 0; s[length]; length++) {
+            }
+            putField(output, 0, s, length, width, flags & FLAG_LEFT);
+            break;
+
+        case 'c':
+            c = (char)__builtin_va_arg(arguments, int);
+            putField(output, 0, &c, 1, width, flags & FLAG_LEFT);
+            break;
+
+        case '%':
+            putChar(output, '%');
+            break;
+
+        default:
+            // Output the unknown conversion unchanged, and stop at the end
+            // of the format string if that is where it was cut short
+            while (start < f) {
+                putChar(output, *start++);
+            }
+            if (!*f) {
+                return;
+            }
+            putChar(output, *f);
+            break;
+        }
+        f++;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       ksnprintf
+//
+//  Arguments:      buffer:          Where to store the formatted text
+//                  size:            The size of the buffer in bytes
+//                  f:               The format string
+//                  ...:             The values to convert
+//
+//  Returns:        The number of characters the whole text has, not counting
+//                  the null terminating character. If this is size or more,
+//                  the text was cut short to fit.
+//
+//  Description:    This function formats text into a buffer, which always
+//                  ends with a null terminating character if size is not 0.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int ksnprintf(char *buffer, unsigned int size, const char *f, ...)
+{
+    struct Output output;
+    __builtin_va_list arguments;
+
+
+    output.buffer = buffer;
+    output.size = size;
+    output.length = 0;
+    output.total = 0;
+    output.line = 0;
+
+    __builtin_va_start(arguments, f);
+    format(&output, f, arguments);
+    __builtin_va_end(arguments);
+
+    if (size) {
+        buffer[output.length] = '\0';
+    }
+
+    return output.total;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       kprintf
+//
+//  Arguments:      f:               The format string
+//                  ...:             The values to convert
+//
+//  Returns:        The number of characters formatted
+//
+//  Description:    This function formats text for the console. The text is
+//                  kept in the line buffer, and each complete line is sent
+//                  with one call to uart_puts(). Text after the last
+//                  newline stays in the buffer until a later call ends the
+//                  line, or kprintf_flush() is called.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int kprintf(const char *f, ...)
+{
+    struct Output output;
+    __builtin_va_list arguments;
+
+
+    output.buffer = kprintfLine;
+    output.size = KPRINTF_LINE_SIZE;
+    output.length = kprintfLength;
+    output.total = 0;
+    output.line = 1;
+
+    __builtin_va_start(arguments, f);
+    format(&output, f, arguments);
+    __builtin_va_end(arguments);
+
+    kprintfLength = output.length;
+
+    return output.total;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       kprintf_flush
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function sends any part of a line that kprintf()
+//                  is still keeping, such as a prompt with no newline.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void kprintf_flush()
+{
+    struct Output output;
+
+
+    output.buffer = kprintfLine;
+    output.size = KPRINTF_LINE_SIZE;
+    output.length = kprintfLength;
+    output.total = 0;
+    output.line = 1;
+
+    sendLine(&output);
+
+    kprintfLength = 0;
+}
@@ -0,0 +1,9 @@
+// These are the function prototypes for formatted console output. The
+// format attribute lets the compiler check the arguments against the
+// format string, as it does for printf(). See kprintf.c for the
+// conversions supported.
+
+int kprintf(const char *f, ...) __attribute__((format(printf, 1, 2)));
+int ksnprintf(char *buffer, unsigned int size, const char *f, ...)
+    __attribute__((format(printf, 3, 4)));
+void kprintf_flush();
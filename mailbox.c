@@ -1,20 +1,21 @@
+#include "mmio.h"
 #include "gpio.h"
 
 // Define mailbox registers. These can be found at:
 // https://github.com/raspberrypi/firmware/wiki/Mailboxes
 #define MAILBOX_BASE       (MMIO_BASE + 0x0000B880)
 
-#define MAILBOX0_READ      ((volatile unsigned int *)(MAILBOX_BASE + 0x0))
-#define MAILBOX0_PEEK      ((volatile unsigned int *)(MAILBOX_BASE + 0x10))
-#define MAILBOX0_SENDER    ((volatile unsigned int *)(MAILBOX_BASE + 0x14))
-#define MAILBOX0_STATUS    ((volatile unsigned int *)(MAILBOX_BASE + 0x18))
-#define MAILBOX0_CONFIG    ((volatile unsigned int *)(MAILBOX_BASE + 0x1C))
+#define MAILBOX0_READ      (MAILBOX_BASE + 0x0)
+#define MAILBOX0_PEEK      (MAILBOX_BASE + 0x10)
+#define MAILBOX0_SENDER    (MAILBOX_BASE + 0x14)
+#define MAILBOX0_STATUS    (MAILBOX_BASE + 0x18)
+#define MAILBOX0_CONFIG    (MAILBOX_BASE + 0x1C)
 
-#define MAILBOX1_WRITE     ((volatile unsigned int *)(MAILBOX_BASE + 0x20))
-#define MAILBOX1_PEEK      ((volatile unsigned int *)(MAILBOX_BASE + 0x30))
-#define MAILBOX1_SENDER    ((volatile unsigned int *)(MAILBOX_BASE + 0x34))
-#define MAILBOX1_STATUS    ((volatile unsigned int *)(MAILBOX_BASE + 0x38))
-#define MAILBOX1_CONFIG    ((volatile unsigned int *)(MAILBOX_BASE + 0x3C))
+#define MAILBOX1_WRITE     (MAILBOX_BASE + 0x20)
+#define MAILBOX1_PEEK      (MAILBOX_BASE + 0x30)
+#define MAILBOX1_SENDER    (MAILBOX_BASE + 0x34)
+#define MAILBOX1_STATUS    (MAILBOX_BASE + 0x38)
+#define MAILBOX1_CONFIG    (MAILBOX_BASE + 0x3C)
 
 // Define mailbox bitmasks
 #define MAILBOX_RESPONSE   0x80000000
@@ -65,21 +66,21 @@ int mailbox_query(unsigned char channel)
     address |= (channel & 0xF);
 
     // Keep polling mailbox 1 until it can accept a request
-    while (*MAILBOX1_STATUS & MAILBOX_FULL)
+    while (mmio_read(MAILBOX1_STATUS) & MAILBOX_FULL)
 	;
 
     // Write the address of our request to mailbox 1 with channel identifier
-    *MAILBOX1_WRITE = address;
+    mmio_write(MAILBOX1_WRITE, address);
 
     // Wait for a response in mailbox 0
     while (1) {
 	// Keep polling mailbox 0 until a response appears there
-	while (*MAILBOX0_STATUS & MAILBOX_EMPTY)
+	while (mmio_read(MAILBOX0_STATUS) & MAILBOX_EMPTY)
 	    ;
 
         // Make sure it is a response to our original request,
 	// otherwise keep waiting for a response
-        if (*MAILBOX0_READ == address) {
+        if (mmio_read(MAILBOX0_READ) == address) {
             // Return TRUE if is it a valid response, otherwise return FALSE
             return (mailbox_buffer[1] == MAILBOX_RESPONSE);
 	}
@@ -14,6 +14,14 @@
 // Mailbox messages
 #define MAILBOX_REQUEST                 0
 
+// Bit set by the video core in a tag's request/response code word
+// when it has processed the tag
+#define TAG_RESPONSE                    0x80000000
+
+// Convert an ARM physical address into the bus address the video core uses
+// to reach the same memory. The 0xC0000000 alias bypasses the L2 cache.
+#define ARM_TO_BUS(address)             ((unsigned int)((unsigned long)(address) & 0x3FFFFFFF) | 0xC0000000)
+
 // Mailbox Property Tags.  These are defined at:
 // https://github.com/raspberrypi/firmware/wiki/Mailbox-property-interface
 
@@ -93,6 +101,15 @@
 #define TAG_UNLOCK_MEMORY               0x0003000E
 #define TAG_RELEASEMEMORY               0x0003000F
 
+// GPU Memory Allocation Flags
+#define MEM_FLAG_DISCARDABLE            0x00000001
+#define MEM_FLAG_NORMAL                 0x00000000
+#define MEM_FLAG_DIRECT                 0x00000004
+#define MEM_FLAG_COHERENT               0x00000008
+#define MEM_FLAG_ZERO                   0x00000010
+#define MEM_FLAG_NO_INIT                0x00000020
+#define MEM_FLAG_HINT_PERMALOCK         0x00000040
+
 // Miscellaneous Tags
 #define TAG_EXECUTE_CODE                0x00030010
 #define TAG_GET_DISPMANX_HANDLE         0x00030014
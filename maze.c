@@ -0,0 +1,193 @@
+// The functions in this file build the compact maze representation used for
+// drawing and movement. See maze.h for the layout of the data.
+
+// Needed header files
+#include "framebuffer.h"
+#include "tiles.h"
+#include "maze.h"
+
+// Cell offsets of a move in each direction
+const int directionX[DIRECTIONS] = {0, 0, -1, 1};
+const int directionY[DIRECTIONS] = {-1, 1, 0, 0};
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       maze_init
+//
+//  Arguments:      maze:            The maze to set up
+//                  width:           Width of the maze in cells
+//                  height:          Height of the maze in cells
+//                  walls:           Storage for the wall bitset, at least
+//                                   MAZE_WALL_WORDS(width, height) words
+//                  neighbors:       Storage for the neighbor masks, at least
+//                                   MAZE_NEIGHBOR_BYTES(width, height) bytes
+//
+//  Returns:        void
+//
+//  Description:    This function sets up an empty maze of the given size
+//                  using the given storage. Every cell starts as a wall,
+//                  and the entrance and exit are unset (-1).
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void maze_init(struct Maze *maze, int width, int height, unsigned long *walls,
+               unsigned char *neighbors)
+{
+    int i, count;
+
+
+    maze->width = width;
+    maze->height = height;
+    maze->wordsPerRow = MAZE_WORDS_PER_ROW(width);
+    maze->walls = walls;
+    maze->neighbors = neighbors;
+    maze->entranceX = maze->entranceY = -1;
+    maze->exitX = maze->exitY = -1;
+
+    count = MAZE_WALL_WORDS(width, height);
+    for (i = 0; i < count; i++) {
+        walls[i] = ~0UL;
+    }
+
+    count = MAZE_NEIGHBOR_BYTES(width, height);
+    for (i = 0; i < count; i++) {
+        neighbors[i] = 0;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       maze_load
+//
+//  Arguments:      maze:            A maze set up with maze_init()
+//                  cells:           The cell values, row by row, using the
+//                                   MAZE_FLOOR, MAZE_WALL, MAZE_ENTRANCE and
+//                                   MAZE_EXIT values
+//
+//  Returns:        void
+//
+//  Description:    This function converts a maze from one integer per cell
+//                  into the wall bitset, records where the entrance and exit
+//                  are, and precomputes the neighbor masks. Any value other
+//                  than a wall is treated as an open cell.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void maze_load(struct Maze *maze, const int *cells)
+{
+    unsigned long *row;
+    int x, y, value;
+
+
+    for (y = 0; y < maze->height; y++) {
+        row = &maze->walls[y * maze->wordsPerRow];
+
+        for (x = 0; x < maze->width; x++) {
+            value = cells[(y * maze->width) + x];
+
+            if (value != MAZE_WALL) {
+                row[x >> 6] &= ~(1UL << (x & 63));
+            }
+
+            if (value == MAZE_ENTRANCE) {
+                maze->entranceX = x;
+                maze->entranceY = y;
+            } else if (value == MAZE_EXIT) {
+                maze->exitX = x;
+                maze->exitY = y;
+            }
+        }
+    }
+
+    maze_compute_neighbors(maze);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       maze_compute_neighbors
+//
+//  Arguments:      maze:            The maze
+//
+//  Returns:        void
+//
+//  Description:    This function precomputes the open-neighbor mask of every
+//                  cell from the wall bitset. It must be called again after
+//                  the walls change. A wall cell has no open neighbors, and
+//                  cells outside the maze count as walls, so a movement
+//                  check never needs a separate bounds check. The maze
+//                  generation count is advanced.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void maze_compute_neighbors(struct Maze *maze)
+{
+    unsigned int mask, index;
+    int x, y;
+
+
+    for (y = 0; y < maze->height; y++) {
+        for (x = 0; x < maze->width; x++) {
+            mask = 0;
+
+            if (!maze_is_wall(maze, x, y)) {
+                if (y > 0 && !maze_is_wall(maze, x, y - 1))
+                    mask |= 1 << DIRECTION_UP;
+                if (y < maze->height - 1 && !maze_is_wall(maze, x, y + 1))
+                    mask |= 1 << DIRECTION_DOWN;
+                if (x > 0 && !maze_is_wall(maze, x - 1, y))
+                    mask |= 1 << DIRECTION_LEFT;
+                if (x < maze->width - 1 && !maze_is_wall(maze, x + 1, y))
+                    mask |= 1 << DIRECTION_RIGHT;
+            }
+
+            // Two masks share each byte, the even cell in the low nibble
+            index = (y * maze->width) + x;
+            if (index & 1) {
+                maze->neighbors[index >> 1] = (maze->neighbors[index >> 1] & 0x0F) | (mask << 4);
+            } else {
+                maze->neighbors[index >> 1] = (maze->neighbors[index >> 1] & 0xF0) | mask;
+            }
+        }
+    }
+
+    maze->generation++;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       maze_tile
+//
+//  Arguments:      maze:            The maze
+//                  x:               Cell x coordinate
+//                  y:               Cell y coordinate
+//
+//  Returns:        The tile number to draw for the cell
+//
+//  Description:    This function chooses the tile for a maze cell.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int maze_tile(struct Maze *maze, int x, int y)
+{
+    if (maze_is_wall(maze, x, y)) {
+        return TILE_WALL;
+    }
+
+    if (x == maze->entranceX && y == maze->entranceY) {
+        return TILE_ENTRANCE;
+    }
+
+    if (x == maze->exitX && y == maze->exitY) {
+        return TILE_EXIT;
+    }
+
+    return TILE_FLOOR;
+}
@@ -0,0 +1,79 @@
+// Directions a character can move in. The open-neighbor mask of a cell has
+// bit (1 << direction) set when the neighbor in that direction is not a wall.
+#define DIRECTION_UP        0
+#define DIRECTION_DOWN      1
+#define DIRECTION_LEFT      2
+#define DIRECTION_RIGHT     3
+#define DIRECTIONS          4
+
+// Cell values used by maze_load()
+#define MAZE_FLOOR          0
+#define MAZE_WALL           1
+#define MAZE_ENTRANCE       2
+#define MAZE_EXIT           3
+
+// The number of 64-bit words in one row of the wall bitset, and the
+// storage a maze of the given size needs for its walls and neighbor masks
+#define MAZE_WORDS_PER_ROW(width)           (((width) + 63) / 64)
+#define MAZE_WALL_WORDS(width, height)      (MAZE_WORDS_PER_ROW(width) * (height))
+#define MAZE_NEIGHBOR_BYTES(width, height)  ((((width) * (height)) + 1) / 2)
+
+// A maze. Walls are kept as a bitset, one bit per cell and a whole number of
+// 64-bit words per row, where a 1 bit is a wall. The 4-bit open-neighbor mask
+// of every cell is precomputed from the walls, and two masks are packed into
+// each byte. The storage for both is supplied by the caller. The generation
+// count changes whenever the neighbor masks are recomputed, so anything
+// derived from the maze can tell when it is out of date.
+struct Maze {
+    int width;
+    int height;
+    int wordsPerRow;
+    unsigned long *walls;
+    unsigned char *neighbors;
+    int entranceX, entranceY;
+    int exitX, exitY;
+    unsigned int generation;
+};
+
+// Cell offsets of a move in each direction
+extern const int directionX[DIRECTIONS];
+extern const int directionY[DIRECTIONS];
+
+// Function prototypes
+void maze_init(struct Maze *maze, int width, int height, unsigned long *walls,
+               unsigned char *neighbors);
+void maze_load(struct Maze *maze, const int *cells);
+void maze_compute_neighbors(struct Maze *maze);
+int maze_tile(struct Maze *maze, int x, int y);
+
+
+
+// Returns non-zero if the cell at (x, y) is a wall. The cell must be
+// inside the maze.
+static inline unsigned long maze_is_wall(const struct Maze *maze, int x, int y)
+{
+    return (maze->walls[(y * maze->wordsPerRow) + (x >> 6)] >> (x & 63)) & 1;
+}
+
+// Returns the open-neighbor mask of the cell with the given row-major index
+// (y * width + x).
+static inline unsigned int maze_neighbors_at(const struct Maze *maze, unsigned int index)
+{
+    return (maze->neighbors[index >> 1] >> ((index & 1) << 2)) & 0xF;
+}
+
+// Returns the open-neighbor mask of the cell at (x, y). The cell must be
+// inside the maze, but its neighbors need not be, since cells outside the
+// maze are never open.
+static inline unsigned int maze_neighbors(const struct Maze *maze, int x, int y)
+{
+    return maze_neighbors_at(maze, (y * maze->width) + x);
+}
+
+// Returns 1 if a move from (x, y) in the given direction is possible,
+// otherwise 0. This is a single bit test, so it can be used to scale
+// a move without branching.
+static inline int maze_can_move(const struct Maze *maze, int x, int y, int direction)
+{
+    return (maze_neighbors(maze, x, y) >> direction) & 1;
+}
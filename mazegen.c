@@ -0,0 +1,187 @@
+// The functions in this file generate random mazes using the recursive
+// backtracker algorithm. The algorithm walks from room to room, carving
+// through the wall into a random unvisited neighbor room each step, and
+// backs up when it reaches a room with no unvisited neighbors.
+//
+// The walk is done iteratively, not with recursion, since a large maze would
+// need a call depth of millions and overflow the stack below _start. Instead
+// of an explicit stack of rooms, each room records in two bits of scratch
+// memory which way it was entered from, which is enough to back up along
+// the current path. A room has been visited exactly when its cell is open.
+
+// Needed header files
+#include "systimer.h"
+#include "maze.h"
+#include "mazegen.h"
+
+// Random number generator state
+static unsigned long randomState;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       nextRandom
+//
+//  Arguments:      limit:           One more than the largest value wanted
+//
+//  Returns:        A pseudo-random number from 0 to limit - 1
+//
+//  Description:    This function steps an xorshift64* generator. The same
+//                  seed always produces the same sequence, and so the same
+//                  maze.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int nextRandom(unsigned int limit)
+{
+    randomState ^= randomState >> 12;
+    randomState ^= randomState << 25;
+    randomState ^= randomState >> 27;
+
+    return (unsigned int)((randomState * 0x2545F4914F6CDD1DUL) >> 32) % limit;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       openCell
+//
+//  Arguments:      maze:            The maze
+//                  x:               Cell x coordinate
+//                  y:               Cell y coordinate
+//
+//  Returns:        void
+//
+//  Description:    This function clears the wall bit of a cell.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void openCell(struct Maze *maze, int x, int y)
+{
+    maze->walls[(y * maze->wordsPerRow) + (x >> 6)] &= ~(1UL << (x & 63));
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       maze_generate
+//
+//  Arguments:      maze:            A maze set up with maze_init() at the size
+//                                   to generate. The width and height must be
+//                                   odd, from 3 to MAZEGEN_MAX_SIZE.
+//                  seed:            Seed for the random number generator
+//                  scratch:         Scratch memory of at least
+//                                   MAZEGEN_SCRATCH_BYTES(width, height) bytes
+//                  stats:           Where to report the time and memory used,
+//                                   or 0 if not wanted
+//
+//  Returns:        TRUE (non-zero) if the maze was generated, FALSE (zero) if
+//                  the size is not supported
+//
+//  Description:    This function fills the maze with walls, carves a perfect
+//                  maze (exactly one path between any two rooms) into it,
+//                  and opens an entrance on the left edge and an exit on the
+//                  right edge at random rows. The neighbor masks are then
+//                  computed, so the maze is ready to play.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int maze_generate(struct Maze *maze, unsigned int seed, unsigned char *scratch,
+                  struct MazeGenStats *stats)
+{
+    unsigned long startTime;
+    unsigned int roomsWide, roomsHigh, room, rooms, shift;
+    int candidates[DIRECTIONS];
+    int x, y, startX, startY, nextX, nextY, direction, count;
+
+
+    if ((maze->width & 1) == 0 || (maze->height & 1) == 0 ||
+        maze->width < 3 || maze->height < 3 ||
+        maze->width > MAZEGEN_MAX_SIZE || maze->height > MAZEGEN_MAX_SIZE) {
+        return 0;
+    }
+
+    startTime = get_timer_counter();
+
+    // Seed the generator. Its state must never be zero.
+    randomState = ((unsigned long)seed << 32) ^ 0x9E3779B97F4A7C15UL;
+
+    // Start from a maze that is all walls
+    maze_init(maze, maze->width, maze->height, maze->walls, maze->neighbors);
+
+    roomsWide = (maze->width - 1) / 2;
+    roomsHigh = (maze->height - 1) / 2;
+
+    // Start the walk in a random room
+    startX = x = (2 * nextRandom(roomsWide)) + 1;
+    startY = y = (2 * nextRandom(roomsHigh)) + 1;
+    openCell(maze, x, y);
+    rooms = 1;
+
+    while (1) {
+        // Find the neighbor rooms that have not been visited yet
+        count = 0;
+        for (direction = 0; direction < DIRECTIONS; direction++) {
+            nextX = x + (2 * directionX[direction]);
+            nextY = y + (2 * directionY[direction]);
+
+            if (nextX > 0 && nextX < maze->width && nextY > 0 && nextY < maze->height &&
+                maze_is_wall(maze, nextX, nextY)) {
+                candidates[count++] = direction;
+            }
+        }
+
+        if (count) {
+            // Carve through the wall into a random unvisited neighbor,
+            // and remember the way back (the opposite direction)
+            direction = candidates[nextRandom(count)];
+            openCell(maze, x + directionX[direction], y + directionY[direction]);
+            x += 2 * directionX[direction];
+            y += 2 * directionY[direction];
+            openCell(maze, x, y);
+            rooms++;
+
+            room = ((y / 2) * roomsWide) + (x / 2);
+            shift = (room & 3) * 2;
+            scratch[room >> 2] = (scratch[room >> 2] & ~(3 << shift)) |
+                                 ((direction ^ 1) << shift);
+        } else {
+            // Back up to the room this one was entered from. When the walk
+            // is back at its starting room, every room has been visited.
+            if (x == startX && y == startY) {
+                break;
+            }
+
+            room = ((y / 2) * roomsWide) + (x / 2);
+            direction = (scratch[room >> 2] >> ((room & 3) * 2)) & 3;
+            x += 2 * directionX[direction];
+            y += 2 * directionY[direction];
+        }
+    }
+
+    // Open the entrance and the exit in the outer wall
+    y = (2 * nextRandom(roomsHigh)) + 1;
+    openCell(maze, 0, y);
+    maze->entranceX = 0;
+    maze->entranceY = y;
+
+    y = (2 * nextRandom(roomsHigh)) + 1;
+    openCell(maze, maze->width - 1, y);
+    maze->exitX = maze->width - 1;
+    maze->exitY = y;
+
+    maze_compute_neighbors(maze);
+
+    if (stats) {
+        stats->microseconds = get_timer_counter() - startTime;
+        stats->bytes = (MAZE_WALL_WORDS(maze->width, maze->height) * sizeof(unsigned long)) +
+                       MAZE_NEIGHBOR_BYTES(maze->width, maze->height) +
+                       MAZEGEN_SCRATCH_BYTES(maze->width, maze->height);
+        stats->rooms = rooms;
+    }
+
+    return 1;
+}
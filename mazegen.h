@@ -0,0 +1,19 @@
+// The largest maze the generator builds, in cells per side. Generated mazes
+// have odd sizes, with rooms at odd coordinates and walls between them.
+#define MAZEGEN_MAX_SIZE    4097
+
+// The scratch memory the generator needs for a maze of the given size:
+// two bits per room, to remember the way back to the room it was reached from
+#define MAZEGEN_SCRATCH_BYTES(width, height) \
+    (((((width) - 1) / 2) * (((height) - 1) / 2) + 3) / 4)
+
+// What a maze generation run cost
+struct MazeGenStats {
+    unsigned long microseconds;     // Time taken to generate the maze
+    unsigned long bytes;            // Memory used by the maze and scratch
+    unsigned int rooms;             // Number of rooms carved
+};
+
+// Function prototypes
+int maze_generate(struct Maze *maze, unsigned int seed, unsigned char *scratch,
+                  struct MazeGenStats *stats);
@@ -0,0 +1,11 @@
+// The memory functions in memops.s. The kernel has no C library, so these
+// are also what GCC calls for structure copies and for loops it recognizes
+// as fills or copies. The host build uses the C library's versions, and
+// host/memops.c for memset32().
+
+// Function prototypes
+void *memset(void *destination, int value, unsigned long count);
+void *memset32(void *destination, unsigned int value, unsigned long count);
+void *memcpy(void *destination, const void *source, unsigned long count);
+void *memmove(void *destination, const void *source, unsigned long count);
+int memcmp(const void *first, const void *second, unsigned long count);
@@ -0,0 +1,501 @@
+// This file implements the memory functions the C code, and the code GCC
+// generates for structure copies and loops, expect from a C library:
+// memset(), memcpy(), memmove() and memcmp(), plus memset32() for filling
+// rows of 32-bit pixels.
+//
+// The MMU is not enabled, so all data accesses are to Device memory. Any
+// access that is not aligned to its own size causes an alignment fault.
+// Each function therefore steps bytes (or one word) until the pointers are
+// doubleword aligned, then moves 64 bytes per loop with LDP/STP pairs of
+// 64-bit registers, and finishes with a doubleword, word, halfword and
+// byte as needed. When the source and destination cannot both be aligned
+// the same way, a word or byte loop is used instead.
+//
+// memset() and memcpy() calls for fewer than 16 bytes, such as the copies
+// GCC makes of small structures, use the largest accesses that both
+// pointers are already aligned for: doublewords, words or halfwords. Only
+// pointers that are not even halfword aligned are handled a byte at a time.
+//
+// memset() has a DC ZVA path for large zero fills, but DC ZVA faults on
+// Device memory, so it is only taken when the MMU is on. This kernel never
+// turns the MMU on, so the path never runs here, and large zero fills use
+// the same STP loop as other values.
+//
+// The functions are tested against the C library's on Linux, at EL0 (see
+// host/test_memops.c), where the MMU is always on and the system control
+// registers cannot be read. That build defines MEMOPS_USER, which leaves
+// out the check of the MMU.
+//
+// Only the caller-saved registers x0 to x17 are used, so none need to be
+// saved, and no FP/SIMD registers are touched.
+
+
+	.text
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       memset
+//
+//  Arguments:      x0:              Destination address
+//                  w1:              Byte value to store
+//                  x2:              Number of bytes
+//
+//  Returns:        x0:              The destination address
+//
+////////////////////////////////////////////////////////////////////////////////
+
+	.balign	16
+	.global	memset
+memset:
+	mov	x8, x0			// x8 is the store pointer
+	and	x1, x1, 0xFF		// Copy the byte into all 8 bytes of x1
+	orr	x1, x1, x1, lsl 8
+	orr	x1, x1, x1, lsl 16
+	orr	x1, x1, x1, lsl 32
+
+	cmp	x2, 16			// Short fills use the widest aligned stores
+	b.lo	memset_small
+
+memset_align:
+	tst	x8, 7			// Store bytes up to doubleword alignment
+	b.eq	memset_aligned
+	strb	w1, [x8], 1
+	sub	x2, x2, 1
+	b	memset_align
+
+memset_aligned:
+	// Large zero fills use DC ZVA, if it is allowed (DCZID_EL0.DZP is 0)
+	// and the MMU is on for the current exception level
+	cbnz	x1, memset_pairs
+	cmp	x2, 1024
+	b.lo	memset_pairs
+	mrs	x9, dczid_el0
+	tbnz	w9, 4, memset_pairs
+.ifndef MEMOPS_USER
+	mrs	x10, CurrentEL
+	cmp	x10, 0x8
+	b.eq	memset_el2
+	b.hi	memset_el3
+	mrs	x10, sctlr_el1
+	b	memset_mmu
+memset_el2:
+	mrs	x10, sctlr_el2
+	b	memset_mmu
+memset_el3:
+	mrs	x10, sctlr_el3
+memset_mmu:
+	tbz	x10, 0, memset_pairs
+.endif
+
+	and	w9, w9, 0xF		// The block size is 4 << DCZID_EL0.BS bytes
+	mov	x11, 4
+	lsl	x11, x11, x9
+	cmp	x2, x11, lsl 1		// Leave room to align to a whole block
+	b.lo	memset_pairs
+	sub	x12, x11, 1
+
+memset_zva_align:
+	tst	x8, x12			// Store doublewords up to block alignment
+	b.eq	memset_zva
+	str	xzr, [x8], 8
+	sub	x2, x2, 8
+	b	memset_zva_align
+
+memset_zva:
+	dc	zva, x8			// Zero a whole block at a time
+	add	x8, x8, x11
+	sub	x2, x2, x11
+	cmp	x2, x11
+	b.hs	memset_zva
+
+memset_pairs:
+	cmp	x2, 64			// Store 64 bytes per loop
+	b.lo	memset_doublewords
+memset_loop:
+	stp	x1, x1, [x8]
+	stp	x1, x1, [x8, 16]
+	stp	x1, x1, [x8, 32]
+	stp	x1, x1, [x8, 48]
+	add	x8, x8, 64
+	sub	x2, x2, 64
+	cmp	x2, 64
+	b.hs	memset_loop
+
+memset_doublewords:
+	cmp	x2, 8			// Then doublewords, and a word, halfword
+	b.lo	memset_tail_word	// and byte for what is left
+	str	x1, [x8], 8
+	sub	x2, x2, 8
+	b	memset_doublewords
+
+memset_small:
+	tst	x8, 7			// Fewer than 16 bytes. If the pointer is
+	b.ne	memset_small_words	// doubleword aligned, bit 3 of the count
+	tbz	x2, 3, memset_tail_word	// is a doubleword, bit 2 a word, bit 1 a
+	str	x1, [x8], 8		// halfword and bit 0 a byte, and each
+					// store leaves it aligned for the next
+memset_tail_word:
+	tbz	x2, 2, memset_tail_halfword
+	str	w1, [x8], 4
+memset_tail_halfword:
+	tbz	x2, 1, memset_tail_byte
+	strh	w1, [x8], 2
+memset_tail_byte:
+	tbz	x2, 0, memset_done
+	strb	w1, [x8]
+	ret
+
+memset_small_words:
+	tst	x8, 3			// A word aligned pointer takes a pair of
+	b.ne	memset_small_halfwords	// words for bit 3 instead
+	tbz	x2, 3, memset_tail_word
+	stp	w1, w1, [x8], 8
+	b	memset_tail_word
+
+memset_small_halfwords:
+	tst	x8, 1			// A halfword aligned one is filled with
+	b.ne	memset_bytes		// halfwords
+memset_halfword_loop:
+	cmp	x2, 2
+	b.lo	memset_bytes
+	strh	w1, [x8], 2
+	sub	x2, x2, 2
+	b	memset_halfword_loop
+
+memset_bytes:
+	cbz	x2, memset_done		// And anything else a byte at a time
+	strb	w1, [x8], 1
+	sub	x2, x2, 1
+	b	memset_bytes
+
+memset_done:
+	ret
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       memset32
+//
+//  Arguments:      x0:              Destination address, word aligned
+//                  w1:              Word value to store
+//                  x2:              Number of words
+//
+//  Returns:        x0:              The destination address
+//
+////////////////////////////////////////////////////////////////////////////////
+
+	.balign	16
+	.global	memset32
+memset32:
+	mov	x8, x0			// x8 is the store pointer
+	mov	w1, w1			// Copy the word into both halves of x1
+	orr	x1, x1, x1, lsl 32
+
+	cbz	x2, memset32_done
+	tst	x8, 4			// Store one word to reach doubleword alignment
+	b.eq	memset32_pairs
+	str	w1, [x8], 4
+	sub	x2, x2, 1
+
+memset32_pairs:
+	cmp	x2, 16			// Store 16 words (64 bytes) per loop
+	b.lo	memset32_doublewords
+memset32_loop:
+	stp	x1, x1, [x8]
+	stp	x1, x1, [x8, 16]
+	stp	x1, x1, [x8, 32]
+	stp	x1, x1, [x8, 48]
+	add	x8, x8, 64
+	sub	x2, x2, 16
+	cmp	x2, 16
+	b.hs	memset32_loop
+
+memset32_doublewords:
+	cmp	x2, 2			// Then two words at a time
+	b.lo	memset32_last
+	str	x1, [x8], 8
+	sub	x2, x2, 2
+	b	memset32_doublewords
+
+memset32_last:
+	cbz	x2, memset32_done	// And any odd word left
+	str	w1, [x8]
+
+memset32_done:
+	ret
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       memcpy
+//
+//  Arguments:      x0:              Destination address
+//                  x1:              Source address
+//                  x2:              Number of bytes
+//
+//  Returns:        x0:              The destination address
+//
+//  The copy runs forwards, so memmove() also uses it when the destination
+//  is below the source.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+	.balign	16
+	.global	memcpy
+memcpy:
+	mov	x8, x0			// x8 is the store pointer
+
+memcpy_forward:
+	cmp	x2, 16			// Short copies use the widest aligned
+	b.lo	memcpy_small		// accesses
+	eor	x9, x8, x1		// Can both pointers be doubleword aligned?
+	tst	x9, 7
+	b.ne	memcpy_words
+
+memcpy_align:
+	tst	x8, 7			// Copy bytes up to doubleword alignment
+	b.eq	memcpy_pairs
+	ldrb	w10, [x1], 1
+	strb	w10, [x8], 1
+	sub	x2, x2, 1
+	b	memcpy_align
+
+memcpy_pairs:
+	cmp	x2, 64			// Copy 64 bytes per loop. All the loads
+	b.lo	memcpy_doublewords	// come before the stores, which also
+memcpy_loop:				// makes a forward overlapping move safe.
+	ldp	x10, x11, [x1]
+	ldp	x12, x13, [x1, 16]
+	ldp	x14, x15, [x1, 32]
+	ldp	x16, x17, [x1, 48]
+	add	x1, x1, 64
+	stp	x10, x11, [x8]
+	stp	x12, x13, [x8, 16]
+	stp	x14, x15, [x8, 32]
+	stp	x16, x17, [x8, 48]
+	add	x8, x8, 64
+	sub	x2, x2, 64
+	cmp	x2, 64
+	b.hs	memcpy_loop
+
+memcpy_doublewords:
+	cmp	x2, 8			// Then doublewords, and a word, halfword
+	b.lo	memcpy_tail_word	// and byte for what is left
+	ldr	x10, [x1], 8
+	str	x10, [x8], 8
+	sub	x2, x2, 8
+	b	memcpy_doublewords
+
+memcpy_small:
+	orr	x9, x8, x1		// Fewer than 16 bytes. If both pointers
+	tst	x9, 7			// are doubleword aligned, bit 3 of the
+	b.ne	memcpy_small_words	// count is a doubleword, bit 2 a word,
+	tbz	x2, 3, memcpy_tail_word	// bit 1 a halfword and bit 0 a byte, and
+	ldr	x10, [x1], 8		// each access leaves them aligned for
+	str	x10, [x8], 8		// the next
+memcpy_tail_word:
+	tbz	x2, 2, memcpy_tail_halfword
+	ldr	w10, [x1], 4
+	str	w10, [x8], 4
+memcpy_tail_halfword:
+	tbz	x2, 1, memcpy_tail_byte
+	ldrh	w10, [x1], 2
+	strh	w10, [x8], 2
+memcpy_tail_byte:
+	tbz	x2, 0, memcpy_done
+	ldrb	w10, [x1]
+	strb	w10, [x8]
+	ret
+
+memcpy_small_words:
+	tst	x9, 3			// Word aligned pointers take a pair of
+	b.ne	memcpy_small_halfwords	// words for bit 3 instead
+	tbz	x2, 3, memcpy_tail_word
+	ldp	w10, w11, [x1], 8
+	stp	w10, w11, [x8], 8
+	b	memcpy_tail_word
+
+memcpy_small_halfwords:
+	tst	x9, 1			// Halfword aligned ones are copied in
+	b.ne	memcpy_bytes		// halfwords
+memcpy_halfword_loop:
+	cmp	x2, 2
+	b.lo	memcpy_bytes
+	ldrh	w10, [x1], 2
+	strh	w10, [x8], 2
+	sub	x2, x2, 2
+	b	memcpy_halfword_loop
+
+memcpy_words:
+	tst	x9, 3			// Can both pointers be word aligned?
+	b.ne	memcpy_bytes
+
+memcpy_word_align:
+	tst	x8, 3			// Copy bytes up to word alignment
+	b.eq	memcpy_word_loop
+	ldrb	w10, [x1], 1
+	strb	w10, [x8], 1
+	sub	x2, x2, 1
+	b	memcpy_word_align
+
+memcpy_word_loop:
+	cmp	x2, 4			// Then copy words, and a halfword and
+	b.lo	memcpy_tail_halfword	// byte for what is left
+	ldr	w10, [x1], 4
+	str	w10, [x8], 4
+	sub	x2, x2, 4
+	b	memcpy_word_loop
+
+memcpy_bytes:
+	cbz	x2, memcpy_done		// And anything else a byte at a time
+	ldrb	w10, [x1], 1
+	strb	w10, [x8], 1
+	sub	x2, x2, 1
+	b	memcpy_bytes
+
+memcpy_done:
+	ret
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       memmove
+//
+//  Arguments:      x0:              Destination address
+//                  x1:              Source address
+//                  x2:              Number of bytes
+//
+//  Returns:        x0:              The destination address
+//
+//  The areas may overlap. If the destination is below the source, or past
+//  its end, the forward copy in memcpy() is used. Otherwise the copy runs
+//  backwards from the end.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+	.balign	16
+	.global	memmove
+memmove:
+	mov	x8, x0			// x8 is the store pointer
+	sub	x9, x0, x1		// Copy forwards unless the destination
+	cmp	x9, x2			// starts inside the source
+	b.hs	memcpy_forward
+
+	add	x8, x0, x2		// Start from the ends of both areas
+	add	x1, x1, x2
+	cmp	x2, 16			// Short moves are done a byte at a time
+	b.lo	memmove_bytes
+	eor	x9, x8, x1		// Can both pointers be doubleword aligned?
+	tst	x9, 7
+	b.ne	memmove_bytes
+
+memmove_align:
+	tst	x8, 7			// Copy bytes down to doubleword alignment
+	b.eq	memmove_pairs
+	ldrb	w10, [x1, -1]!
+	strb	w10, [x8, -1]!
+	sub	x2, x2, 1
+	b	memmove_align
+
+memmove_pairs:
+	cmp	x2, 32			// Copy 32 bytes per loop, loading
+	b.lo	memmove_doublewords	// before storing
+memmove_loop:
+	ldp	x10, x11, [x1, -16]
+	ldp	x12, x13, [x1, -32]!
+	stp	x10, x11, [x8, -16]
+	stp	x12, x13, [x8, -32]!
+	sub	x2, x2, 32
+	cmp	x2, 32
+	b.hs	memmove_loop
+
+memmove_doublewords:
+	cmp	x2, 8			// Then doublewords
+	b.lo	memmove_bytes
+	ldr	x10, [x1, -8]!
+	str	x10, [x8, -8]!
+	sub	x2, x2, 8
+	b	memmove_doublewords
+
+memmove_bytes:
+	cbz	x2, memmove_done	// And finally any bytes left
+	ldrb	w10, [x1, -1]!
+	strb	w10, [x8, -1]!
+	sub	x2, x2, 1
+	b	memmove_bytes
+
+memmove_done:
+	ret
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       memcmp
+//
+//  Arguments:      x0:              First area
+//                  x1:              Second area
+//                  x2:              Number of bytes
+//
+//  Returns:        w0:              0 if the areas are equal, otherwise
+//                                   negative or positive as the first
+//                                   differing byte is lower or higher in
+//                                   the first area
+//
+////////////////////////////////////////////////////////////////////////////////
+
+	.balign	16
+	.global	memcmp
+memcmp:
+	cmp	x2, 16			// Short compares are done a byte at a time
+	b.lo	memcmp_bytes
+	eor	x9, x0, x1		// Can both pointers be doubleword aligned?
+	tst	x9, 7
+	b.ne	memcmp_bytes
+
+memcmp_align:
+	tst	x0, 7			// Compare bytes up to doubleword alignment
+	b.eq	memcmp_doublewords
+	ldrb	w10, [x0], 1
+	ldrb	w11, [x1], 1
+	subs	w12, w10, w11
+	b.ne	memcmp_byte_differs
+	sub	x2, x2, 1
+	b	memcmp_align
+
+memcmp_doublewords:
+	cmp	x2, 8			// Compare doublewords
+	b.lo	memcmp_bytes
+	ldr	x10, [x0], 8
+	ldr	x11, [x1], 8
+	sub	x2, x2, 8
+	cmp	x10, x11
+	b.eq	memcmp_doublewords
+
+	rev	x10, x10		// The lowest addressed byte is the least
+	rev	x11, x11		// significant, so reverse the bytes to
+	cmp	x10, x11		// compare in memory order
+	mov	w0, 1
+	cneg	w0, w0, lo
+	ret
+
+memcmp_bytes:
+	cbz	x2, memcmp_equal	// Compare any bytes left
+	ldrb	w10, [x0], 1
+	ldrb	w11, [x1], 1
+	subs	w12, w10, w11
+	b.ne	memcmp_byte_differs
+	sub	x2, x2, 1
+	b	memcmp_bytes
+
+memcmp_byte_differs:
+	mov	w0, w12
+	ret
+
+memcmp_equal:
+	mov	w0, 0
+	ret
@@ -0,0 +1,350 @@
+// The functions in this file manage the ARM memory the kernel image does
+// not use. The video core reports where ARM memory is with the
+// TAG_GET_ARM_MEMORY property tag, and everything from the end of the
+// image (_end in link.ld) to the top of it becomes one arena. The stack
+// is below the image, at 0x80000, so it is not part of the arena.
+//
+// Large buffers the program keeps are allocated from this arena once, at
+// startup, and scratch memory is allocated above them and given back with
+// arena_mark() and arena_reset(). Smaller arenas and object pools can be
+// carved out of it for subsystems that need their own.
+
+// Needed header files
+#include "uart.h"
+#include "kprintf.h"
+#include "mailbox.h"
+#include "memory.h"
+
+// Where ARM memory is assumed to end if the video core does not answer:
+// 512 MB, which every Raspberry Pi 3 configuration has
+#define MEMORY_DEFAULT_TOP      0x20000000
+
+// The end of the kernel image, provided by the linker
+extern char _end[];
+
+// The arena holding all free ARM memory
+struct Arena memoryArena;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       memory_init
+//
+//  Arguments:      none
+//
+//  Returns:        TRUE (non-zero) if the video core reported the ARM
+//                  memory, FALSE (zero) if a default size was assumed
+//
+//  Description:    This function asks the video core where ARM memory is,
+//                  and sets up memoryArena to cover it from the end of the
+//                  kernel image up. It must be called once, before any
+//                  memory is allocated.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int memory_init()
+{
+    unsigned long start = (unsigned long)_end;
+    unsigned long top = MEMORY_DEFAULT_TOP;
+    int found;
+
+
+    mailbox_buffer[0] = 8 * 4;
+    mailbox_buffer[1] = MAILBOX_REQUEST;
+
+    mailbox_buffer[2] = TAG_GET_ARM_MEMORY;
+    mailbox_buffer[3] = 8;
+    mailbox_buffer[4] = 0;
+    mailbox_buffer[5] = 0;                      // Base address
+    mailbox_buffer[6] = 0;                      // Size in bytes
+
+    mailbox_buffer[7] = TAG_LAST;
+
+    found = mailbox_query(CHANNEL_PROPERTY_TAGS_ARMTOVC) &&
+            (mailbox_buffer[4] & TAG_RESPONSE) && mailbox_buffer[6] != 0;
+
+    // The arena starts at the end of the image if that is inside ARM
+    // memory, and at the base of ARM memory otherwise
+    if (found) {
+        top = (unsigned long)mailbox_buffer[5] + mailbox_buffer[6];
+        if (start < mailbox_buffer[5] || start >= top) {
+            start = mailbox_buffer[5];
+        }
+    }
+
+    // Start on a cache line boundary
+    start = (start + MEMORY_CACHE_LINE - 1) & ~(unsigned long)(MEMORY_CACHE_LINE - 1);
+    if (top < start) {
+        top = start;
+    }
+
+    arena_init(&memoryArena, (void *)start, top - start);
+
+    return found;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       memory_alloc
+//
+//  Arguments:      size:            The number of bytes wanted
+//
+//  Returns:        The memory, aligned to a cache line, or 0 if there is
+//                  not enough left
+//
+//  Description:    This function allocates memory from memoryArena. The
+//                  memory is not cleared.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void *memory_alloc(unsigned long size)
+{
+    return arena_alloc(&memoryArena, size, MEMORY_CACHE_LINE);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       memory_report
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function prints where the memory arena is, how much
+//                  of it is used, the high-water mark, and how many
+//                  allocations have failed.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void memory_report()
+{
+    kprintf("Memory: %lu bytes at 0x%lx, used %lu, high water %lu, failures %u\n",
+            memoryArena.end - memoryArena.start, memoryArena.start,
+            memoryArena.top - memoryArena.start, memoryArena.highWater - memoryArena.start,
+            memoryArena.failures);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       arena_init
+//
+//  Arguments:      arena:           The arena to set up
+//                  memory:          The memory it manages
+//                  size:            The size of the memory in bytes
+//
+//  Returns:        void
+//
+//  Description:    This function sets up an empty arena.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void arena_init(struct Arena *arena, void *memory, unsigned long size)
+{
+    arena->start = (unsigned long)memory;
+    arena->end = arena->start + size;
+    arena->top = arena->start;
+    arena->highWater = arena->start;
+    arena->failures = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       arena_alloc
+//
+//  Arguments:      arena:           The arena to allocate from
+//                  size:            The number of bytes wanted
+//                  align:           The alignment wanted, a power of two
+//                                   (MEMORY_CACHE_LINE for a whole line)
+//
+//  Returns:        The memory, or 0 if there is not enough left
+//
+//  Description:    This function takes memory from the top of the arena.
+//                  The memory is not cleared.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void *arena_alloc(struct Arena *arena, unsigned long size, unsigned long align)
+{
+    unsigned long address = (arena->top + align - 1) & ~(align - 1);
+
+
+    if (address < arena->top || size > arena->end - address) {
+        arena->failures++;
+        return 0;
+    }
+
+    arena->top = address + size;
+    if (arena->top > arena->highWater) {
+        arena->highWater = arena->top;
+    }
+
+    return (void *)address;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       arena_mark
+//
+//  Arguments:      arena:           The arena
+//
+//  Returns:        The current top of the arena
+//
+//  Description:    This function records how much of the arena is in use,
+//                  so that everything allocated after it can be given back
+//                  at once with arena_reset().
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned long arena_mark(struct Arena *arena)
+{
+    return arena->top;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       arena_reset
+//
+//  Arguments:      arena:           The arena
+//                  mark:            A mark from arena_mark(), or
+//                                   arena->start to empty the arena
+//
+//  Returns:        void
+//
+//  Description:    This function frees everything allocated since the mark
+//                  was taken. Marks must be reset in the reverse order they
+//                  were taken.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void arena_reset(struct Arena *arena, unsigned long mark)
+{
+    if (mark >= arena->start && mark <= arena->top) {
+        arena->top = mark;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       pool_init
+//
+//  Arguments:      pool:            The pool to set up
+//                  arena:           The arena to take its memory from
+//                  objectSize:      The size of each object in bytes
+//                  capacity:        The number of objects
+//
+//  Returns:        TRUE (non-zero) if the pool was set up, FALSE (zero) if
+//                  the arena did not have room for it
+//
+//  Description:    This function allocates the objects of a pool, starting
+//                  on a cache line, and puts them all on the free list.
+//                  Each object is rounded up to 16 bytes, so any object can
+//                  hold the largest scalar types.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int pool_init(struct Pool *pool, struct Arena *arena, unsigned long objectSize,
+              unsigned int capacity)
+{
+    unsigned int i;
+
+
+    pool->objectSize = (objectSize + 15) & ~15UL;
+    pool->capacity = capacity;
+    pool->used = 0;
+    pool->highWater = 0;
+    pool->freeList = 0;
+    pool->memory = arena_alloc(arena, pool->objectSize * capacity, MEMORY_CACHE_LINE);
+
+    if (!pool->memory) {
+        pool->capacity = 0;
+        return 0;
+    }
+
+    // Thread the free list through the objects, lowest address first
+    for (i = capacity; i > 0; i--) {
+        *(void **)(pool->memory + ((i - 1) * pool->objectSize)) = pool->freeList;
+        pool->freeList = pool->memory + ((i - 1) * pool->objectSize);
+    }
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       pool_alloc
+//
+//  Arguments:      pool:            The pool
+//
+//  Returns:        A free object, or 0 if all are in use
+//
+//  Description:    This function takes an object off the free list. The
+//                  object is not cleared.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void *pool_alloc(struct Pool *pool)
+{
+    void *object = pool->freeList;
+
+
+    if (!object) {
+        return 0;
+    }
+
+    pool->freeList = *(void **)object;
+    pool->used++;
+    if (pool->used > pool->highWater) {
+        pool->highWater = pool->used;
+    }
+
+    return object;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       pool_free
+//
+//  Arguments:      pool:            The pool
+//                  object:          An object from pool_alloc(), or 0
+//
+//  Returns:        void
+//
+//  Description:    This function puts an object back on the free list.
+//                  Pointers that are not the start of an object in this
+//                  pool are ignored.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void pool_free(struct Pool *pool, void *object)
+{
+    unsigned long offset = (unsigned char *)object - pool->memory;
+
+
+    if (!object || offset >= pool->objectSize * pool->capacity ||
+        offset % pool->objectSize) {
+        return;
+    }
+
+    *(void **)object = pool->freeList;
+    pool->freeList = object;
+    pool->used--;
+}
@@ -0,0 +1,43 @@
+// The cache line size of the Cortex-A53. Allocations aligned to it do not
+// share a line with anything else.
+#define MEMORY_CACHE_LINE       64
+
+// A bump allocator over a range of memory. Allocation moves the top up,
+// and memory is only given back all at once, by resetting the top to a
+// mark taken earlier. This suits scratch memory used for one frame or one
+// operation, and memory kept for the life of the program.
+struct Arena {
+    unsigned long start;            // First address of the arena
+    unsigned long end;              // One past the last address
+    unsigned long top;              // Next free address
+    unsigned long highWater;        // Highest the top has been
+    unsigned int failures;          // Allocations that did not fit
+};
+
+// A pool of fixed-size objects, allocated and freed in any order. Free
+// objects are kept in a list threaded through the objects themselves.
+struct Pool {
+    unsigned char *memory;          // The objects, one after another
+    unsigned long objectSize;       // Bytes per object, a multiple of 16
+    unsigned int capacity;          // Number of objects
+    unsigned int used;              // Objects allocated now
+    unsigned int highWater;         // Most objects allocated at once
+    void *freeList;                 // First free object, or 0
+};
+
+// The arena holding all ARM memory from the end of the kernel image to
+// the top of ARM RAM, set up by memory_init()
+extern struct Arena memoryArena;
+
+// Function prototypes
+int memory_init();
+void *memory_alloc(unsigned long size);
+void memory_report();
+void arena_init(struct Arena *arena, void *memory, unsigned long size);
+void *arena_alloc(struct Arena *arena, unsigned long size, unsigned long align);
+unsigned long arena_mark(struct Arena *arena);
+void arena_reset(struct Arena *arena, unsigned long mark);
+int pool_init(struct Pool *pool, struct Arena *arena, unsigned long objectSize,
+              unsigned int capacity);
+void *pool_alloc(struct Pool *pool);
+void pool_free(struct Pool *pool, void *object);
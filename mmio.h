@@ -0,0 +1,31 @@
+// Access to the memory mapped peripheral registers. Register names such as
+// GPFSEL0 or AUX_MU_IO are defined as ARM physical addresses, and are read
+// and written only through mmio_read() and mmio_write().
+//
+// In the kernel build these are single volatile 32-bit loads and stores,
+// exactly as if the register were dereferenced directly. When the program
+// is compiled with MMIO_SIMULATION defined (the host build), they are
+// instead calls into software models of the peripherals (see host/sim.c),
+// so the same drivers can be run, tested and timed on a Linux host.
+
+#ifdef MMIO_SIMULATION
+
+// Function prototypes for the simulation backend
+unsigned int mmio_read(unsigned long address);
+void mmio_write(unsigned long address, unsigned int value);
+
+#else
+
+// Returns the value of the register at the given address
+static inline unsigned int mmio_read(unsigned long address)
+{
+    return *(volatile unsigned int *)address;
+}
+
+// Writes a value to the register at the given address
+static inline void mmio_write(unsigned long address, unsigned int value)
+{
+    *(volatile unsigned int *)address = value;
+}
+
+#endif
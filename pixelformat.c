@@ -0,0 +1,223 @@
+// The functions in this file implement the frame buffer pixel formats:
+// 8-bit palettized, RGB565, RGB888 and XRGB8888, the last three in both
+// BGR and RGB pixel order. A format converts a color code once into the
+// pixel value to store, and then fills and stores pixels of its size. Pixel
+// rows that are already converted, such as tiles and glyphs, are format
+// independent, and are copied with memcpy() by length in bytes.
+//
+// The functions for each depth are written once, and the pixel order only
+// changes how a color is packed. DEFINE_PIXEL_FORMAT() generates the color
+// conversion function and the table entry for each depth and pixel order.
+
+// Needed header files
+#include "framebuffer.h"
+#include "pixelformat.h"
+#include "memops.h"
+
+// Pack a 0x00RRGGBB color code into each format and pixel order
+#define PACK_RGB565_BGR(c)      ((((c) >> 8) & 0xF800) | (((c) >> 5) & 0x07E0) | \
+                                 (((c) >> 3) & 0x001F))
+#define PACK_RGB565_RGB(c)      ((((c) << 8) & 0xF800) | (((c) >> 5) & 0x07E0) | \
+                                 (((c) >> 19) & 0x001F))
+#define PACK_RGB888_BGR(c)      ((c) & 0x00FFFFFF)
+#define PACK_RGB888_RGB(c)      ((((c) >> 16) & 0xFF) | ((c) & 0xFF00) | \
+                                 (((c) & 0xFF) << 16))
+#define PACK_XRGB8888_BGR(c)    PACK_RGB888_BGR(c)
+#define PACK_XRGB8888_RGB(c)    PACK_RGB888_RGB(c)
+
+// Generate the color conversion function and table entry of a format
+#define DEFINE_PIXEL_FORMAT(name, depth, order)                                 \
+    static unsigned int color##name##order(unsigned int color)                  \
+    {                                                                           \
+        return PACK_##name##_##order(color);                                    \
+    }                                                                           \
+    static const struct PixelFormat format##name##order = {                     \
+        depth, depth / 8, PIXEL_ORDER_##order, color##name##order,              \
+        fill##depth, store##depth                                               \
+    }
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       fill8, fill16, fill24, fill32
+//
+//  Arguments:      destination:     The first pixel to fill
+//                  pixel:           The pixel value to store
+//                  count:           The number of pixels
+//
+//  Returns:        void
+//
+//  Description:    These functions fill a row of pixels of one size. The
+//                  MMU is off, so every store must be aligned to its size.
+//                  The 16-bit and 24-bit fills store single pixels until
+//                  they reach a word or doubleword boundary, and then store
+//                  whole words or doublewords of repeated pixels.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void fill8(unsigned char *destination, unsigned int pixel, unsigned long count)
+{
+    memset(destination, pixel, count);
+}
+
+static void fill16(unsigned char *destination, unsigned int pixel, unsigned long count)
+{
+    if (count && ((unsigned long)destination & 2)) {
+        *(unsigned short *)destination = pixel;
+        destination += 2;
+        count--;
+    }
+
+    memset32(destination, pixel | (pixel << 16), count / 2);
+
+    if (count & 1) {
+        *(unsigned short *)(destination + (count & ~1UL) * 2) = pixel;
+    }
+}
+
+static void fill24(unsigned char *destination, unsigned int pixel, unsigned long count)
+{
+    unsigned long pattern[3], *doubleword;
+    unsigned char *byte;
+    int i;
+
+
+    // Store single pixels up to a doubleword boundary
+    while (count && ((unsigned long)destination & 7)) {
+        destination[0] = pixel;
+        destination[1] = pixel >> 8;
+        destination[2] = pixel >> 16;
+        destination += 3;
+        count--;
+    }
+
+    // Eight pixels are exactly three doublewords
+    if (count >= 8) {
+        byte = (unsigned char *)pattern;
+        for (i = 0; i < 24; i += 3) {
+            byte[i] = pixel;
+            byte[i + 1] = pixel >> 8;
+            byte[i + 2] = pixel >> 16;
+        }
+
+        doubleword = (unsigned long *)destination;
+        while (count >= 8) {
+            doubleword[0] = pattern[0];
+            doubleword[1] = pattern[1];
+            doubleword[2] = pattern[2];
+            doubleword += 3;
+            count -= 8;
+        }
+        destination = (unsigned char *)doubleword;
+    }
+
+    while (count--) {
+        destination[0] = pixel;
+        destination[1] = pixel >> 8;
+        destination[2] = pixel >> 16;
+        destination += 3;
+    }
+}
+
+static void fill32(unsigned char *destination, unsigned int pixel, unsigned long count)
+{
+    memset32(destination, pixel, count);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       store8, store16, store24, store32
+//
+//  Arguments:      destination:     Where to store the pixel
+//                  pixel:           The pixel value to store
+//
+//  Returns:        void
+//
+//  Description:    These functions store one pixel of one size. They are
+//                  for building pixel rows in memory, such as the tile
+//                  atlas, not for drawing into the frame buffer.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void store8(unsigned char *destination, unsigned int pixel)
+{
+    destination[0] = pixel;
+}
+
+static void store16(unsigned char *destination, unsigned int pixel)
+{
+    destination[0] = pixel;
+    destination[1] = pixel >> 8;
+}
+
+static void store24(unsigned char *destination, unsigned int pixel)
+{
+    destination[0] = pixel;
+    destination[1] = pixel >> 8;
+    destination[2] = pixel >> 16;
+}
+
+static void store32(unsigned char *destination, unsigned int pixel)
+{
+    destination[0] = pixel;
+    destination[1] = pixel >> 8;
+    destination[2] = pixel >> 16;
+    destination[3] = pixel >> 24;
+}
+
+
+
+// The formats. The 8-bit format converts colors through the palette, and
+// has no pixel order.
+DEFINE_PIXEL_FORMAT(RGB565, 16, BGR);
+DEFINE_PIXEL_FORMAT(RGB565, 16, RGB);
+DEFINE_PIXEL_FORMAT(RGB888, 24, BGR);
+DEFINE_PIXEL_FORMAT(RGB888, 24, RGB);
+DEFINE_PIXEL_FORMAT(XRGB8888, 32, BGR);
+DEFINE_PIXEL_FORMAT(XRGB8888, 32, RGB);
+
+static const struct PixelFormat formatPalette8 = {
+    8, 1, PIXEL_ORDER_BGR, frameBufferPaletteColor, fill8, store8
+};
+
+static const struct PixelFormat *const pixelFormats[] = {
+    &formatPalette8,
+    &formatRGB565BGR, &formatRGB565RGB,
+    &formatRGB888BGR, &formatRGB888RGB,
+    &formatXRGB8888BGR, &formatXRGB8888RGB
+};
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       findPixelFormat
+//
+//  Arguments:      depth:           Bits per pixel
+//                  pixelOrder:      PIXEL_ORDER_BGR or PIXEL_ORDER_RGB
+//
+//  Returns:        The pixel format, or 0 if the depth is not supported
+//
+//  Description:    This function finds the pixel format for a frame buffer
+//                  depth and pixel order. The pixel order is ignored at 8
+//                  bits per pixel.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+const struct PixelFormat *findPixelFormat(unsigned int depth, unsigned int pixelOrder)
+{
+    unsigned int i;
+
+
+    for (i = 0; i < sizeof(pixelFormats) / sizeof(pixelFormats[0]); i++) {
+        if (pixelFormats[i]->depth == depth &&
+            (depth == 8 || pixelFormats[i]->pixelOrder == pixelOrder)) {
+            return pixelFormats[i];
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,28 @@
+// A frame buffer pixel format: how an RGB color code is stored, and the
+// drawing functions specialized for it. Each format's functions are
+// generated from the same code for its depth and pixel order, and
+// initFrameBufferVirtual() picks the format matching what the video core
+// set up, so the drawing code calls through the table without testing the
+// format for each pixel.
+//
+// Pixels are stored little endian, so a pixel value's low byte is at the
+// lowest address. In BGR order, blue is in the lowest bits, the same as an
+// RGB color code (0x00RRGGBB).
+struct PixelFormat {
+    unsigned int depth;             // Bits per pixel
+    unsigned int bytes;             // Bytes per pixel
+    unsigned int pixelOrder;        // PIXEL_ORDER_BGR or PIXEL_ORDER_RGB
+    unsigned int (*color)(unsigned int color);
+    void (*fill)(unsigned char *destination, unsigned int pixel, unsigned long count);
+    void (*store)(unsigned char *destination, unsigned int pixel);
+};
+
+// Pixel orders, as in the TAG_SET_PIXEL_ORDER mailbox property tag
+#define PIXEL_ORDER_BGR         0
+#define PIXEL_ORDER_RGB         1
+
+// The most bytes a pixel takes in any format
+#define PIXEL_MAX_BYTES         4
+
+// Function prototypes
+const struct PixelFormat *findPixelFormat(unsigned int depth, unsigned int pixelOrder);
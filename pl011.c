@@ -0,0 +1,289 @@
+// The functions in this file drive the PL011 UART (UART0) of the Raspberry
+// Pi 3, which can run the serial console much faster than the Mini UART.
+// uart.c uses them in place of the Mini UART when the kernel is built with
+// CONSOLE_PL011 defined ('make CONSOLE_UART=pl011').
+//
+// On the Pi 3 the PL011 is normally connected to the Bluetooth module,
+// through GPIO pins 32 and 33. pl011_init() connects it to GPIO pins 14
+// and 15 instead, where the Mini UART would otherwise be.
+//
+// The FIFO watermarks are set so that the transmit interrupt is raised
+// when the transmit FIFO has drained to 2 characters, and the receive
+// interrupt when the receive FIFO holds 8. The interrupts are masked,
+// since the kernel polls, but their raw status still follows the
+// watermarks. pl011_transmit_space() uses it to fill most of the FIFO
+// after one status read, rather than reading the flags before every
+// character.
+
+// Needed header files
+#include "mmio.h"
+#include "gpio.h"
+#include "mailbox.h"
+#include "clock.h"
+#include "pl011.h"
+
+// The addresses of the PL011 registers.
+//
+// These are defined in section 13 (UART) of the Broadcom BCM2837 ARM
+// Peripherals Manual.
+#define UART0_BASE              (MMIO_BASE + 0x00201000)
+#define UART0_DR                (UART0_BASE + 0x00)
+#define UART0_FR                (UART0_BASE + 0x18)
+#define UART0_IBRD              (UART0_BASE + 0x24)
+#define UART0_FBRD              (UART0_BASE + 0x28)
+#define UART0_LCRH              (UART0_BASE + 0x2C)
+#define UART0_CR                (UART0_BASE + 0x30)
+#define UART0_IFLS              (UART0_BASE + 0x34)
+#define UART0_IMSC              (UART0_BASE + 0x38)
+#define UART0_RIS               (UART0_BASE + 0x3C)
+#define UART0_ICR               (UART0_BASE + 0x44)
+
+// Flag register bits
+#define FR_BUSY                 (1 << 3)
+#define FR_RXFE                 (1 << 4)    // Receive FIFO empty
+#define FR_TXFF                 (1 << 5)    // Transmit FIFO full
+#define FR_TXFE                 (1 << 7)    // Transmit FIFO empty
+
+// Line control bits: 8 data bits, no parity, one stop bit, FIFOs on
+#define LCRH_FEN                (1 << 4)
+#define LCRH_WLEN_8             (3 << 5)
+
+// Control register bits
+#define CR_UARTEN               (1 << 0)
+#define CR_TXE                  (1 << 8)
+#define CR_RXE                  (1 << 9)
+
+// FIFO levels: the transmit interrupt is raised at 1/8 full or less, and
+// the receive interrupt at 1/2 full or more
+#define IFLS_TX_1_8             0
+#define IFLS_RX_1_2             (2 << 3)
+#define PL011_TX_WATERMARK      (PL011_FIFO_SIZE / 8)
+
+// All the interrupt bits, for clearing them
+#define PL011_ALL_INTERRUPTS    0x7FF
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       pl011_init
+//
+//  Arguments:      baud:            The Baud rate to run at
+//
+//  Returns:        The Baud rate the divisor gives, which may differ a
+//                  little from the rate asked for, or 0 if the UART clock
+//                  cannot be made fast enough for it, in which case the
+//                  PL011 is left turned off
+//
+//  Description:    This function connects the PL011 to GPIO pins 14 and 15,
+//                  and starts it in 8-bit mode with both FIFOs on. The
+//                  divisor is worked out from the UART clock rate reported
+//                  by the firmware. If that is too slow for the Baud rate,
+//                  the clock is raised to PL011_CLOCK_RATE, or to sixteen
+//                  times the Baud rate if that is higher.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int pl011_init(unsigned int baud)
+{
+    register unsigned int r;
+    unsigned int rate, divisor;
+
+
+    // Turn the UART off while it is set up, once anything it is still
+    // sending has gone
+    mmio_write(UART0_CR, 0);
+    while (mmio_read(UART0_FR) & FR_BUSY) {
+        asm volatile("nop");
+    }
+
+    // Map the PL011 to GPIO pins 14 and 15 by setting the fields FSEL14
+    // and FSEL15 of GPIO Function Select Register 1 to alternate function
+    // 0 (bit pattern 100)
+    r = mmio_read(GPFSEL1);
+    r &= ~( (0x7 << 12) | (0x7 << 15) );
+    r |= (0x4 << 12) | (0x4 << 15);
+    mmio_write(GPFSEL1, r);
+
+    // Disable the pull-up/pull-down control for the two pins, as
+    // uart_init() does for the Mini UART
+    mmio_write(GPPUD, 0x0);
+    r = 150;
+    while (r--) {
+        asm volatile("nop");
+    }
+    mmio_write(GPPUDCLK0, (0x1 << 14) | (0x1 << 15));
+    r = 150;
+    while (r--) {
+        asm volatile("nop");
+    }
+    mmio_write(GPPUDCLK0, 0);
+
+    // Find the UART clock, and raise it if it is too slow, to the usual
+    // rate or the slowest the Baud rate needs, whichever is faster
+    rate = clock_get_rate(CLOCK_UART);
+    if (rate < 16 * baud) {
+        rate = PL011_CLOCK_RATE;
+        if (rate < 16 * baud) {
+            rate = 16 * baud;
+        }
+        rate = clock_set_rate(CLOCK_UART, rate);
+    }
+    if (rate < 16 * baud) {
+        return 0;
+    }
+
+    // The divisor in 64ths: (rate / (16 * baud)) * 64, rounded
+    divisor = (unsigned int)((((unsigned long)rate * 4) + (baud / 2)) / baud);
+    if ((divisor >> 6) > 0xFFFF) {
+        return 0;
+    }
+
+    mmio_write(UART0_ICR, PL011_ALL_INTERRUPTS);
+    mmio_write(UART0_IBRD, divisor >> 6);
+    mmio_write(UART0_FBRD, divisor & 0x3F);
+    mmio_write(UART0_LCRH, LCRH_WLEN_8 | LCRH_FEN);
+    mmio_write(UART0_IFLS, IFLS_TX_1_8 | IFLS_RX_1_2);
+    mmio_write(UART0_IMSC, 0);
+    mmio_write(UART0_CR, CR_UARTEN | CR_TXE | CR_RXE);
+
+    return (unsigned int)(((unsigned long)rate * 4) / divisor);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       pl011_transmit_space
+//
+//  Arguments:      none
+//
+//  Returns:        How many characters can be written to the transmit FIFO
+//                  without waiting, which may be fewer than are free
+//
+//  Description:    This function reads how much room there is in the
+//                  transmit FIFO. The PL011 does not give the FIFO level,
+//                  so the space is found from the empty flag, then the
+//                  transmit watermark, then the full flag.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int pl011_transmit_space()
+{
+    unsigned int flags = mmio_read(UART0_FR);
+
+
+    if (flags & FR_TXFE) {
+        return PL011_FIFO_SIZE;
+    }
+    if (mmio_read(UART0_RIS) & PL011_INT_TX) {
+        return PL011_FIFO_SIZE - PL011_TX_WATERMARK;
+    }
+
+    return (flags & FR_TXFF) ? 0 : 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       pl011_send
+//
+//  Arguments:      c:               The character to send
+//
+//  Returns:        void
+//
+//  Description:    This function writes a character to the transmit FIFO.
+//                  There must be room for it, as pl011_transmit_space()
+//                  reports.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void pl011_send(unsigned int c)
+{
+    mmio_write(UART0_DR, c & 0xFF);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       pl011_received
+//
+//  Arguments:      none
+//
+//  Returns:        TRUE (non-zero) if a character is waiting in the receive
+//                  FIFO, FALSE (zero) otherwise
+//
+//  Description:    This function polls the receive FIFO without waiting.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int pl011_received()
+{
+    return !(mmio_read(UART0_FR) & FR_RXFE);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       pl011_receive
+//
+//  Arguments:      none
+//
+//  Returns:        The next character in the receive FIFO
+//
+//  Description:    This function reads a character that pl011_received()
+//                  has reported. The error bits read with it are dropped.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int pl011_receive()
+{
+    return mmio_read(UART0_DR) & 0xFF;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       pl011_idle
+//
+//  Arguments:      none
+//
+//  Returns:        TRUE (non-zero) once every character written has been
+//                  sent, FALSE (zero) otherwise
+//
+//  Description:    This function checks that the transmit FIFO is empty and
+//                  the UART is no longer sending.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int pl011_idle()
+{
+    return (mmio_read(UART0_FR) & (FR_TXFE | FR_BUSY)) == FR_TXFE;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       pl011_set_interrupts
+//
+//  Arguments:      mask:            PL011_INT_ bits of the interrupts to
+//                                   raise, or 0 for none
+//
+//  Returns:        void
+//
+//  Description:    This function unmasks the watermark and timeout
+//                  interrupts, for use once the kernel handles interrupts.
+//                  Any that were already pending are cleared first.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void pl011_set_interrupts(unsigned int mask)
+{
+    mmio_write(UART0_ICR, PL011_ALL_INTERRUPTS);
+    mmio_write(UART0_IMSC, mask);
+}
@@ -0,0 +1,25 @@
+// The PL011 UART (UART0) has 16-entry transmit and receive FIFOs, and its
+// own reference clock (CLOCK_UART), so its Baud rate does not change with
+// the core clock. The Baud rate divisor is UARTCLK / (16 * Baud), with 6
+// fraction bits, so the fastest rate is a sixteenth of the UART clock.
+#define PL011_FIFO_SIZE         16
+
+// The UART clock to ask for if the firmware runs it too slowly for the
+// Baud rate, which is what the Pi 3 firmware normally sets
+#define PL011_CLOCK_RATE        48000000
+
+// Interrupts for pl011_set_interrupts(). The receive and transmit
+// interrupts are raised by the FIFO watermarks, and the receive timeout
+// interrupt when characters are left below the receive watermark.
+#define PL011_INT_RX            (1 << 4)
+#define PL011_INT_TX            (1 << 5)
+#define PL011_INT_RX_TIMEOUT    (1 << 6)
+
+// Function prototypes
+unsigned int pl011_init(unsigned int baud);
+unsigned int pl011_transmit_space();
+void pl011_send(unsigned int c);
+int pl011_received();
+unsigned int pl011_receive();
+int pl011_idle();
+void pl011_set_interrupts(unsigned int mask);
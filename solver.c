@@ -0,0 +1,202 @@
+// The functions in this file find the shortest way out of a maze. A single
+// breadth-first flood from the exit labels every open cell with its distance
+// to the exit, so the best move from any cell is found by looking at its
+// (at most four) neighbors for one that is a step closer. This serves hints,
+// checking that a generated maze can be solved, and auto-solving alike.
+//
+// The flood uses a flat array as its queue instead of recursion. Every cell
+// is queued at most once, so the queue never needs more than one entry per
+// cell and never wraps around.
+
+// Needed header files
+#include "maze.h"
+#include "solver.h"
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       solver_init
+//
+//  Arguments:      solver:          The solver to set up
+//                  maze:            The maze to solve
+//                  distance:        Storage for the distance field, at least
+//                                   one word per maze cell
+//                  queue:           Storage for the flood queue, at least
+//                                   one word per maze cell
+//                  capacity:        The number of cells the storage can hold
+//
+//  Returns:        void
+//
+//  Description:    This function sets up a solver for a maze. The distance
+//                  field is computed the first time it is needed.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void solver_init(struct Solver *solver, struct Maze *maze, unsigned int *distance,
+                 unsigned int *queue, unsigned int capacity)
+{
+    solver->maze = maze;
+    solver->distance = distance;
+    solver->queue = queue;
+    solver->capacity = capacity;
+    solver->generation = 0;
+    solver->valid = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       solver_update
+//
+//  Arguments:      solver:          The solver
+//
+//  Returns:        TRUE (non-zero) if the distance field is usable, FALSE
+//                  (zero) if the maze has no exit or does not fit in the
+//                  solver storage
+//
+//  Description:    This function recomputes the distance field if the maze
+//                  has changed since it was last computed. The flood works
+//                  on row-major cell indexes and the precomputed neighbor
+//                  masks, so it needs no bounds checks or divisions.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int solver_update(struct Solver *solver)
+{
+    struct Maze *maze = solver->maze;
+    unsigned int *distance = solver->distance;
+    unsigned int *queue = solver->queue;
+    unsigned int cells, head, tail, index, next, step, mask;
+    int offset[DIRECTIONS];
+    int direction;
+
+
+    if (solver->valid && solver->generation == maze->generation) {
+        return 1;
+    }
+
+    cells = maze->width * maze->height;
+    if (cells > solver->capacity || maze->exitX < 0) {
+        solver->valid = 0;
+        return 0;
+    }
+
+    // Index offsets of the neighbor in each direction
+    offset[DIRECTION_UP] = -maze->width;
+    offset[DIRECTION_DOWN] = maze->width;
+    offset[DIRECTION_LEFT] = -1;
+    offset[DIRECTION_RIGHT] = 1;
+
+    for (index = 0; index < cells; index++) {
+        distance[index] = SOLVER_UNREACHABLE;
+    }
+
+    // Flood outward from the exit, one distance at a time
+    index = (maze->exitY * maze->width) + maze->exitX;
+    distance[index] = 0;
+    queue[0] = index;
+    head = 0;
+    tail = 1;
+
+    while (head < tail) {
+        index = queue[head++];
+        step = distance[index] + 1;
+        mask = maze_neighbors_at(maze, index);
+
+        for (direction = 0; mask; direction++, mask >>= 1) {
+            if (mask & 1) {
+                next = index + offset[direction];
+
+                if (distance[next] == SOLVER_UNREACHABLE) {
+                    distance[next] = step;
+                    queue[tail++] = next;
+                }
+            }
+        }
+    }
+
+    solver->generation = maze->generation;
+    solver->valid = 1;
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       solver_distance
+//
+//  Arguments:      solver:          The solver
+//                  x:               Cell x coordinate
+//                  y:               Cell y coordinate
+//
+//  Returns:        The number of moves from the cell to the exit, or
+//                  SOLVER_UNREACHABLE if the exit cannot be reached
+//
+//  Description:    This function looks up the distance to the exit from a
+//                  cell, computing the distance field first if needed.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int solver_distance(struct Solver *solver, int x, int y)
+{
+    if (!solver_update(solver)) {
+        return SOLVER_UNREACHABLE;
+    }
+
+    return solver->distance[(y * solver->maze->width) + x];
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       solver_next_move
+//
+//  Arguments:      solver:          The solver
+//                  x:               Cell x coordinate
+//                  y:               Cell y coordinate
+//
+//  Returns:        The direction of a shortest-path move towards the exit,
+//                  or SOLVER_NO_MOVE if the cell is the exit or cannot reach
+//                  it
+//
+//  Description:    This function finds the next best move from a cell. The
+//                  move goes to an open neighbor one step closer to the
+//                  exit, which always exists on a shortest path, so the
+//                  lookup takes constant time.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int solver_next_move(struct Solver *solver, int x, int y)
+{
+    struct Maze *maze = solver->maze;
+    unsigned int index, wanted, mask;
+    int direction;
+
+
+    if (!solver_update(solver)) {
+        return SOLVER_NO_MOVE;
+    }
+
+    index = (y * maze->width) + x;
+    if (solver->distance[index] == 0 || solver->distance[index] == SOLVER_UNREACHABLE) {
+        return SOLVER_NO_MOVE;
+    }
+
+    wanted = solver->distance[index] - 1;
+    mask = maze_neighbors_at(maze, index);
+
+    for (direction = 0; direction < DIRECTIONS; direction++) {
+        if (((mask >> direction) & 1) &&
+            solver->distance[(y + directionY[direction]) * maze->width +
+                             x + directionX[direction]] == wanted) {
+            return direction;
+        }
+    }
+
+    return SOLVER_NO_MOVE;
+}
@@ -0,0 +1,26 @@
+// A distance value for cells that cannot reach the exit, including walls
+#define SOLVER_UNREACHABLE  0xFFFFFFFF
+
+// Returned by solver_next_move() when there is no move to make
+#define SOLVER_NO_MOVE      -1
+
+// A distance field over a maze. Every cell holds the number of moves from
+// it to the exit, found with one breadth-first flood outward from the exit.
+// The field is recomputed only when the maze generation count changes. The
+// distance and queue storage, one word per cell each, is supplied by the
+// caller.
+struct Solver {
+    struct Maze *maze;
+    unsigned int *distance;         // Moves to the exit, per cell
+    unsigned int *queue;            // Flood queue of row-major cell indexes
+    unsigned int capacity;          // Cells the storage can hold
+    unsigned int generation;        // Maze generation the field is for
+    int valid;                      // Whether the field has been computed
+};
+
+// Function prototypes
+void solver_init(struct Solver *solver, struct Maze *maze, unsigned int *distance,
+                 unsigned int *queue, unsigned int capacity);
+int solver_update(struct Solver *solver);
+unsigned int solver_distance(struct Solver *solver, int x, int y);
+int solver_next_move(struct Solver *solver, int x, int y);
@@ -0,0 +1,3 @@
+// The number of CPU cycles from _start to just before main() is called,
+// counted by the performance monitor cycle counter. It is set by start.s.
+extern unsigned long boot_cycles;
@@ -7,7 +7,8 @@
 // backwards (toward 0), so it uses memory addresses
 // below that of the _start routine.
 //
-// We also zero out all bytes in the .bss section, and
+// We also zero out all bytes in the .bss section, record
+// the number of CPU cycles this took in boot_cycles, and
 // then branch to the main() routine. The main() routine
 // should never return to this code (it should be in
 // an infinite loop), but if it does, we then put the
@@ -38,6 +39,17 @@ loop:  	wfe			// Wait for event
   	// If here, the CPU Core is 0, and we run the rest of the program
 core_zero:
 
+	// Start the performance monitor cycle counter from zero, so that
+	// the time spent in early boot can be measured. Bit 31 of
+	// PMCNTENSET_EL0 enables the cycle counter itself.
+	mrs	x1, pmcr_el0
+	orr	x1, x1, 0x1		// E: enable the counters
+	orr	x1, x1, 0x4		// C: reset the cycle counter
+	msr	pmcr_el0, x1
+	mov	x1, 0x80000000
+	msr	pmcntenset_el0, x1
+	isb
+
 	// Set the stack pointer to point to where the _start routine
 	// begins. The stack grows backwards (towards 0), so it uses memory
 	// that has lower addresses than the _start routine. We need to
@@ -47,22 +59,49 @@ core_zero:
 	add	x1, x1, :lo12:_start
 	mov     sp, x1		// Copy the address into the sp register
 
-	// Clear the .bss section using a loop. The __bss_start
-	// symbol is provided by the linker, and is the address in
-	// RAM where the .bss starts. The __bss_size symbol is
-	// also provided by the linker, and gives the size (in doublewords)
-	// of the .bss section.
+	// Clear the .bss section. The __bss_start and __bss_end symbols
+	// are provided by the linker, and give the addresses in RAM where
+	// the .bss starts and ends. The MMU is not on yet, so memory is
+	// treated as Device memory: DC ZVA cannot be used, and every store
+	// must be aligned to its size. The bulk of the section is cleared
+	// with bursts of four 16-byte STP stores, which fill one 64-byte
+	// cache line per loop. The linker aligns both ends to 64 bytes, so
+	// the doubleword head and tail loops normally have nothing to do.
 	adrp	x1, __bss_start		// Put address of .bss into x1
 	add	x1, x1, :lo12:__bss_start
-	ldr     w2, =__bss_size		// Put the size of the .bss section
-					// into w2, using a literal pool.
-					// w2 is our counter.
+	adrp	x2, __bss_end		// Put the end of .bss into x2
+	add	x2, x2, :lo12:__bss_end
+
+bss_head:
+	tst	x1, 63			// Clear doublewords until x1 is
+	b.eq	bss_bursts		// 64-byte aligned
+	cmp	x1, x2
+	b.hs	bss_done
+	str	xzr, [x1], 8
+	b	bss_head
+
+bss_bursts:
+	sub	x3, x2, x1		// Clear 64 bytes per loop while at
+	cmp	x3, 64			// least 64 bytes are left
+	b.lo	bss_tail
+	stp	xzr, xzr, [x1]
+	stp	xzr, xzr, [x1, 16]
+	stp	xzr, xzr, [x1, 32]
+	stp	xzr, xzr, [x1, 48]
+	add	x1, x1, 64
+	b	bss_bursts
 
-top:	cbz     w2, endloop		// Exit loop if counter == 0
-	str     xzr, [x1], 8		// Write zeroes to RAM, x1 += 8
-	sub     w2, w2, 1		// Decrement counter (w2)
-	cbnz    w2, top			// Keep looping while counter != 0
-endloop:	
+bss_tail:
+	cmp	x1, x2			// Clear any doublewords left
+	b.hs	bss_done
+	str	xzr, [x1], 8
+	b	bss_tail
+bss_done:
+
+	// Record the cycles spent getting here, for main() to report
+	mrs	x1, pmccntr_el0
+	adrp	x2, boot_cycles
+	str	x1, [x2, :lo12:boot_cycles]
 
 	// Branch to the main() routine, which should never return
   	bl      main
@@ -70,3 +109,12 @@ endloop:
 	// We should never arrive here, but if we do
 	// we branch to the infinite loop above
 	b       loop
+
+
+	// The number of CPU cycles from _start to just before main()
+	// is called. It is in .bss, so it is written after the clear.
+	.section ".bss"
+	.balign	8
+	.global	boot_cycles
+boot_cycles:
+	.skip	8
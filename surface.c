@@ -0,0 +1,234 @@
+// The functions in this file allocate off-screen surfaces in memory owned by
+// the video core, using the GPU memory property tags. A surface is
+// allocated with TAG_ALLOCATE_MEMORY, which gives a handle, and locked with
+// TAG_LOCK_MEMORY, which gives its bus address. The memory is kept locked
+// until the surface is destroyed, so the video core cannot move it.
+//
+// The memory is allocated with MEM_FLAG_DIRECT, so its bus address is in
+// the 0xC0000000 alias that bypasses the L2 cache, like the frame buffer.
+// The CPU address is the bus address without the alias bits. Surfaces
+// hold pixels in the frame buffer's pixel format, so copies between a
+// surface and the frame buffer are plain row copies, done with DMA when
+// there is a channel.
+
+// Needed header files
+#include "mailbox.h"
+#include "framebuffer.h"
+#include "pixelformat.h"
+#include "surface.h"
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       memoryTag
+//
+//  Arguments:      tag:             TAG_LOCK_MEMORY, TAG_UNLOCK_MEMORY or
+//                                   TAG_RELEASEMEMORY
+//                  handle:          A GPU memory handle
+//                  response:        Where to return the response word
+//
+//  Returns:        TRUE (non-zero) if the video core answered the tag,
+//                  FALSE (zero) otherwise
+//
+//  Description:    This function sends one of the GPU memory tags that take
+//                  a handle and answer with a single word.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static int memoryTag(unsigned int tag, unsigned int handle, unsigned int *response)
+{
+    mailbox_buffer[0] = 7 * 4;
+    mailbox_buffer[1] = MAILBOX_REQUEST;
+
+    mailbox_buffer[2] = tag;
+    mailbox_buffer[3] = 4;
+    mailbox_buffer[4] = 0;
+    mailbox_buffer[5] = handle;                 // Response: depends on the tag
+
+    mailbox_buffer[6] = TAG_LAST;
+
+    if (!mailbox_query(CHANNEL_PROPERTY_TAGS_ARMTOVC) ||
+        !(mailbox_buffer[4] & TAG_RESPONSE)) {
+        return 0;
+    }
+
+    *response = mailbox_buffer[5];
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       surface_create
+//
+//  Arguments:      surface:         The surface to set up
+//                  width:           Width in pixels
+//                  height:          Height in pixels
+//
+//  Returns:        TRUE (non-zero) if the surface was allocated, FALSE
+//                  (zero) otherwise, in which case it has no pixels
+//
+//  Description:    This function allocates and locks video core memory for
+//                  a surface, with rows aligned to SURFACE_ROW_ALIGNMENT.
+//                  The pixels are cleared to zero. The frame buffer must
+//                  already have been initialized, since the surface uses
+//                  its pixel format.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int surface_create(struct Surface *surface, unsigned int width, unsigned int height)
+{
+    unsigned int address;
+
+
+    surface->handle = 0;
+    surface->busAddress = 0;
+    surface->pixels = 0;
+    surface->width = width;
+    surface->height = height;
+    surface->pitch = ((width * frameBufferFormat->bytes) + SURFACE_ROW_ALIGNMENT - 1) &
+                     ~(SURFACE_ROW_ALIGNMENT - 1);
+    surface->size = surface->pitch * height;
+
+    if (surface->size == 0) {
+        return 0;
+    }
+
+    mailbox_buffer[0] = 9 * 4;
+    mailbox_buffer[1] = MAILBOX_REQUEST;
+
+    mailbox_buffer[2] = TAG_ALLOCATE_MEMORY;
+    mailbox_buffer[3] = 12;
+    mailbox_buffer[4] = 0;
+    mailbox_buffer[5] = surface->size;          // Response: handle
+    mailbox_buffer[6] = SURFACE_ROW_ALIGNMENT;
+    mailbox_buffer[7] = MEM_FLAG_DIRECT | MEM_FLAG_ZERO | MEM_FLAG_HINT_PERMALOCK;
+
+    mailbox_buffer[8] = TAG_LAST;
+
+    if (!mailbox_query(CHANNEL_PROPERTY_TAGS_ARMTOVC) ||
+        !(mailbox_buffer[4] & TAG_RESPONSE) || mailbox_buffer[5] == 0) {
+        return 0;
+    }
+
+    surface->handle = mailbox_buffer[5];
+
+    // Lock the memory where it is, for as long as the surface exists
+    if (!memoryTag(TAG_LOCK_MEMORY, surface->handle, &address) || address == 0) {
+        memoryTag(TAG_RELEASEMEMORY, surface->handle, &address);
+        surface->handle = 0;
+        return 0;
+    }
+
+    surface->busAddress = address;
+    surface->pixels = (unsigned char *)(unsigned long)(address & 0x3FFFFFFF);
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       surface_destroy
+//
+//  Arguments:      surface:         A surface from surface_create()
+//
+//  Returns:        void
+//
+//  Description:    This function unlocks a surface's memory and gives it
+//                  back to the video core. Any DMA still using the surface
+//                  is waited for first.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void surface_destroy(struct Surface *surface)
+{
+    unsigned int status;
+
+
+    if (!surface->handle) {
+        return;
+    }
+
+    startFrameBufferDma();
+    waitFrameBufferDma();
+
+    memoryTag(TAG_UNLOCK_MEMORY, surface->handle, &status);
+    memoryTag(TAG_RELEASEMEMORY, surface->handle, &status);
+
+    surface->handle = 0;
+    surface->busAddress = 0;
+    surface->pixels = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       surface_blit_to_framebuffer
+//
+//  Arguments:      surface:         The surface to copy from
+//                  x:               Left pixel x coordinate in the surface
+//                  y:               Top pixel y coordinate in the surface
+//                  width:           Rectangle width in pixels
+//                  height:          Rectangle height in pixels
+//                  frameBufferX:    Left pixel x coordinate to copy to
+//                  frameBufferY:    Top pixel y coordinate to copy to
+//
+//  Returns:        void
+//
+//  Description:    This function queues a copy of part of a surface into
+//                  the frame buffer with queueBlit(). It runs when
+//                  startFrameBufferDma() is called, or at once without DMA.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void surface_blit_to_framebuffer(struct Surface *surface, int x, int y, int width, int height,
+                                 int frameBufferX, int frameBufferY)
+{
+    if (!surface->pixels || width <= 0) {
+        return;
+    }
+
+    queueBlit(FRAMEBUFFER_PIXEL(frameBufferX, frameBufferY), frameBufferPitch,
+              SURFACE_PIXEL(surface, x, y), surface->pitch,
+              width * frameBufferFormat->bytes, height);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       surface_blit_from_framebuffer
+//
+//  Arguments:      surface:         The surface to copy to
+//                  x:               Left pixel x coordinate in the surface
+//                  y:               Top pixel y coordinate in the surface
+//                  width:           Rectangle width in pixels
+//                  height:          Rectangle height in pixels
+//                  frameBufferX:    Left pixel x coordinate to copy from
+//                  frameBufferY:    Top pixel y coordinate to copy from
+//
+//  Returns:        void
+//
+//  Description:    This function queues a copy of part of the frame buffer
+//                  into a surface, such as to keep the background under
+//                  something drawn over it, with queueBlit().
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void surface_blit_from_framebuffer(struct Surface *surface, int x, int y, int width,
+                                   int height, int frameBufferX, int frameBufferY)
+{
+    if (!surface->pixels || width <= 0) {
+        return;
+    }
+
+    queueBlit(SURFACE_PIXEL(surface, x, y), surface->pitch,
+              FRAMEBUFFER_PIXEL(frameBufferX, frameBufferY), frameBufferPitch,
+              width * frameBufferFormat->bytes, height);
+}
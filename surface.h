@@ -0,0 +1,30 @@
+// An off-screen surface: a rectangle of pixels in the frame buffer's pixel
+// format, kept in memory the video core allocates rather than in the
+// kernel image. The memory stays locked from surface_create() to
+// surface_destroy(), so the addresses do not change, and both the CPU
+// (through pixels) and the DMA engine (through busAddress) can use it.
+struct Surface {
+    unsigned int handle;            // Video core memory handle, 0 if none
+    unsigned int busAddress;        // Address for the DMA engine
+    unsigned char *pixels;          // Address for the CPU
+    unsigned int width, height;     // Size in pixels
+    unsigned int pitch;             // Bytes from one row to the next
+    unsigned int size;              // Bytes allocated
+};
+
+// Rows start on this boundary, so that row copies can use whole
+// doublewords and DMA bursts
+#define SURFACE_ROW_ALIGNMENT   16
+
+// The address of a pixel in a surface. This needs pixelformat.h and
+// framebuffer.h.
+#define SURFACE_PIXEL(surface, x, y)    ((surface)->pixels + ((y) * (surface)->pitch) + \
+                                         ((x) * frameBufferFormat->bytes))
+
+// Function prototypes
+int surface_create(struct Surface *surface, unsigned int width, unsigned int height);
+void surface_destroy(struct Surface *surface);
+void surface_blit_to_framebuffer(struct Surface *surface, int x, int y, int width, int height,
+                                 int frameBufferX, int frameBufferY);
+void surface_blit_from_framebuffer(struct Surface *surface, int x, int y, int width,
+                                   int height, int frameBufferX, int frameBufferY);
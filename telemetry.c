@@ -0,0 +1,380 @@
+// The functions in this file send telemetry, such as frame times, controller
+// input and counters, over the UART in a compact binary form, so that many
+// more values fit through the 115200 Baud link than as text. Telemetry is
+// off until telemetry_init() is called, and the record functions then do
+// nothing, so they can be called every frame in any build.
+//
+// Records are collected into a packet, which is sent when it is full, when
+// it has been open for TELEMETRY_MAX_AGE microseconds, or when
+// telemetry_flush() is called. Before encoding, a packet is:
+//
+//     version         1 byte, TELEMETRY_VERSION
+//     sequence        1 byte, one more than the last packet's, wrapping
+//     time            varint, system timer in microseconds
+//     records         any number of:
+//                         type        1 byte, TELEMETRY_FRAME, INPUT or
+//                                     COUNTER
+//                         time        varint, microseconds since the last
+//                                     record, or since the packet time
+//                         fields      depending on the type, see below
+//     CRC             2 bytes, CRC-16/CCITT-FALSE of everything before it,
+//                     low byte first
+//
+// A varint is an unsigned number sent 7 bits at a time, lowest first, with
+// the top bit of each byte set if more follow. A signed delta is mapped to
+// an unsigned number first, with 0, -1, 1, -2, ... becoming 0, 1, 2, 3, ...
+// (zigzag encoding), so that small changes either way fit in one byte.
+//
+// The fields of each record type are:
+//
+//     TELEMETRY_FRAME     busy time (varint), and period less the last
+//                         frame's period in the packet (signed delta)
+//     TELEMETRY_INPUT     buttons (varint)
+//     TELEMETRY_COUNTER   counter number (1 byte), and value less the last
+//                         value sent in the packet (signed delta)
+//
+// Everything delta encoded starts again from zero in each packet, and the
+// counters and buttons are sent again in each packet, so a lost or damaged
+// packet only loses its own records. The receiver finds lost packets from
+// gaps in the sequence numbers.
+//
+// The packet is then COBS (Consistent Overhead Byte Stuffing) encoded,
+// which removes every zero byte at the cost of one byte per 254, and sent
+// as TELEMETRY_START, the encoded bytes and TELEMETRY_END. Text sent with
+// uart_puts() is 7-bit ASCII and has no zero bytes, so the receiver can
+// pick the packets out of the text around them.
+
+// Needed header files
+#include "uart.h"
+#include "systimer.h"
+#include "telemetry.h"
+
+// The largest packet before encoding, not counting the CRC. Sending one
+// takes about 9 milliseconds at 115200 Baud, so the game does not miss a
+// frame while the UART driver waits for the transmit FIFO.
+#define TELEMETRY_PACKET_BYTES  96
+
+// The most bytes one record takes: a type, a time delta and two fields,
+// each as long as a varint of 64 bits can be
+#define TELEMETRY_RECORD_BYTES  31
+
+// The longest a packet is kept open, in microseconds
+#define TELEMETRY_MAX_AGE       1000000
+
+// The most bytes sent for one packet: the start and end bytes, the COBS
+// overhead, the packet and the CRC
+#define TELEMETRY_WIRE_BYTES    (TELEMETRY_PACKET_BYTES + 2 + 3)
+
+// Telemetry global variables
+static int telemetryEnabled;
+static unsigned char telemetrySequence;
+
+// The packet being filled, and the number of bytes in it. It is empty when
+// no packet is open.
+static unsigned char packet[TELEMETRY_PACKET_BYTES + 2];
+static unsigned int packetLength;
+
+// What the deltas in the open packet are taken from
+static unsigned long packetTime;        // When the packet was opened
+static unsigned long lastTime;          // Time of the last record
+static unsigned int lastPeriod;         // Period of the last frame record
+static unsigned int lastButtons;        // Buttons of the last input record
+static int buttonsSent;                 // TRUE once buttons are in the packet
+static unsigned long lastCounter[TELEMETRY_COUNTERS];
+static unsigned int countersSent;       // Bit mask of counters in the packet
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       putVarint
+//
+//  Arguments:      value:           The number to add to the packet
+//
+//  Returns:        void
+//
+//  Description:    This function adds an unsigned number to the packet, 7
+//                  bits to a byte. Values below 128 take one byte.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void putVarint(unsigned long value)
+{
+    while (value >= 0x80) {
+        packet[packetLength++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    packet[packetLength++] = value;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       putDelta
+//
+//  Arguments:      delta:           The signed difference to add
+//
+//  Returns:        void
+//
+//  Description:    This function zigzag encodes a signed difference, so
+//                  that small values either side of zero are small unsigned
+//                  numbers, and adds it to the packet as a varint.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void putDelta(long delta)
+{
+    putVarint(((unsigned long)delta << 1) ^ (unsigned long)(delta >> 63));
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       crc16
+//
+//  Arguments:      data:            The bytes to check
+//                  length:          The number of bytes
+//
+//  Returns:        The CRC-16/CCITT-FALSE of the bytes
+//
+//  Description:    This function works out the CRC with the polynomial
+//                  0x1021 and a starting value of 0xFFFF, a bit at a time.
+//                  A packet is short, so a table would not pay for itself.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int crc16(const unsigned char *data, unsigned int length)
+{
+    unsigned int crc = 0xFFFF;
+    int bit;
+
+
+    while (length--) {
+        crc ^= (unsigned int)*data++ << 8;
+        for (bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+
+    return crc & 0xFFFF;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       beginRecord
+//
+//  Arguments:      type:            The record type
+//
+//  Returns:        void
+//
+//  Description:    This function adds the type and time of a new record to
+//                  the packet. The packet is sent first if the record might
+//                  not fit, or if it is too old, and a new one is opened if
+//                  none is open, which starts all the deltas again.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void beginRecord(unsigned int type)
+{
+    unsigned long now = get_timer_counter();
+
+
+    if (packetLength && (packetLength + TELEMETRY_RECORD_BYTES > TELEMETRY_PACKET_BYTES ||
+                         now - packetTime >= TELEMETRY_MAX_AGE)) {
+        telemetry_flush();
+    }
+
+    if (!packetLength) {
+        packet[packetLength++] = TELEMETRY_VERSION;
+        packet[packetLength++] = telemetrySequence;
+        putVarint(now);
+        packetTime = lastTime = now;
+        lastPeriod = 0;
+        buttonsSent = 0;
+        countersSent = 0;
+    }
+
+    packet[packetLength++] = type;
+    putVarint(now - lastTime);
+    lastTime = now;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       telemetry_init
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function turns telemetry on. The UART must already
+//                  have been initialized.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void telemetry_init()
+{
+    packetLength = 0;
+    telemetrySequence = 0;
+    telemetryEnabled = 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       telemetry_frame
+//
+//  Arguments:      busy:            Microseconds the frame took
+//                  period:          Microseconds from one frame to the next
+//
+//  Returns:        void
+//
+//  Description:    This function records the timing of a frame. The period
+//                  seldom changes, so it is sent as a delta and usually
+//                  takes one byte.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void telemetry_frame(unsigned int busy, unsigned int period)
+{
+    if (!telemetryEnabled) {
+        return;
+    }
+
+    beginRecord(TELEMETRY_FRAME);
+    putVarint(busy);
+    putDelta((long)period - (long)lastPeriod);
+    lastPeriod = period;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       telemetry_input
+//
+//  Arguments:      buttons:         The controller state, as returned by
+//                                   get_SNES()
+//
+//  Returns:        void
+//
+//  Description:    This function records the controller state when it has
+//                  changed, and once in each packet. It can be called every
+//                  frame.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void telemetry_input(unsigned short buttons)
+{
+    if (!telemetryEnabled || (packetLength && buttonsSent && buttons == lastButtons)) {
+        return;
+    }
+
+    beginRecord(TELEMETRY_INPUT);
+    putVarint(buttons);
+    lastButtons = buttons;
+    buttonsSent = 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       telemetry_counter
+//
+//  Arguments:      counter:         The counter number, below
+//                                   TELEMETRY_COUNTERS
+//                  value:           Its current value
+//
+//  Returns:        void
+//
+//  Description:    This function records the value of a counter when it has
+//                  changed, and once in each packet, as the difference from
+//                  the value last sent in the packet. It can be called
+//                  every frame.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void telemetry_counter(unsigned int counter, unsigned long value)
+{
+    if (!telemetryEnabled || counter >= TELEMETRY_COUNTERS ||
+        (packetLength && (countersSent & (1 << counter)) && value == lastCounter[counter])) {
+        return;
+    }
+
+    // The record may open a new packet, which starts the deltas again
+    beginRecord(TELEMETRY_COUNTER);
+    if (!(countersSent & (1 << counter))) {
+        lastCounter[counter] = 0;
+    }
+
+    packet[packetLength++] = counter;
+    putDelta((long)(value - lastCounter[counter]));
+    lastCounter[counter] = value;
+    countersSent |= 1 << counter;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       telemetry_flush
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function sends the open packet, if there is one.
+//                  The CRC is added, and the packet is COBS encoded: each
+//                  run of non-zero bytes is sent after a code byte giving
+//                  its length plus one, and the zero byte after the run is
+//                  left out. A code byte of 0xFF marks a run of 254 bytes
+//                  with no zero after it. The whole packet goes to the UART
+//                  with one call, so it is never split by text.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void telemetry_flush()
+{
+    unsigned char wire[TELEMETRY_WIRE_BYTES];
+    unsigned int crc, i, length, code;
+
+
+    if (!telemetryEnabled || !packetLength) {
+        return;
+    }
+
+    crc = crc16(packet, packetLength);
+    packet[packetLength++] = crc & 0xFF;
+    packet[packetLength++] = crc >> 8;
+
+    wire[0] = TELEMETRY_START;
+    code = 1;
+    length = 2;
+    for (i = 0; i < packetLength; i++) {
+        if (packet[i] == 0) {
+            wire[code] = length - code;
+            code = length++;
+        } else {
+            wire[length++] = packet[i];
+            if (length - code == 0xFF) {
+                wire[code] = 0xFF;
+                code = length++;
+            }
+        }
+    }
+    wire[code] = length - code;
+    wire[length++] = TELEMETRY_END;
+
+    uart_write_binary(wire, length);
+
+    packetLength = 0;
+    telemetrySequence++;
+}
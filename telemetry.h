@@ -0,0 +1,27 @@
+// Telemetry packets are sent over the UART between lines of text. Each
+// starts with TELEMETRY_START and ends with TELEMETRY_END, neither of which
+// is ever sent as text, and the bytes between them are COBS encoded so
+// that they never hold TELEMETRY_END. See telemetry.c for the packet
+// layout, and telemetry/telemetry.py for the decoder.
+#define TELEMETRY_START         0xFE
+#define TELEMETRY_END           0x00
+#define TELEMETRY_VERSION       1
+
+// Record types
+#define TELEMETRY_FRAME         1   // Busy and period time of a frame
+#define TELEMETRY_INPUT         2   // Controller buttons
+#define TELEMETRY_COUNTER       3   // A counter that changed
+
+// Counters. A counter is only sent when its value changes, and once at the
+// start of each packet.
+#define TELEMETRY_TEMPERATURE   0   // SoC temperature in millidegrees C
+#define TELEMETRY_ARM_RATE      1   // ARM clock rate in Hz
+#define TELEMETRY_THERMAL_LEVEL 2   // THERMAL_NORMAL, WARM or HOT
+#define TELEMETRY_COUNTERS      8
+
+// Function prototypes
+void telemetry_init();
+void telemetry_frame(unsigned int busy, unsigned int period);
+void telemetry_input(unsigned short buttons);
+void telemetry_counter(unsigned int counter, unsigned long value);
+void telemetry_flush();
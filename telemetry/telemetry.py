@@ -0,0 +1,200 @@
+#!/usr/bin/env python3
+#  This script decodes the telemetry packets sent by a kernel built with
+#  TELEMETRY defined (see telemetry.c), from a capture of its serial output
+#  or from a pipe. The packets are written to a CSV file, one row per
+#  value, and the text around them is passed through unchanged, so the
+#  usual console output can still be read.
+#
+#  The CSV columns are the kernel's timer in microseconds, the packet
+#  sequence number, the metric name and its value. The metrics are
+#  frame_busy_us, frame_period_us, buttons, and the counters named in
+#  COUNTERS below.
+#
+#  Usage: telemetry.py [options] [input]
+#
+#      input               The serial output to read (default: standard input)
+#      --csv FILE          Write the CSV to FILE (default: standard output,
+#                          with the text sent to standard error instead)
+#      --text FILE         Write the text to FILE instead
+#
+#  A summary of the packets decoded, damaged and lost is written to
+#  standard error at the end.
+
+import argparse
+import sys
+
+# These match telemetry.h
+START = 0xFE
+END = 0x00
+VERSION = 1
+FRAME = 1
+INPUT = 2
+COUNTER = 3
+COUNTERS = {0: "temperature_mC", 1: "arm_rate_hz", 2: "thermal_level"}
+
+# A packet longer than this, encoded, has lost its end byte
+MAX_ENCODED = 512
+
+
+class Packet:
+    """Reads the fields of a decoded packet in order."""
+
+    def __init__(self, data):
+        self.data = data
+        self.position = 0
+
+    def more(self):
+        return self.position < len(self.data)
+
+    def byte(self):
+        if self.position >= len(self.data):
+            raise ValueError("packet ends inside a record")
+        value = self.data[self.position]
+        self.position += 1
+        return value
+
+    def varint(self):
+        value = 0
+        shift = 0
+        while True:
+            byte = self.byte()
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if not byte & 0x80:
+                return value
+
+    def delta(self):
+        value = self.varint()
+        return (value >> 1) ^ -(value & 1)
+
+
+def crc16(data):
+    """Returns the CRC-16/CCITT-FALSE of the bytes, as the kernel works it out."""
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    """Returns the bytes a COBS encoded packet stands for, or None if it is damaged."""
+    output = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        output += data[i + 1:i + code]
+        i += code
+        if code != 0xFF and i < len(data):
+            output.append(0)
+    return bytes(output)
+
+
+def decode(payload):
+    """Returns the sequence number and the (time, metric, value) rows of a packet."""
+    if len(payload) < 5 or crc16(payload[:-2]) != payload[-2] | (payload[-1] << 8):
+        raise ValueError("bad CRC")
+
+    packet = Packet(payload[:-2])
+    if packet.byte() != VERSION:
+        raise ValueError("unknown version")
+    sequence = packet.byte()
+    time = packet.varint()
+
+    rows = []
+    period = 0
+    counters = {}
+    while packet.more():
+        kind = packet.byte()
+        time += packet.varint()
+        if kind == FRAME:
+            busy = packet.varint()
+            period += packet.delta()
+            rows.append((time, "frame_busy_us", busy))
+            rows.append((time, "frame_period_us", period))
+        elif kind == INPUT:
+            rows.append((time, "buttons", packet.varint()))
+        elif kind == COUNTER:
+            counter = packet.byte()
+            counters[counter] = counters.get(counter, 0) + packet.delta()
+            rows.append((time, COUNTERS.get(counter, "counter%d" % counter),
+                         counters[counter]))
+        else:
+            raise ValueError("unknown record type %d" % kind)
+
+    return sequence, rows
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode telemetry from the kernel's serial output")
+    parser.add_argument("input", nargs="?")
+    parser.add_argument("--csv")
+    parser.add_argument("--text")
+    args = parser.parse_args()
+
+    source = open(args.input, "rb") if args.input else sys.stdin.buffer
+    csv = open(args.csv, "w") if args.csv else sys.stdout
+    if args.text:
+        text = open(args.text, "wb")
+    else:
+        text = sys.stdout.buffer if args.csv else sys.stderr.buffer
+
+    csv.write("time_us,sequence,metric,value\n")
+
+    packets = damaged = lost = telemetry_bytes = values = 0
+    last_sequence = None
+    encoded = None
+
+    while True:
+        chunk = source.read1(4096) if hasattr(source, "read1") else source.read(4096)
+        if not chunk:
+            break
+
+        for byte in chunk:
+            if encoded is None:
+                if byte == START:
+                    encoded = bytearray()
+                else:
+                    text.write(bytes((byte,)))
+                continue
+
+            if byte != END:
+                encoded.append(byte)
+                if len(encoded) > MAX_ENCODED:
+                    damaged += 1
+                    encoded = None
+                continue
+
+            telemetry_bytes += len(encoded) + 2
+            payload = cobs_decode(encoded)
+            encoded = None
+            try:
+                if payload is None:
+                    raise ValueError("bad encoding")
+                sequence, rows = decode(payload)
+            except ValueError:
+                damaged += 1
+                continue
+
+            if last_sequence is not None:
+                lost += (sequence - last_sequence - 1) & 0xFF
+            last_sequence = sequence
+            packets += 1
+            values += len(rows)
+            for time, metric, value in rows:
+                csv.write("%d,%d,%s,%d\n" % (time, sequence, metric, value))
+
+        text.flush()
+        csv.flush()
+
+    sys.stderr.write("telemetry.py: %d packets, %d damaged, %d lost, %d values in %d bytes\n" %
+                     (packets, damaged, lost, values, telemetry_bytes))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,302 @@
+// The functions in this file draw text into the frame buffer using the 8 x 16
+// bitmap font in font.c. Rather than testing each bit of the font as a
+// character is drawn, the whole font is expanded once per color pair into
+// a glyph cache, which holds every glyph as ready-to-store pixel rows.
+// Drawing a character is then just 16 row copies into the frame buffer.
+
+// Needed header files
+#include "framebuffer.h"
+#include "pixelformat.h"
+#include "memops.h"
+#include "font.h"
+#include "text.h"
+
+// The number of foreground/background color pairs which can be cached at
+// once. Each slot holds the whole font, which is about 48 KB of pixels at
+// 32 bits per pixel.
+#define GLYPH_CACHE_SLOTS   4
+
+// The most bytes in one row of a glyph
+#define GLYPH_ROW_BYTES     (FONT_WIDTH * PIXEL_MAX_BYTES)
+
+// A glyph cache slot. Each row holds FONT_WIDTH pixels in the frame
+// buffer's pixel format. The pixels are quadword aligned so that each
+// row can be copied with doubleword loads and stores.
+struct GlyphCache {
+    unsigned int foreground;
+    unsigned int background;
+    unsigned int lastUsed;
+    int valid;
+    unsigned char __attribute__((aligned(16))) pixels[FONT_GLYPHS][FONT_HEIGHT][GLYPH_ROW_BYTES];
+};
+
+// Glyph cache global variables
+static struct GlyphCache glyphCache[GLYPH_CACHE_SLOTS];
+static unsigned int glyphCacheClock;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       getGlyphCache
+//
+//  Arguments:      foreground:      Color of the character pixels
+//                  background:      Color of the pixels around the character
+//
+//  Returns:        A pointer to the glyph cache slot for the color pair
+//
+//  Description:    This function finds the glyph cache slot holding the font
+//                  expanded in the given colors. If there is none, the least
+//                  recently used slot is replaced, and the font is expanded
+//                  into it. This is the only place where font bits are tested,
+//                  so it happens once per color pair, not once per character.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static struct GlyphCache *getGlyphCache(unsigned int foreground, unsigned int background)
+{
+    struct GlyphCache *cache, *victim = &glyphCache[0];
+    unsigned int foregroundPixel, backgroundPixel;
+    unsigned int bytes = frameBufferFormat->bytes;
+    int i, glyph, row, column;
+    unsigned char bits;
+
+
+    glyphCacheClock++;
+
+    // Look for a slot that already holds this color pair, remembering the
+    // least recently used slot in case we need to replace one
+    for (i = 0; i < GLYPH_CACHE_SLOTS; i++) {
+        cache = &glyphCache[i];
+
+        if (cache->valid && cache->foreground == foreground &&
+            cache->background == background) {
+            cache->lastUsed = glyphCacheClock;
+            return cache;
+        }
+
+        if (!cache->valid || (victim->valid && cache->lastUsed < victim->lastUsed)) {
+            victim = cache;
+        }
+    }
+
+    // Expand every glyph in the font into pixel rows of the two colors
+    foregroundPixel = frameBufferColor(foreground);
+    backgroundPixel = frameBufferColor(background);
+    for (glyph = 0; glyph < FONT_GLYPHS; glyph++) {
+        for (row = 0; row < FONT_HEIGHT; row++) {
+            bits = font[glyph][row];
+            for (column = 0; column < FONT_WIDTH; column++) {
+                frameBufferFormat->store(&victim->pixels[glyph][row][column * bytes],
+                    (bits & (0x80 >> column)) ? foregroundPixel : backgroundPixel);
+            }
+        }
+    }
+
+    victim->foreground = foreground;
+    victim->background = background;
+    victim->lastUsed = glyphCacheClock;
+    victim->valid = 1;
+
+    return victim;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       copyGlyph
+//
+//  Arguments:      cache:           Glyph cache slot to copy from
+//                  x:               Left pixel x coordinate
+//                  y:               Top pixel y coordinate
+//                  c:               The character to draw
+//
+//  Returns:        void
+//
+//  Description:    This function copies one cached glyph into the frame
+//                  buffer, row by row. When the destination is doubleword
+//                  aligned, each row is written with doubleword stores
+//                  (four at 32 bits per pixel, three at 24, two at 16 and
+//                  one at 8), otherwise with memcpy(). Characters that are
+//                  not printable are drawn as '?'.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void copyGlyph(struct GlyphCache *cache, int x, int y, char c)
+{
+    const unsigned char *source;
+    unsigned char *destination;
+    unsigned long *destination64;
+    const unsigned long *source64;
+    unsigned int rowBytes = FONT_WIDTH * frameBufferFormat->bytes;
+    int row, i;
+
+
+    if (c < FONT_FIRST || c > FONT_LAST) {
+        c = '?';
+    }
+
+    source = cache->pixels[c - FONT_FIRST][0];
+    destination = FRAMEBUFFER_PIXEL(x, y);
+
+    if (((unsigned long)destination & 7) == 0 && (frameBufferPitch & 7) == 0) {
+        source64 = (const unsigned long *)source;
+        destination64 = (unsigned long *)destination;
+
+        for (row = 0; row < FONT_HEIGHT; row++) {
+            for (i = 0; i < rowBytes / 8; i++) {
+                destination64[i] = source64[i];
+            }
+            source64 += GLYPH_ROW_BYTES / 8;
+            destination64 += frameBufferPitch / 8;
+        }
+    } else {
+        for (row = 0; row < FONT_HEIGHT; row++) {
+            memcpy(destination, source, rowBytes);
+            source += GLYPH_ROW_BYTES;
+            destination += frameBufferPitch;
+        }
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       draw_text
+//
+//  Arguments:      x:               Left pixel x coordinate
+//                  y:               Top pixel y coordinate
+//                  s:               The null terminated string to draw
+//                  foreground:      Color of the character pixels
+//                  background:      Color of the pixels around the characters
+//
+//  Returns:        The x coordinate just to the right of the drawn text, so
+//                  that further text can be drawn after it.
+//
+//  Description:    This function draws a string into the frame buffer, one
+//                  character cell after the other. Any character that does
+//                  not fit entirely in the virtual frame buffer is skipped.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int draw_text(int x, int y, char *s, unsigned int foreground, unsigned int background)
+{
+    struct GlyphCache *cache;
+
+
+    // The glyph cache slot is looked up once for the whole string
+    cache = getGlyphCache(foreground, background);
+
+    while (*s) {
+        if (x >= 0 && y >= 0 && (x + FONT_WIDTH) <= (int)frameBufferVirtualWidth &&
+            (y + FONT_HEIGHT) <= (int)frameBufferVirtualHeight) {
+            copyGlyph(cache, x, y, *s);
+        }
+
+        x += FONT_WIDTH;
+        s++;
+    }
+
+    return x;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       draw_decimal
+//
+//  Arguments:      x:               Left pixel x coordinate
+//                  y:               Top pixel y coordinate
+//                  value:           The integer value to draw
+//                  width:           Minimum number of characters to draw
+//                  foreground:      Color of the character pixels
+//                  background:      Color of the pixels around the characters
+//
+//  Returns:        The x coordinate just to the right of the drawn number
+//
+//  Description:    This function draws a signed integer in decimal. The
+//                  number is right-justified with spaces to at least the given
+//                  width, so a counter redrawn in place every frame always
+//                  covers its previous value.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int draw_decimal(int x, int y, int value, int width, unsigned int foreground,
+                 unsigned int background)
+{
+    char buffer[TEXT_NUMBER_MAX + 1];
+    char *p = &buffer[TEXT_NUMBER_MAX];
+    unsigned int magnitude;
+
+
+    // Convert the magnitude into digits, from the rightmost digit leftwards
+    magnitude = (value < 0) ? -(unsigned int)value : (unsigned int)value;
+    *p = '\0';
+    do {
+        *--p = '0' + (magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+
+    if (value < 0) {
+        *--p = '-';
+    }
+
+    // Pad on the left with spaces up to the requested width
+    if (width > TEXT_NUMBER_MAX) {
+        width = TEXT_NUMBER_MAX;
+    }
+    while ((&buffer[TEXT_NUMBER_MAX] - p) < width) {
+        *--p = ' ';
+    }
+
+    return draw_text(x, y, p, foreground, background);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       draw_hex
+//
+//  Arguments:      x:               Left pixel x coordinate
+//                  y:               Top pixel y coordinate
+//                  value:           The unsigned integer value to draw
+//                  digits:          Number of hexadecimal digits to draw (1-8)
+//                  foreground:      Color of the character pixels
+//                  background:      Color of the pixels around the characters
+//
+//  Returns:        The x coordinate just to the right of the drawn number
+//
+//  Description:    This function draws the low-order digits of an unsigned
+//                  integer in hexadecimal (without the 0x prefix), padded
+//                  with leading zeroes.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int draw_hex(int x, int y, unsigned int value, int digits, unsigned int foreground,
+             unsigned int background)
+{
+    char buffer[9];
+    unsigned int digit;
+    int i;
+
+
+    if (digits < 1) {
+        digits = 1;
+    } else if (digits > 8) {
+        digits = 8;
+    }
+
+    // Convert each 4-bit unit in turn, starting with the rightmost one
+    for (i = digits - 1; i >= 0; i--) {
+        digit = value & 0xF;
+        buffer[i] = (digit > 9) ? (digit + 0x37) : (digit + 0x30);
+        value >>= 4;
+    }
+    buffer[digits] = '\0';
+
+    return draw_text(x, y, buffer, foreground, background);
+}
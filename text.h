@@ -0,0 +1,10 @@
+// These are the function prototypes for drawing text into the frame buffer
+
+// The most characters draw_decimal() will produce for one number
+#define TEXT_NUMBER_MAX     12
+
+int draw_text(int x, int y, char *s, unsigned int foreground, unsigned int background);
+int draw_decimal(int x, int y, int value, int width, unsigned int foreground,
+                 unsigned int background);
+int draw_hex(int x, int y, unsigned int value, int digits, unsigned int foreground,
+             unsigned int background);
@@ -0,0 +1,239 @@
+// The functions in this file watch the SoC temperature through the video
+// core's property mailbox. When the die gets close to its limit the
+// firmware throttles the clocks, and a game loop running at full rate then
+// misses frames unevenly. The monitor instead lowers the frame rate in
+// steps as the temperature rises, and the game skips optional drawing, so
+// the loop keeps an even pace with less work to do.
+//
+// Reading the temperature takes a mailbox round trip, so it is only done
+// every THERMAL_SAMPLE_FRAMES frames.
+
+// Needed header files
+#include "uart.h"
+#include "kprintf.h"
+#include "mailbox.h"
+#include "thermal.h"
+
+// The temperature the firmware throttles at, the last reading, and the
+// current level
+static unsigned int limit;
+static unsigned int temperature;
+static int level;
+
+// Frames until the next reading
+static unsigned int sampleCountdown;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       temperatureQuery
+//
+//  Arguments:      tag:             TAG_GET_TEMPERATURE or
+//                                   TAG_GET_MAX_TEMPERATURE
+//
+//  Returns:        The temperature in thousandths of a degree Celsius, or 0
+//                  if the request failed
+//
+//  Description:    This function asks the video core for the SoC
+//                  temperature, or for its limit. The SoC has a single
+//                  sensor, with ID 0.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int temperatureQuery(unsigned int tag)
+{
+    mailbox_buffer[0] = 8 * 4;
+    mailbox_buffer[1] = MAILBOX_REQUEST;
+
+    mailbox_buffer[2] = tag;
+    mailbox_buffer[3] = 8;
+    mailbox_buffer[4] = 0;
+    mailbox_buffer[5] = 0;                      // Sensor ID
+    mailbox_buffer[6] = 0;                      // Temperature
+
+    mailbox_buffer[7] = TAG_LAST;
+
+    if (!mailbox_query(CHANNEL_PROPERTY_TAGS_ARMTOVC) ||
+        !(mailbox_buffer[4] & TAG_RESPONSE)) {
+        return 0;
+    }
+
+    return mailbox_buffer[6];
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       thermal_init
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function reads the temperature limit and the
+//                  current temperature, and sets the starting level. It
+//                  must be called once, after uart_init().
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void thermal_init()
+{
+    limit = temperatureQuery(TAG_GET_MAX_TEMPERATURE);
+    if (!limit) {
+        limit = THERMAL_DEFAULT_LIMIT;
+    }
+
+    kprintf("Thermal: limit %u millidegrees C\n", limit);
+
+    // Take the first reading now, which reports the level if it is not
+    // normal
+    level = THERMAL_NORMAL;
+    sampleCountdown = 0;
+    thermal_frame();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       levelFor
+//
+//  Arguments:      reading:         A temperature in thousandths of a degree
+//
+//  Returns:        The thermal level for the temperature
+//
+//  Description:    This function finds the level a temperature is in,
+//                  ignoring hysteresis.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static int levelFor(unsigned int reading)
+{
+    if (reading + THERMAL_HOT_MARGIN >= limit) {
+        return THERMAL_HOT;
+    }
+    if (reading + THERMAL_WARM_MARGIN >= limit) {
+        return THERMAL_WARM;
+    }
+
+    return THERMAL_NORMAL;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       thermal_frame
+//
+//  Arguments:      none
+//
+//  Returns:        The thermal level (THERMAL_NORMAL, THERMAL_WARM or
+//                  THERMAL_HOT)
+//
+//  Description:    This function is called once a frame. Every
+//                  THERMAL_SAMPLE_FRAMES frames it reads the temperature.
+//                  The level rises as soon as the temperature reaches a
+//                  higher level, and falls one level at a time once the
+//                  temperature is THERMAL_HYSTERESIS below the lower one.
+//                  Level changes are reported on the UART.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int thermal_frame()
+{
+    unsigned int reading;
+    int next;
+
+
+    if (sampleCountdown) {
+        sampleCountdown--;
+        return level;
+    }
+    sampleCountdown = THERMAL_SAMPLE_FRAMES - 1;
+
+    // Keep the last level if the temperature cannot be read
+    reading = temperatureQuery(TAG_GET_TEMPERATURE);
+    if (!reading) {
+        return level;
+    }
+    temperature = reading;
+
+    next = levelFor(temperature);
+    if (next < level) {
+        next = levelFor(temperature + THERMAL_HYSTERESIS);
+        if (next < level - 1) {
+            next = level - 1;
+        }
+    }
+
+    if (next != level) {
+        level = next;
+        kprintf("Thermal: %u millidegrees C, level %d\n", temperature, level);
+    }
+
+    return level;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       thermal_level
+//
+//  Arguments:      none
+//
+//  Returns:        The current thermal level
+//
+//  Description:    This function returns the level set by the last reading.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int thermal_level()
+{
+    return level;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       thermal_temperature
+//
+//  Arguments:      none
+//
+//  Returns:        The last temperature read, in thousandths of a degree
+//                  Celsius
+//
+//  Description:    This function returns the last reading without a
+//                  mailbox round trip.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int thermal_temperature()
+{
+    return temperature;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       thermal_frame_period
+//
+//  Arguments:      period:          The time between frames at the full
+//                                   frame rate, in microseconds
+//
+//  Returns:        The time between frames to use at the current level
+//
+//  Description:    This function stretches the frame period by half of the
+//                  full period for each level above normal, so a 30 Hz loop
+//                  runs at 20 Hz when warm and 15 Hz when hot.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int thermal_frame_period(unsigned int period)
+{
+    return (period * (level + 2)) / 2;
+}
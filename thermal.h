@@ -0,0 +1,25 @@
+// The thermal monitor reads the SoC temperature every THERMAL_SAMPLE_FRAMES
+// frames, and sets a level from how close it is to the firmware's limit.
+// Margins and the hysteresis are in thousandths of a degree Celsius, as
+// the firmware reports temperatures. A level is left only once the
+// temperature has dropped THERMAL_HYSTERESIS below where it was entered,
+// so a temperature near a threshold does not switch levels every sample.
+#define THERMAL_SAMPLE_FRAMES   30
+#define THERMAL_WARM_MARGIN     10000
+#define THERMAL_HOT_MARGIN      5000
+#define THERMAL_HYSTERESIS      3000
+
+// Where the limit is assumed to be if the firmware does not report it
+#define THERMAL_DEFAULT_LIMIT   85000
+
+// Thermal levels. Each level above normal lowers the frame rate.
+#define THERMAL_NORMAL          0
+#define THERMAL_WARM            1
+#define THERMAL_HOT             2
+
+// Function prototypes
+void thermal_init();
+int thermal_frame();
+int thermal_level();
+unsigned int thermal_temperature();
+unsigned int thermal_frame_period(unsigned int period);
@@ -0,0 +1,547 @@
+// The functions in this file implement a tile and sprite engine for the maze.
+//
+// Every kind of maze cell, and every sprite, is a 64 x 64 pixel image kept in
+// a tile atlas in RAM. The images are stored compactly below as 16 x 16 pixel
+// art, and are decoded once by tiles_init() into ready-to-store frame buffer
+// pixels in the frame buffer's pixel format, each art pixel becoming a 4 x 4
+// block. Drawing a tile is then only row copies from the atlas into the frame
+// buffer, whatever the format. The atlas is an off-screen surface in video
+// core memory, so it does not take space in the kernel image.
+//
+// At 8 bits per pixel, the accent color of each tile has a palette entry
+// of its own, so tiles_set_accent() can recolor every copy of a tile on the
+// screen, such as to flash the exit, without drawing anything.
+//
+// Sprites use a transparent key color. When the atlas is decoded, each
+// sprite row is reduced to the runs of opaque pixels in it, so drawing a
+// sprite is also just row copies, without testing pixels for the key.
+
+// Needed header files
+#include "uart.h"
+#include "framebuffer.h"
+#include "pixelformat.h"
+#include "surface.h"
+#include "memory.h"
+#include "tiles.h"
+#include "memops.h"
+
+// Size of the pixel art, and the scale factor from art pixels to tile pixels
+#define TILE_ART_SIZE       16
+#define TILE_ART_SCALE      (TILE_SIZE / TILE_ART_SIZE)
+
+// The most runs of opaque pixels in one sprite row
+#define TILE_MAX_RUNS       4
+
+// The first pixel of a tile in the atlas
+#define TILE_ATLAS(tile)    (tileAtlas + ((tile) * TILE_SIZE * TILE_SIZE * \
+                                          frameBufferFormat->bytes))
+
+// Colors used by the pixel art. The accent color is chosen per tile.
+#define TILE_BLACK          0x00000000
+#define TILE_DARK_GRAY      0x00404040
+#define TILE_LIGHT_GRAY     0x00E8E8E8
+#define TILE_WHITE          0x00FFFFFF
+#define TILE_OLIVE          0x00808000
+#define TILE_GREEN          0x00008000
+#define TILE_YELLOW         0x00FFFF00
+#define TILE_RED            0x00FF0000
+#define TILE_LIME           0x0000FF00
+
+// Pixel art for each tile, one character per pixel:
+//     '.' transparent     'K' black          'D' dark gray
+//     'L' light gray      'W' white          'O' olive
+//     'X' the accent color of the tile
+static const char *const floorArt[TILE_ART_SIZE] = {
+    "WWWWWWWWWWWWWWWL",
+    "WWWWWWWWWWWWWWWL",
+    "WWWWWWWWWWWWWWWL",
+    "WWWWWWWWWWWWWWWL",
+    "WWWWWWWWWWWWWWWL",
+    "WWWWWWWWWWWWWWWL",
+    "WWWWWWWWWWWWWWWL",
+    "WWWWWWWWWWWWWWWL",
+    "WWWWWWWWWWWWWWWL",
+    "WWWWWWWWWWWWWWWL",
+    "WWWWWWWWWWWWWWWL",
+    "WWWWWWWWWWWWWWWL",
+    "WWWWWWWWWWWWWWWL",
+    "WWWWWWWWWWWWWWWL",
+    "WWWWWWWWWWWWWWWL",
+    "LLLLLLLLLLLLLLLL"
+};
+
+static const char *const wallArt[TILE_ART_SIZE] = {
+    "KKKKKKKKKKKKKKKK",
+    "DDDDDDDKDDDDDDDK",
+    "DDDDDDDKDDDDDDDK",
+    "DDDDDDDKDDDDDDDK",
+    "KKKKKKKKKKKKKKKK",
+    "DDDKDDDDDDDKDDDD",
+    "DDDKDDDDDDDKDDDD",
+    "DDDKDDDDDDDKDDDD",
+    "KKKKKKKKKKKKKKKK",
+    "DDDDDDDKDDDDDDDK",
+    "DDDDDDDKDDDDDDDK",
+    "DDDDDDDKDDDDDDDK",
+    "KKKKKKKKKKKKKKKK",
+    "DDDKDDDDDDDKDDDD",
+    "DDDKDDDDDDDKDDDD",
+    "DDDKDDDDDDDKDDDD"
+};
+
+static const char *const entranceArt[TILE_ART_SIZE] = {
+    "WWWWWWWWWWWWWWWL",
+    "WWWWWWWWWWWWWWWL",
+    "WWWWWWWWWWWWWWWL",
+    "WWWWWWWWXWWWWWWL",
+    "WWWWWWWWXXWWWWWL",
+    "WWWWWWWWXXXWWWWL",
+    "WWXXXXXXXXXXWWWL",
+    "WWXXXXXXXXXXXWWL",
+    "WWXXXXXXXXXXXWWL",
+    "WWXXXXXXXXXXWWWL",
+    "WWWWWWWWXXXWWWWL",
+    "WWWWWWWWXXWWWWWL",
+    "WWWWWWWWXWWWWWWL",
+    "WWWWWWWWWWWWWWWL",
+    "WWWWWWWWWWWWWWWL",
+    "LLLLLLLLLLLLLLLL"
+};
+
+static const char *const exitArt[TILE_ART_SIZE] = {
+    "WWWWWWWWWWWWWWWL",
+    "WWWOOOOOOOOOOWWL",
+    "WWWOXXXXXXXXOWWL",
+    "WWWOXXXXXXXXOWWL",
+    "WWWOXXXXXXXXOWWL",
+    "WWWOXXXXXXXXOWWL",
+    "WWWOXXXXXXXXOWWL",
+    "WWWOXXXXXXXXOWWL",
+    "WWWOXXXXXXOXOWWL",
+    "WWWOXXXXXXXXOWWL",
+    "WWWOXXXXXXXXOWWL",
+    "WWWOXXXXXXXXOWWL",
+    "WWWOXXXXXXXXOWWL",
+    "WWWOXXXXXXXXOWWL",
+    "WWWOOOOOOOOOOWWL",
+    "LLLLLLLLLLLLLLLL"
+};
+
+static const char *const characterArt[TILE_ART_SIZE] = {
+    "................",
+    "................",
+    ".....KKKKKK.....",
+    "....KXXXXXXK....",
+    "...KXXXXXXXXK...",
+    "..KXXWWXXWWXXK..",
+    "..KXXWKXXWKXXK..",
+    "..KXXXXXXXXXXK..",
+    "..KXXXXXXXXXXK..",
+    "..KXXKXXXXKXXK..",
+    "..KXXXKKKKXXXK..",
+    "...KXXXXXXXXK...",
+    "....KXXXXXXK....",
+    ".....KKKKKK.....",
+    "................",
+    "................"
+};
+
+// The pixel art and accent color for each tile, in tile number order
+struct TileArt {
+    const char *const *rows;
+    unsigned int accent;
+};
+
+static const struct TileArt tileArt[TILE_COUNT] = {
+    { floorArt,     0 },            // TILE_FLOOR
+    { wallArt,      0 },            // TILE_WALL
+    { entranceArt,  TILE_GREEN },   // TILE_ENTRANCE
+    { exitArt,      TILE_YELLOW },  // TILE_EXIT
+    { characterArt, TILE_RED },     // SPRITE_CHARACTER
+    { characterArt, TILE_LIME }     // SPRITE_CHARACTER_WIN
+};
+
+// The runs of opaque pixels in one sprite row
+struct SpriteRow {
+    unsigned char count;
+    unsigned char start[TILE_MAX_RUNS];
+    unsigned char length[TILE_MAX_RUNS];
+};
+
+// Tile atlas global variables. The atlas is a surface TILE_SIZE pixels
+// wide with the tiles one below another, so each tile is TILE_SIZE rows
+// of TILE_SIZE pixels in the frame buffer's pixel format.
+static struct Surface atlasSurface;
+static unsigned char *tileAtlas;
+static struct SpriteRow spriteRows[TILE_COUNT][TILE_SIZE];
+
+// The pixel value of each tile's accent color
+static unsigned int accentPixels[TILE_COUNT];
+
+// A tile decoded into 32-bit RGB pixels, for tilePixels()
+static unsigned int __attribute__((aligned(16))) tileImage[TILE_SIZE * TILE_SIZE];
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       artColor
+//
+//  Arguments:      c:               A pixel art character
+//                  accent:          The accent color of the tile
+//
+//  Returns:        The 32-bit pixel value for the character
+//
+//  Description:    This function converts one pixel art character into the
+//                  pixel value stored in the tile atlas.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int artColor(char c, unsigned int accent)
+{
+    switch (c) {
+    case 'K':
+        return TILE_BLACK;
+    case 'D':
+        return TILE_DARK_GRAY;
+    case 'L':
+        return TILE_LIGHT_GRAY;
+    case 'W':
+        return TILE_WHITE;
+    case 'O':
+        return TILE_OLIVE;
+    case 'X':
+        return accent;
+    default:
+        return TILE_TRANSPARENT;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       copyPixels
+//
+//  Arguments:      destination:     Where to copy the pixels to
+//                  source:          Where to copy the pixels from
+//                  count:           The number of pixels to copy
+//
+//  Returns:        void
+//
+//  Description:    This function copies a row of pixels with memcpy(),
+//                  which moves 64 bytes per loop when the source and
+//                  destination are both doubleword aligned.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void copyPixels(unsigned char *destination, const unsigned char *source, int count)
+{
+    memcpy(destination, source, count * frameBufferFormat->bytes);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       tiles_init
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function decodes the pixel art of every tile into the
+//                  tile atlas, and finds the runs of opaque pixels in each
+//                  row for drawing the tiles as sprites. It must be called
+//                  once before any tiles are drawn, after the frame buffer
+//                  and the memory arena have been initialized. The atlas
+//                  is allocated the first time, in video core memory, or
+//                  from the memory arena if the firmware cannot give any.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void tiles_init()
+{
+    const struct TileArt *art;
+    struct SpriteRow *spriteRow;
+    unsigned char *pixel;
+    unsigned int bytes = frameBufferFormat->bytes;
+    char c;
+    int tile, x, y, opaque;
+
+
+    if (!tileAtlas) {
+        if (surface_create(&atlasSurface, TILE_SIZE, TILE_SIZE * TILE_COUNT)) {
+            tileAtlas = atlasSurface.pixels;
+        } else {
+            tileAtlas = memory_alloc(TILE_COUNT * TILE_SIZE * TILE_SIZE * TILE_MAX_PIXEL_BYTES);
+        }
+        if (!tileAtlas) {
+            uart_puts("Not enough memory for the tiles\n");
+            while (1);
+        }
+    }
+
+    for (tile = 0; tile < TILE_COUNT; tile++) {
+        art = &tileArt[tile];
+        pixel = TILE_ATLAS(tile);
+        if (art->accent) {
+            accentPixels[tile] = reserveFrameBufferColor(art->accent);
+        }
+
+        // Expand each art pixel into a block of tile pixels, converting
+        // each color once
+        for (y = 0; y < TILE_SIZE; y++) {
+            for (x = 0; x < TILE_SIZE; x++) {
+                c = art->rows[y / TILE_ART_SCALE][x / TILE_ART_SCALE];
+                frameBufferFormat->store(pixel, (c == 'X') ? accentPixels[tile] :
+                                         frameBufferColor(artColor(c, art->accent)));
+                pixel += bytes;
+            }
+        }
+
+        // Record where the opaque runs start and end in each row
+        for (y = 0; y < TILE_SIZE; y++) {
+            spriteRow = &spriteRows[tile][y];
+            spriteRow->count = 0;
+            opaque = 0;
+
+            for (x = 0; x <= TILE_SIZE; x++) {
+                if (x < TILE_SIZE &&
+                    art->rows[y / TILE_ART_SCALE][x / TILE_ART_SCALE] != '.') {
+                    if (!opaque && spriteRow->count < TILE_MAX_RUNS) {
+                        spriteRow->start[spriteRow->count] = x;
+                        opaque = 1;
+                    }
+                } else if (opaque) {
+                    spriteRow->length[spriteRow->count] = x - spriteRow->start[spriteRow->count];
+                    spriteRow->count++;
+                    opaque = 0;
+                }
+            }
+        }
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       drawTile
+//
+//  Arguments:      x:               Left pixel x coordinate
+//                  y:               Top pixel y coordinate
+//                  tile:            The tile number to draw
+//
+//  Returns:        void
+//
+//  Description:    This function draws a single tile from the atlas into the
+//                  frame buffer, ignoring transparency.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void drawTile(int x, int y, int tile)
+{
+    unsigned char *destination = FRAMEBUFFER_PIXEL(x, y);
+    const unsigned char *source = TILE_ATLAS(tile);
+    unsigned int rowBytes = TILE_SIZE * frameBufferFormat->bytes;
+    int row;
+
+
+    for (row = 0; row < TILE_SIZE; row++) {
+        copyPixels(destination, source, TILE_SIZE);
+        destination += frameBufferPitch;
+        source += rowBytes;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       drawTileRow
+//
+//  Arguments:      x:               Left pixel x coordinate of the first tile
+//                  y:               Top pixel y coordinate of the tiles
+//                  tiles:           The tile numbers to draw, left to right
+//                  count:           The number of tiles
+//
+//  Returns:        void
+//
+//  Description:    This function draws a horizontal row of tiles. It works
+//                  one pixel row at a time across all of the tiles, so the
+//                  frame buffer is written in order, one full screen row
+//                  after another.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void drawTileRow(int x, int y, const unsigned char *tiles, int count)
+{
+    unsigned char *destination = FRAMEBUFFER_PIXEL(x, y);
+    unsigned int rowBytes = TILE_SIZE * frameBufferFormat->bytes;
+    int row, i;
+
+
+    for (row = 0; row < TILE_SIZE; row++) {
+        for (i = 0; i < count; i++) {
+            copyPixels(destination + (i * rowBytes),
+                       TILE_ATLAS(tiles[i]) + (row * rowBytes), TILE_SIZE);
+        }
+        destination += frameBufferPitch;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       drawSprite
+//
+//  Arguments:      save:            Where to save the background
+//                  x:               Left pixel x coordinate
+//                  y:               Top pixel y coordinate
+//                  sprite:          The tile number to draw as a sprite
+//
+//  Returns:        void
+//
+//  Description:    This function saves the frame buffer pixels under the
+//                  sprite, and then draws the opaque runs of the sprite over
+//                  them. If the save area still holds a background from an
+//                  earlier sprite draw, that background is restored first.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void drawSprite(struct SpriteSave *save, int x, int y, int sprite)
+{
+    unsigned char *destination;
+    const unsigned char *source = TILE_ATLAS(sprite);
+    const struct SpriteRow *spriteRow = spriteRows[sprite];
+    unsigned int bytes = frameBufferFormat->bytes;
+    unsigned int rowBytes = TILE_SIZE * bytes;
+    int row, run;
+
+
+    if (save->valid) {
+        restoreSprite(save);
+    }
+
+    // Save the background under the sprite
+    destination = FRAMEBUFFER_PIXEL(x, y);
+    for (row = 0; row < TILE_SIZE; row++) {
+        copyPixels(&save->pixels[row * rowBytes], destination, TILE_SIZE);
+        destination += frameBufferPitch;
+    }
+
+    save->x = x;
+    save->y = y;
+    save->valid = 1;
+
+    // Draw the opaque runs of each sprite row
+    destination = FRAMEBUFFER_PIXEL(x, y);
+    for (row = 0; row < TILE_SIZE; row++) {
+        for (run = 0; run < spriteRow->count; run++) {
+            copyPixels(destination + (spriteRow->start[run] * bytes),
+                       source + (spriteRow->start[run] * bytes), spriteRow->length[run]);
+        }
+        destination += frameBufferPitch;
+        source += rowBytes;
+        spriteRow++;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       restoreSprite
+//
+//  Arguments:      save:            The background saved by drawSprite()
+//
+//  Returns:        void
+//
+//  Description:    This function erases a sprite by copying the saved
+//                  background back into the frame buffer.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void restoreSprite(struct SpriteSave *save)
+{
+    unsigned char *destination;
+    unsigned int rowBytes = TILE_SIZE * frameBufferFormat->bytes;
+    int row;
+
+
+    if (!save->valid) {
+        return;
+    }
+
+    destination = FRAMEBUFFER_PIXEL(save->x, save->y);
+    for (row = 0; row < TILE_SIZE; row++) {
+        copyPixels(destination, &save->pixels[row * rowBytes], TILE_SIZE);
+        destination += frameBufferPitch;
+    }
+
+    save->valid = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       tilePixels
+//
+//  Arguments:      tile:            A tile number
+//
+//  Returns:        A pointer to the tile as 32-bit RGB pixels, TILE_SIZE x
+//                  TILE_SIZE pixels stored row by row, with transparent
+//                  pixels set to TILE_TRANSPARENT
+//
+//  Description:    This function gives access to a decoded tile image, for
+//                  example to upload it as the hardware cursor. The atlas
+//                  holds pixels in the frame buffer's format, so the tile
+//                  is decoded again into a buffer that the next call reuses.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+const unsigned int *tilePixels(int tile)
+{
+    const struct TileArt *art = &tileArt[tile];
+    unsigned int *pixel = tileImage;
+    int x, y;
+
+
+    for (y = 0; y < TILE_SIZE; y++) {
+        for (x = 0; x < TILE_SIZE; x++) {
+            *pixel++ = artColor(art->rows[y / TILE_ART_SCALE][x / TILE_ART_SCALE],
+                                art->accent);
+        }
+    }
+
+    return tileImage;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       tiles_set_accent
+//
+//  Arguments:      tile:            A tile number
+//                  color:           The new RGB accent color
+//
+//  Returns:        TRUE (non-zero) if every copy of the tile on the screen
+//                  now has the new accent, FALSE (zero) if the color cannot
+//                  be changed
+//
+//  Description:    This function recolors the accent of a tile with a single
+//                  palette update. It only works at 8 bits per pixel, since
+//                  at other depths the tile would have to be drawn again. The
+//                  atlas is not changed, so tilePixels() still gives the
+//                  original colors.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int tiles_set_accent(int tile, unsigned int color)
+{
+    return setFrameBufferPaletteColor(accentPixels[tile], color);
+}
@@ -0,0 +1,37 @@
+// Tile size in pixels per side
+#define TILE_SIZE           64
+
+// Tile numbers. The maze cell tiles use the same numbers as the cell
+// values in the maze, so a cell value can be drawn directly as a tile.
+#define TILE_FLOOR              0
+#define TILE_WALL               1
+#define TILE_ENTRANCE           2
+#define TILE_EXIT               3
+#define SPRITE_CHARACTER        4
+#define SPRITE_CHARACTER_WIN    5
+#define TILE_COUNT              6
+
+// The most bytes a tile pixel takes in any frame buffer pixel format
+#define TILE_MAX_PIXEL_BYTES    4
+
+// Sprite pixels of this color are transparent (this is FUCHSIA)
+#define TILE_TRANSPARENT    0x00FF00FF
+
+// The background saved from under a sprite, so that it can be restored.
+// It must start zeroed (or with valid set to 0) before its first use.
+struct SpriteSave {
+    int x;
+    int y;
+    int valid;
+    unsigned char __attribute__((aligned(16))) pixels[TILE_SIZE * TILE_SIZE *
+                                                      TILE_MAX_PIXEL_BYTES];
+};
+
+// Function prototypes
+void tiles_init();
+void drawTile(int x, int y, int tile);
+void drawTileRow(int x, int y, const unsigned char *tiles, int count);
+void drawSprite(struct SpriteSave *save, int x, int y, int sprite);
+void restoreSprite(struct SpriteSave *save);
+const unsigned int *tilePixels(int tile);
+int tiles_set_accent(int tile, unsigned int color);
@@ -2,11 +2,22 @@
 // which allows communication between a host and the Raspberry Pi using a UART
 // serial connection. Once uart_init() has been called, the Pi can transmit
 // and receive characters over the UART connection using the functions
-// uart_putc(), uart_puts(), uart_getc(), uart_puthex().
+// uart_putc(), uart_puts(), uart_write(), uart_write_binary(), uart_getc()
+// and uart_puthex().
+//
+// The console normally uses the Mini UART (UART1). When the kernel is built
+// with CONSOLE_PL011 defined ('make CONSOLE_UART=pl011'), it uses the PL011
+// UART (UART0) instead, through the driver in pl011.c, at PL011_BAUD_RATE.
+// Only the macros below and uart_init() differ between the two. If the
+// PL011 cannot run at that rate, uart_init() falls back to the Mini UART,
+// and the macros then check which UART is in use.
 
 // This file is needed since it defines the memory mapped I/O base address.
 // Note that MMIO_BASE = 0x3F000000 is the ARM physical address.
+#include "mmio.h"
 #include "gpio.h"
+#include "pl011.h"
+#include "uart.h"
 
 // The addresses of the Auxilary Mini UART registers.
 //
@@ -15,25 +26,73 @@
 // which have the address range 0x3F000000 to 0x3FFFFFFF. These addresses are
 // mapped by the VideoCore Memory Management Unit (MMU) onto the bus addresses
 // in the range 0x7E000000 to 0x7EFFFFFF.
-#define AUX_IRQ         ((volatile unsigned int *)(MMIO_BASE + 0x00215000))
-#define AUX_ENABLE      ((volatile unsigned int *)(MMIO_BASE + 0x00215004))
-#define AUX_MU_IO       ((volatile unsigned int *)(MMIO_BASE + 0x00215040))
-#define AUX_MU_IER      ((volatile unsigned int *)(MMIO_BASE + 0x00215044))
-#define AUX_MU_IIR      ((volatile unsigned int *)(MMIO_BASE + 0x00215048))
-#define AUX_MU_LCR      ((volatile unsigned int *)(MMIO_BASE + 0x0021504C))
-#define AUX_MU_MCR      ((volatile unsigned int *)(MMIO_BASE + 0x00215050))
-#define AUX_MU_LSR      ((volatile unsigned int *)(MMIO_BASE + 0x00215054))
-#define AUX_MU_MSR      ((volatile unsigned int *)(MMIO_BASE + 0x00215058))
-#define AUX_MU_SCRATCH  ((volatile unsigned int *)(MMIO_BASE + 0x0021505C))
-#define AUX_MU_CNTL     ((volatile unsigned int *)(MMIO_BASE + 0x00215060))
-#define AUX_MU_STAT     ((volatile unsigned int *)(MMIO_BASE + 0x00215064))
-#define AUX_MU_BAUD     ((volatile unsigned int *)(MMIO_BASE + 0x00215068))
+#define AUX_IRQ         (MMIO_BASE + 0x00215000)
+#define AUX_ENABLE      (MMIO_BASE + 0x00215004)
+#define AUX_MU_IO       (MMIO_BASE + 0x00215040)
+#define AUX_MU_IER      (MMIO_BASE + 0x00215044)
+#define AUX_MU_IIR      (MMIO_BASE + 0x00215048)
+#define AUX_MU_LCR      (MMIO_BASE + 0x0021504C)
+#define AUX_MU_MCR      (MMIO_BASE + 0x00215050)
+#define AUX_MU_LSR      (MMIO_BASE + 0x00215054)
+#define AUX_MU_MSR      (MMIO_BASE + 0x00215058)
+#define AUX_MU_SCRATCH  (MMIO_BASE + 0x0021505C)
+#define AUX_MU_CNTL     (MMIO_BASE + 0x00215060)
+#define AUX_MU_STAT     (MMIO_BASE + 0x00215064)
+#define AUX_MU_BAUD     (MMIO_BASE + 0x00215068)
+
+// The Mini UART's Baud rate, which is divided from the system (core) clock
+#define UART_BAUD_RATE  115200
+
+// The PL011's Baud rate, which is divided from its own clock. The Makefile
+// sets it from PL011_BAUD_RATE.
+#ifndef PL011_BAUD_RATE
+#define PL011_BAUD_RATE 921600
+#endif
+
+// The depth of the transmit FIFO, and the field of the Mini UART Extra
+// Status Register (bits 27:24) giving how many characters it holds
+#define UART_TRANSMIT_FIFO_SIZE         8
+#define AUX_MU_STAT_TRANSMIT_LEVEL(r)   (((r) >> 24) & 0xF)
+
+// The Mini UART's status and data
+#define miniTransmitSpace()     (UART_TRANSMIT_FIFO_SIZE - \
+                                 AUX_MU_STAT_TRANSMIT_LEVEL(mmio_read(AUX_MU_STAT)))
+#define miniTransmit(c)         mmio_write(AUX_MU_IO, (c))
+#define miniReceiveReady()      ((mmio_read(AUX_MU_LSR) & 0x1) != 0)    // Data Ready
+#define miniReceive()           mmio_read(AUX_MU_IO)
+#define miniTransmitIdle()      ((mmio_read(AUX_MU_LSR) & 0x40) != 0)   // Transmitter Idle
+
+// The console UART's status and data. transmitSpace() gives how many
+// characters can be written without waiting. receiveReady() is true when a
+// character has arrived, and transmitIdle() once everything has been sent.
+#ifdef CONSOLE_PL011
+#define transmitSpace()         (consolePl011 ? pl011_transmit_space() : miniTransmitSpace())
+#define transmitCharacter(c)    (consolePl011 ? pl011_send(c) : miniTransmit(c))
+#define receiveReady()          (consolePl011 ? pl011_received() : miniReceiveReady())
+#define receiveCharacter()      (consolePl011 ? pl011_receive() : miniReceive())
+#define transmitIdle()          (consolePl011 ? pl011_idle() : miniTransmitIdle())
+
+// TRUE (non-zero) once pl011_init() has set up the PL011, FALSE (zero) if
+// the console has fallen back to the Mini UART
+static int consolePl011;
+#else
+#define transmitSpace()         miniTransmitSpace()
+#define transmitCharacter(c)    miniTransmit(c)
+#define receiveReady()          miniReceiveReady()
+#define receiveCharacter()      miniReceive()
+#define transmitIdle()          miniTransmitIdle()
+#endif
+
+// An optional function which is also given every string written with
+// uart_puts(), such as the frame buffer console. It is set with
+// uart_set_mirror(), and is 0 when there is no mirror.
+static void (*uart_mirror)(char *s);
 
 
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-//  Function:       uart_init
+//  Function:       miniUartInit
 //
 //  Arguments:      none
 //
@@ -47,7 +106,7 @@
 //
 ////////////////////////////////////////////////////////////////////////////////
 
-void uart_init()
+static void miniUartInit()
 {
     register unsigned int r;
     
@@ -56,7 +115,7 @@ void uart_init()
     // be set up before initializing the Mini UART.
 
     // Get the current contents of the GPIO Function Select Register 1
-    r = *GPFSEL1;
+    r = mmio_read(GPFSEL1);
 
     // Clear bits 12-14 and 15-17. These are the fields FSEL14 and FSEL15,
     // which map to GPIO pins 14 and 15. We clear the bits by ANDing with a 
@@ -72,7 +131,7 @@ void uart_init()
 
     // Write the modified bit pattern back to the
     // GPIO Function Select Register 1
-    *GPFSEL1 = r;
+    mmio_write(GPFSEL1, r);
 
     // Disable the pull-up/pull-down control line for GPIO
     // pins 14 and 15. We follow the procedure outlined on 
@@ -80,7 +139,7 @@ void uart_init()
 
     // Disable pull-up/pull-down by setting bits 0:1
     // to 00 in the GPIO Pull-Up/Down Register 
-    *GPPUD = 0x0;
+    mmio_write(GPPUD, 0x0);
 
     // Wait 150 cycles to provide the required set-up time 
     // for the control signal
@@ -93,7 +152,7 @@ void uart_init()
     // using a 1 on bits 14 and 15 to clock in the control
     // signal for GPIO pins 14 and 15. Note that all other
     // pins will retain their previous state.
-    *GPPUDCLK0 = (0x1 << 14) | (0x1 << 15);
+    mmio_write(GPPUDCLK0, (0x1 << 14) | (0x1 << 15));
 
     // Wait 150 cycles to provide the required hold time
     // for the control signal
@@ -104,45 +163,80 @@ void uart_init()
 
     // Clear all bits in the GPIO Pull-Up/Down Clock Register 0
     // in order to remove the clock
-    *GPPUDCLK0 = 0;
+    mmio_write(GPPUDCLK0, 0);
     
     
     // Initialize the Mini UART peripheral
     
     // Enable the Mini UART by setting bit 0 in the
     // Auxiliary Enable register to a 1 value
-    *AUX_ENABLE |= 0x1;
+    mmio_write(AUX_ENABLE, mmio_read(AUX_ENABLE) | 0x1);
     
     // Disable all Mini UART interrupts by setting all fields
     // in the Mini UART Interrupt Enable Register to zero
-    *AUX_MU_IER = 0;
+    mmio_write(AUX_MU_IER, 0);
     
     // Turn off flow control features by setting all fields
     // in the Mini UART Control Register to zero
-    *AUX_MU_CNTL = 0;
+    mmio_write(AUX_MU_CNTL, 0);
     
     // Set the UART to work in 8-bit mode by setting bits 1:0
     // in the Mini UART Line Control Register to 11
-    *AUX_MU_LCR = 0x3;
+    mmio_write(AUX_MU_LCR, 0x3);
     
     // Set the RTS line to high by setting bit 1 (and all other fields)
     // in the Mini UART Modem Control Register to zero
-    *AUX_MU_MCR = 0;
+    mmio_write(AUX_MU_MCR, 0);
     
     // Enable both the receive and transmit FIFO buffers and clear their
     // contents by setting bits 7:6 and 2:1 in the Mini UART Interrupt
     // Status Register to 1 values (bit mask is:  1100 0110)
-    *AUX_MU_IIR = 0xc6;
+    mmio_write(AUX_MU_IIR, 0xc6);
     
     // Set the Baud rate to 115200. We do this by putting the value 270
     // into bits 15:0 of the Mini UART Baud Register. This value is calculated
     // with the formula:  rint((systemClockRate / (8 * 115200)) - 1)
     // where the systemClockRate is 250 MHz.
-    *AUX_MU_BAUD = 270;
+    mmio_write(AUX_MU_BAUD, 270);
 
     // Enable the Mini UART's transmitter and receiver by setting bits 1:0
     // in the Mini UART Control Register to the bit pattern 11
-    *AUX_MU_CNTL = 0x3;
+    mmio_write(AUX_MU_CNTL, 0x3);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       uart_init
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function initializes the console UART, which is the
+//                  Mini UART at 115200 Baud unless the console is on the
+//                  PL011. The PL011 is initialized with pl011_init(), which
+//                  maps it to the same pins. If its clock cannot be made
+//                  fast enough for PL011_BAUD_RATE, the Mini UART is used
+//                  instead, so the console still works.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void uart_init()
+{
+#ifdef CONSOLE_PL011
+    consolePl011 = pl011_init(PL011_BAUD_RATE) != 0;
+    if (consolePl011) {
+        return;
+    }
+#endif
+
+    miniUartInit();
+
+#ifdef CONSOLE_PL011
+    uart_puts("The PL011 cannot run at the console Baud rate, using the Mini UART\n");
+#endif
 }
 
 
@@ -155,7 +249,7 @@ void uart_init()
 //
 //  Returns:        void
 //
-//  Description:    This function polls the UART1 peripheral, waiting until
+//  Description:    This function polls the UART peripheral, waiting until
 //                  it is able to accept a new character into its buffer. 
 //                  The character c is then sent to the console terminal
 //                  over the TXD line.
@@ -165,15 +259,14 @@ void uart_init()
 void uart_putc(unsigned int c)
 {
     // Loop until the transmit FIFO buffer is able to accept a character for
-    // transmission. This will be true when the Transmitter Empty bit
-    // (bit 5) in the Mini UART Line Status Register is a 1 value.
-    do {
+    // transmission
+    while (!transmitSpace()) {
     	// Use the NOP assembly language instruction in the loop body
       	asm volatile("nop");
-    } while ( !(*AUX_MU_LSR & 0x20) );
+    }
     
-    // Write the character to the mini UART I/O register
-    *AUX_MU_IO = c;
+    // Write the character to the UART data register
+    transmitCharacter(c);
 }
 
 
@@ -186,7 +279,7 @@ void uart_putc(unsigned int c)
 //
 //  Returns:        The character last received from the terminal
 //
-//  Description:    This function polls the UART1 peripheral, waiting for
+//  Description:    This function polls the UART peripheral, waiting for
 //                  a single character to be received from the console
 //                  terminal over the RXD line. If the character is a
 //                  carriage return, it is converted to a newline character.
@@ -197,16 +290,14 @@ char uart_getc()
 {
     char r;
     
-    // Loop until an input character is available in the receive FIFO buffer.
-    // At least one character is available when the Data Ready bit (bit 0)
-    // in the Mini UART Line Status Register is a 1 value.
-    do {
+    // Loop until an input character is available in the receive FIFO buffer
+    while (!receiveReady()) {
     	// Use the NOP assembly language instruction in the loop body
         asm volatile("nop");
-    } while ( !(*AUX_MU_LSR & 0x1) );
+    }
 
-    // Read the character from the Mini UART I/O register
-    r = (char)(*AUX_MU_IO);
+    // Read the character from the UART data register
+    r = (char)(receiveCharacter());
     
     // Convert the carrige return character to a newline
     // character, otherwise return the character unchanged
@@ -224,27 +315,128 @@ char uart_getc()
 //  Returns:        void
 //
 //  Description:    This function writes the specified string to the console
-//                  terminal using the TXD function of the UART1 peripheral.
+//                  terminal using the TXD function of the UART peripheral.
+//                  The string is also passed to the mirror function, if one
+//                  has been set with uart_set_mirror().
 //
 ////////////////////////////////////////////////////////////////////////////////
 
 void uart_puts(char *s)
 {
-    // Keep processing characters in the string until we reach a null
-    // terminating character
-    while (*s) {
-        // If we encounter a newline character in the string
-        // then also send a carriage return just before the newline
-        if (*s == '\n')
-            uart_putc('\r');
-
-		// Send the current character, and increment the pointer
-        uart_putc(*s++);
+    unsigned int length = 0;
+
+
+    // Give the whole string to the mirror first, if there is one
+    if (uart_mirror)
+        uart_mirror(s);
+
+    // Find the length of the string, up to the null terminating
+    // character, and send it all in one go
+    while (s[length])
+        length++;
+
+    uart_write(s, length);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       transmit
+//
+//  Arguments:      buffer:   The bytes to send
+//                  length:   The number of bytes
+//                  text:     TRUE to send a carriage return before each
+//                            newline, FALSE to send the bytes unchanged
+//
+//  Returns:        void
+//
+//  Description:    This function sends a block of bytes over the TXD line.
+//                  Rather than waiting for room before every byte, as
+//                  uart_putc() does, it finds how much room there is in
+//                  the transmit FIFO once, and then fills it. A block
+//                  therefore costs one poll per FIFO full of bytes: 8 on
+//                  the Mini UART, which reports its FIFO level, and up to
+//                  16 on the PL011.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void transmit(const unsigned char *buffer, unsigned int length, int text)
+{
+    register unsigned int space;
+    int carriageReturn = 0;
+
+
+    while (length) {
+        // Wait until there is room in the transmit FIFO
+        do {
+            space = transmitSpace();
+        } while (space == 0);
+
+        // Fill the free places. A newline takes two, so the carriage
+        // return is remembered as sent in case the FIFO fills between them.
+        while (space && length) {
+            if (text && *buffer == '\n' && !carriageReturn) {
+                transmitCharacter('\r');
+                carriageReturn = 1;
+            } else {
+                transmitCharacter(*buffer++);
+                carriageReturn = 0;
+                length--;
+            }
+            space--;
+        }
     }
 }
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       uart_write
+//
+//  Arguments:      buffer:   The characters to write to the console
+//                  length:   The number of characters
+//
+//  Returns:        void
+//
+//  Description:    This function writes a block of characters to the console
+//                  terminal, sending a carriage return before each newline,
+//                  a FIFO full at a time. The characters are not passed to
+//                  the mirror function.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void uart_write(const char *buffer, unsigned int length)
+{
+    transmit((const unsigned char *)buffer, length, 1);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       uart_write_binary
+//
+//  Arguments:      buffer:   The bytes to send
+//                  length:   The number of bytes
+//
+//  Returns:        void
+//
+//  Description:    This function sends a block of bytes exactly as they are,
+//                  a FIFO full at a time, such as a telemetry packet sent
+//                  between lines of text. The bytes are not passed to the
+//                  mirror function.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void uart_write_binary(const unsigned char *buffer, unsigned int length)
+{
+    transmit(buffer, length, 0);
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 //  Function:       uart_puthex
@@ -254,7 +446,7 @@ void uart_puts(char *s)
 //  Returns:        void
 //
 //  Description:    This function writes the specified unsigned integer value
-//                  to he console terminal using the TXD function of the UART1
+//                  to he console terminal using the TXD function of the UART
 //                  peripheral. The unsigned integer value is 32 bits in size,
 //                  so 8 hexadecimal digits are written (without the 0x prefix).
 //
@@ -263,6 +455,7 @@ void uart_puts(char *s)
 void uart_puthex(unsigned int value) {
     register unsigned int digit;
     register int i;
+    char buffer[9];
 
     // Loop 8 times, isolating each 4-bit unit in turn,
     // starting with the leftmost unit
@@ -280,7 +473,89 @@ void uart_puthex(unsigned int value) {
             digit += 0x30;
         }
 
-        // Write the digit to the console terminal
-        uart_putc(digit);
+        // Store the digit in the buffer
+        buffer[7 - (i >> 2)] = digit;
+    }
+
+    // Write the digits to the console terminal as one string,
+    // so that they also reach any mirror
+    buffer[8] = '\0';
+    uart_puts(buffer);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       uart_set_mirror
+//
+//  Arguments:      mirror:   A function to call with each string written by
+//                            uart_puts(), or 0 to stop mirroring
+//
+//  Returns:        void
+//
+//  Description:    This function sets a second destination for console
+//                  output, such as the frame buffer console.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void uart_set_mirror(void (*mirror)(char *s))
+{
+    uart_mirror = mirror;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       uart_flush
+//
+//  Arguments:      none
+//
+//  Returns:        void
+//
+//  Description:    This function waits until every character written has
+//                  been sent. On the Mini UART this will be true when the
+//                  Transmitter Idle bit (bit 6) in the Line Status Register
+//                  is a 1.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void uart_flush()
+{
+    while (!transmitIdle()) {
+        asm volatile("nop");
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       uart_set_clock_rate
+//
+//  Arguments:      rate:     The new system clock rate in Hz
+//
+//  Returns:        void
+//
+//  Description:    This function sets the Baud Register for 115200 Baud from
+//                  a new system clock rate, using the same formula as
+//                  uart_init(). It must be called after the core clock is
+//                  changed, once uart_flush() has returned, or characters
+//                  will be sent at the wrong rate. The PL011 has a clock of
+//                  its own, so nothing changes when the console is on it.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void uart_set_clock_rate(unsigned int rate)
+{
+#ifdef CONSOLE_PL011
+    if (consolePl011) {
+        return;
+    }
+#endif
+
+    if (rate) {
+        mmio_write(AUX_MU_BAUD, ((rate + (4 * UART_BAUD_RATE)) / (8 * UART_BAUD_RATE)) - 1);
     }
 }
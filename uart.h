@@ -4,4 +4,9 @@ void uart_init();
 void uart_putc(unsigned int c);
 char uart_getc();
 void uart_puts(char *s);
+void uart_write(const char *buffer, unsigned int length);
+void uart_write_binary(const unsigned char *buffer, unsigned int length);
 void uart_puthex(unsigned int value);
+void uart_set_mirror(void (*mirror)(char *s));
+void uart_flush();
+void uart_set_clock_rate(unsigned int rate);
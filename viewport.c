@@ -0,0 +1,447 @@
+// The functions in this file implement a scrolling view of the maze, using
+// the frame buffer virtual offset to follow the character. See viewport.h
+// for how the tiles are laid out in the frame buffer.
+//
+// When the camera moves by one tile, the window moves by one tile too, and
+// only the row or column of tiles coming into view is drawn, once, where the
+// window will show it. Scrolling therefore costs one row or column of tiles
+// per step, instead of a redraw of the whole screen. Every ring width or
+// height of steps the window reaches the edge of the first quadrant and
+// wraps around to the other side of the region, and the tiles that stay in
+// view are copied there by the DMA engine while the new ones are drawn.
+
+// Needed header files
+#include "framebuffer.h"
+#include "tiles.h"
+#include "maze.h"
+#include "viewport.h"
+
+// The widest ring row drawn in one piece
+#define VIEWPORT_MAX_COLUMNS    64
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       cellTile
+//
+//  Arguments:      viewport:        The viewport
+//                  x:               Maze cell x coordinate
+//                  y:               Maze cell y coordinate
+//
+//  Returns:        The tile number to draw for the cell
+//
+//  Description:    This function chooses the tile for a maze cell. Cells
+//                  outside the maze, which are seen when the maze is smaller
+//                  than the screen, are drawn as walls.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static int cellTile(struct Viewport *viewport, int x, int y)
+{
+    if (x < 0 || y < 0 || x >= viewport->maze->width || y >= viewport->maze->height) {
+        return TILE_WALL;
+    }
+
+    return maze_tile(viewport->maze, x, y);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       viewport_init
+//
+//  Arguments:      viewport:        The viewport to set up
+//                  maze:            The maze to show
+//                  columns:         Screen width in tiles
+//                  rows:            Screen height in tiles
+//                  top:             First frame buffer row of the region,
+//                                   which must be VIEWPORT_REGION_WIDTH x
+//                                   VIEWPORT_REGION_HEIGHT pixels
+//
+//  Returns:        void
+//
+//  Description:    This function sets up a viewport with its camera at the
+//                  top left corner of the maze. Nothing is drawn until
+//                  viewport_draw() is called.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void viewport_init(struct Viewport *viewport, struct Maze *maze, int columns, int rows,
+                   int top)
+{
+    viewport->maze = maze;
+    viewport->columns = columns;
+    viewport->rows = rows;
+    viewport->ringColumns = columns + 1;
+    viewport->ringRows = rows + 1;
+    viewport->top = top;
+    viewport->cameraX = 0;
+    viewport->cameraY = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       drawViewRow
+//
+//  Arguments:      viewport:        The viewport
+//                  x:               Maze x coordinate of the first cell
+//                  y:               Maze y coordinate of the cells
+//                  count:           Number of cells to draw
+//
+//  Returns:        void
+//
+//  Description:    This function draws a horizontal run of maze cells, which
+//                  must all be in view, where the screen window shows them.
+//                  The run is drawn with whole rows of tiles.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void drawViewRow(struct Viewport *viewport, int x, int y, int count)
+{
+    unsigned char tiles[VIEWPORT_MAX_COLUMNS];
+    int i, pixelX, pixelY;
+
+
+    if (count > VIEWPORT_MAX_COLUMNS) {
+        count = VIEWPORT_MAX_COLUMNS;
+    }
+
+    for (i = 0; i < count; i++) {
+        tiles[i] = cellTile(viewport, x + i, y);
+    }
+
+    viewport_cell_to_framebuffer(viewport, x, y, &pixelX, &pixelY);
+    drawTileRow(pixelX, pixelY, tiles, count);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       viewport_draw_row
+//
+//  Arguments:      viewport:        The viewport
+//                  x:               Maze x coordinate of the first cell
+//                  y:               Maze y coordinate of the cells
+//                  count:           Number of cells to draw
+//
+//  Returns:        void
+//
+//  Description:    This function draws a horizontal run of maze cells where
+//                  the screen window shows them. Cells out of view are left
+//                  out, since they are drawn as they come into view.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void viewport_draw_row(struct Viewport *viewport, int x, int y, int count)
+{
+    if (y < viewport->cameraY || y >= viewport->cameraY + viewport->rows) {
+        return;
+    }
+
+    if (x < viewport->cameraX) {
+        count -= viewport->cameraX - x;
+        x = viewport->cameraX;
+    }
+    if (x + count > viewport->cameraX + viewport->columns) {
+        count = viewport->cameraX + viewport->columns - x;
+    }
+
+    if (count > 0) {
+        drawViewRow(viewport, x, y, count);
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       viewport_show
+//
+//  Arguments:      viewport:        The viewport
+//
+//  Returns:        void
+//
+//  Description:    This function moves the screen window so that it shows
+//                  the view from the current camera position, once any
+//                  copy of the cells kept in view has finished.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void viewport_show(struct Viewport *viewport)
+{
+    waitFrameBufferDma();
+
+    setFrameBufferOffset((viewport->cameraX % viewport->ringColumns) * TILE_SIZE,
+                         viewport->top + ((viewport->cameraY % viewport->ringRows) * TILE_SIZE));
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       viewport_draw
+//
+//  Arguments:      viewport:        The viewport
+//
+//  Returns:        void
+//
+//  Description:    This function draws every cell in view from the current
+//                  camera position, and shows it. It is needed when the maze
+//                  changes or the camera jumps. Only the cells the window
+//                  will show are drawn.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void viewport_draw(struct Viewport *viewport)
+{
+    int y;
+
+
+    // Nothing may still be copying into the window
+    waitFrameBufferDma();
+
+    for (y = viewport->cameraY; y < viewport->cameraY + viewport->rows; y++) {
+        drawViewRow(viewport, viewport->cameraX, y, viewport->columns);
+    }
+
+    viewport_show(viewport);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       centerCamera
+//
+//  Arguments:      viewport:        The viewport
+//                  x:               Maze x coordinate to keep in view
+//                  y:               Maze y coordinate to keep in view
+//                  cameraX:         Where to return the camera x coordinate
+//                  cameraY:         Where to return the camera y coordinate
+//
+//  Returns:        void
+//
+//  Description:    This function finds the camera position that puts the
+//                  given cell near the middle of the screen, without showing
+//                  anything past the edges of the maze. A maze smaller than
+//                  the screen is shown from its top left corner.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void centerCamera(struct Viewport *viewport, int x, int y, int *cameraX, int *cameraY)
+{
+    int limit;
+
+
+    *cameraX = x - (viewport->columns / 2);
+    limit = viewport->maze->width - viewport->columns;
+    if (*cameraX > limit) {
+        *cameraX = limit;
+    }
+    if (*cameraX < 0) {
+        *cameraX = 0;
+    }
+
+    *cameraY = y - (viewport->rows / 2);
+    limit = viewport->maze->height - viewport->rows;
+    if (*cameraY > limit) {
+        *cameraY = limit;
+    }
+    if (*cameraY < 0) {
+        *cameraY = 0;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       viewport_jump
+//
+//  Arguments:      viewport:        The viewport
+//                  x:               Maze x coordinate to show
+//                  y:               Maze y coordinate to show
+//
+//  Returns:        void
+//
+//  Description:    This function centers the camera on a cell and redraws
+//                  the whole view. It is used when the maze has changed, so
+//                  none of the tiles already drawn can be kept.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void viewport_jump(struct Viewport *viewport, int x, int y)
+{
+    centerCamera(viewport, x, y, &viewport->cameraX, &viewport->cameraY);
+    viewport_draw(viewport);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       queueKeptCells
+//
+//  Arguments:      viewport:        The viewport, with its camera moved
+//                  oldX:            Camera x coordinate before the move
+//                  oldY:            Camera y coordinate before the move
+//
+//  Returns:        void
+//
+//  Description:    This function queues a copy of the cells that were in
+//                  view before the camera moved and still are, from where
+//                  the old window showed them to where the new window will.
+//                  They only move if the window has wrapped around the
+//                  ring, when they move by a whole ring width or height, so
+//                  the two places never overlap. The copy is not started.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void queueKeptCells(struct Viewport *viewport, int oldX, int oldY)
+{
+    int left, top, width, height, fromX, fromY, toX, toY;
+
+
+    left = (oldX > viewport->cameraX) ? oldX : viewport->cameraX;
+    top = (oldY > viewport->cameraY) ? oldY : viewport->cameraY;
+    width = ((oldX < viewport->cameraX) ? oldX : viewport->cameraX) + viewport->columns - left;
+    height = ((oldY < viewport->cameraY) ? oldY : viewport->cameraY) + viewport->rows - top;
+
+    fromX = (oldX % viewport->ringColumns) + left - oldX;
+    fromY = (oldY % viewport->ringRows) + top - oldY;
+    toX = (viewport->cameraX % viewport->ringColumns) + left - viewport->cameraX;
+    toY = (viewport->cameraY % viewport->ringRows) + top - viewport->cameraY;
+
+    if (width <= 0 || height <= 0 || (fromX == toX && fromY == toY)) {
+        return;
+    }
+
+    queueCopyInFrameBuffer(viewport->top + (toY * TILE_SIZE), toX * TILE_SIZE,
+                           viewport->top + (fromY * TILE_SIZE), fromX * TILE_SIZE,
+                           width * TILE_SIZE, height * TILE_SIZE);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       viewport_follow
+//
+//  Arguments:      viewport:        The viewport
+//                  x:               Maze x coordinate to keep in view
+//                  y:               Maze y coordinate to keep in view
+//
+//  Returns:        TRUE (non-zero) if the camera moved, FALSE (zero) otherwise
+//
+//  Description:    This function moves the camera so that the given cell is
+//                  near the middle of the screen, as the character moves
+//                  through an unchanged maze. A step of one tile only draws
+//                  the row or column of tiles coming into view, and copies
+//                  the rest of the view if the window wraps around. Larger
+//                  jumps redraw the whole view.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+int viewport_follow(struct Viewport *viewport, int x, int y)
+{
+    int cameraX, cameraY, deltaX, deltaY, oldX, oldY;
+
+
+    centerCamera(viewport, x, y, &cameraX, &cameraY);
+    deltaX = cameraX - viewport->cameraX;
+    deltaY = cameraY - viewport->cameraY;
+
+    if (deltaX == 0 && deltaY == 0) {
+        return 0;
+    }
+
+    oldX = viewport->cameraX;
+    oldY = viewport->cameraY;
+    viewport->cameraX = cameraX;
+    viewport->cameraY = cameraY;
+
+    // Anything other than a single step needs a full redraw
+    if ((deltaX && deltaY) || deltaX < -1 || deltaX > 1 || deltaY < -1 || deltaY > 1) {
+        viewport_draw(viewport);
+        return 1;
+    }
+
+    // If the window wraps around, copy what stays in view to where it
+    // will be shown, while the CPU draws the column or row coming into
+    // view. The new cells are drawn where nothing on screen is, so the
+    // screen does not change until the window moves.
+    queueKeptCells(viewport, oldX, oldY);
+    startFrameBufferDma();
+
+    if (deltaX) {
+        x = (deltaX > 0) ? (cameraX + viewport->columns - 1) : cameraX;
+        for (y = cameraY; y < cameraY + viewport->rows; y++) {
+            drawViewRow(viewport, x, y, 1);
+        }
+    } else {
+        y = (deltaY > 0) ? (cameraY + viewport->rows - 1) : cameraY;
+        drawViewRow(viewport, cameraX, y, viewport->columns);
+    }
+
+    viewport_show(viewport);
+
+    return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       viewport_cell_to_framebuffer
+//
+//  Arguments:      viewport:        The viewport
+//                  x:               Maze cell x coordinate, which is in view
+//                  y:               Maze cell y coordinate, which is in view
+//                  pixelX:          Where to return the pixel x coordinate
+//                  pixelY:          Where to return the pixel y coordinate
+//
+//  Returns:        void
+//
+//  Description:    This function finds where the screen window shows a
+//                  cell, so that it can be drawn, or a sprite drawn over it.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void viewport_cell_to_framebuffer(struct Viewport *viewport, int x, int y, int *pixelX,
+                                  int *pixelY)
+{
+    viewport_screen_to_framebuffer(viewport, (x - viewport->cameraX) * TILE_SIZE,
+                                   (y - viewport->cameraY) * TILE_SIZE, pixelX, pixelY);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Function:       viewport_screen_to_framebuffer
+//
+//  Arguments:      viewport:        The viewport
+//                  screenX:         Pixel x coordinate on the screen
+//                  screenY:         Pixel y coordinate on the screen
+//                  pixelX:          Where to return the pixel x coordinate
+//                  pixelY:          Where to return the pixel y coordinate
+//
+//  Returns:        void
+//
+//  Description:    This function finds where a point on the screen currently
+//                  is in the frame buffer, for drawing things that stay in
+//                  one place on the screen, such as the HUD.
+//
+////////////////////////////////////////////////////////////////////////////////
+
+void viewport_screen_to_framebuffer(struct Viewport *viewport, int screenX, int screenY,
+                                    int *pixelX, int *pixelY)
+{
+    *pixelX = ((viewport->cameraX % viewport->ringColumns) * TILE_SIZE) + screenX;
+    *pixelY = viewport->top + ((viewport->cameraY % viewport->ringRows) * TILE_SIZE) + screenY;
+}
@@ -0,0 +1,33 @@
+// A scrolling view of a maze that may be larger than the screen.
+//
+// The view is shown through a screen window into a frame buffer region
+// twice the size of a ring one tile wider and one tile higher than the
+// screen. The window starts on a tile boundary inside the first quadrant,
+// at the camera position modulo the ring size, so the camera is moved with
+// setFrameBufferOffset() instead of redrawing the screen. Each cell in view
+// is drawn once, where the window shows it, and what is outside the window
+// is not kept up to date.
+struct Viewport {
+    struct Maze *maze;
+    int columns, rows;              // Screen size in tiles
+    int ringColumns, ringRows;      // Ring size in tiles
+    int top;                        // First frame buffer row of the region
+    int cameraX, cameraY;           // Maze cell shown at the top left
+};
+
+// The frame buffer region a viewport needs, in pixels
+#define VIEWPORT_REGION_WIDTH(columns)  (2 * ((columns) + 1) * TILE_SIZE)
+#define VIEWPORT_REGION_HEIGHT(rows)    (2 * ((rows) + 1) * TILE_SIZE)
+
+// Function prototypes
+void viewport_init(struct Viewport *viewport, struct Maze *maze, int columns, int rows,
+                   int top);
+void viewport_draw(struct Viewport *viewport);
+void viewport_jump(struct Viewport *viewport, int x, int y);
+void viewport_draw_row(struct Viewport *viewport, int x, int y, int count);
+int viewport_follow(struct Viewport *viewport, int x, int y);
+void viewport_show(struct Viewport *viewport);
+void viewport_cell_to_framebuffer(struct Viewport *viewport, int x, int y, int *pixelX,
+                                  int *pixelY);
+void viewport_screen_to_framebuffer(struct Viewport *viewport, int screenX, int screenY,
+                                    int *pixelX, int *pixelY);